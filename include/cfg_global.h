@@ -13,27 +13,57 @@
 #define MQTT_PART_ERRORS "errors"
 #define MQTT_PART_BUILDTIME "buildtime"
 #define MQTT_PART_PRESENCE "presence"
-#define MQTT_SENSORS_T_MATA C_WRAPPER("mata")
 
-#define APP_VERSION C_WRAPPER( "ardControl: 0v14" )
+#define APP_VERSION_STR "ardControl: 0v14" // a literal, for sizes checked at compile time
+#define APP_VERSION C_WRAPPER( APP_VERSION_STR )
 
 #define ARD_PREFIX C_WRAPPER( "ard:" )
 
-// board-specific macros
-#define MQTT_ALARM_SECURITY C_WRAPPER("ard/" MQTT_CLIENT_SHORT_NAME "/alarm/sec")
-#define MQTT_ALARM_SYS_ERR  C_WRAPPER("ard/" MQTT_CLIENT_SHORT_NAME "/alarm/err")
-#define MQTT_DEBUG          C_WRAPPER("ard/" MQTT_CLIENT_SHORT_NAME "/debug")
-#define MQTT_DEVICES_CMNDS  C_WRAPPER("ard/" MQTT_CLIENT_SHORT_NAME "/control/commands")
-
-#define MQTT_SENSORS_ANALOG C_WRAPPER("ard/" MQTT_CLIENT_SHORT_NAME "/sensors/A")
-#define MQTT_SENSORS_ADDR   C_WRAPPER("ard/" MQTT_CLIENT_SHORT_NAME "/sensors/T/addr/")
-#define MQTT_SENSORS_T      C_WRAPPER("ard/" MQTT_CLIENT_SHORT_NAME "/sensors/T/values/")
-#define MQTT_SENSORS_BIN_IN C_WRAPPER("ard/" MQTT_CLIENT_SHORT_NAME "/sensors/bin_in/")
-
-#define MQTT_DEV_STATE           C_WRAPPER( "devices/" MQTT_PART_STATE "/" MQTT_CLIENT_SHORT_NAME "/" )
-#define MQTT_DEV_STATE_ERRORS    C_WRAPPER( "devices/" MQTT_PART_STATE "/" MQTT_PART_ERRORS "/" )
-#define MQTT_DEV_STATE_BUILDTIME C_WRAPPER( "devices/" MQTT_PART_STATE "/" MQTT_PART_BUILDTIME "/" )
-#define MQTT_DEV_PRESENCE        C_WRAPPER( "devices/" MQTT_PART_STATE "/" MQTT_PART_PRESENCE "/" )
+// board-specific topics, all kept in flash (see MQTT_publish.cpp). Channel numbers are
+// appended to the ones ending with '/'
+#define MQTT_TOPICS(X)                                                                      \
+    X(MQTT_T_ALARM_SECURITY,   "ard/" MQTT_CLIENT_SHORT_NAME "/alarm/sec")                  \
+    X(MQTT_T_ALARM_SYS_ERR,    "ard/" MQTT_CLIENT_SHORT_NAME "/alarm/err")                  \
+    X(MQTT_T_DEBUG,            "ard/" MQTT_CLIENT_SHORT_NAME "/debug")                      \
+    X(MQTT_T_TRACE,            "ard/" MQTT_CLIENT_SHORT_NAME "/debug/trace")                \
+    X(MQTT_T_DEVICES_CMNDS,    "ard/" MQTT_CLIENT_SHORT_NAME "/control/commands")           \
+    X(MQTT_T_DEVICES_CMNDS_MODULES, "ard/" MQTT_CLIENT_SHORT_NAME "/control/commands/+")    \
+    X(MQTT_T_DEVICES_RESULTS,  "ard/" MQTT_CLIENT_SHORT_NAME "/control/results")            \
+    X(MQTT_T_DEVICES_ACKS,     "ard/" MQTT_CLIENT_SHORT_NAME "/control/acks")               \
+    X(MQTT_T_SENSORS_ANALOG,   "ard/" MQTT_CLIENT_SHORT_NAME "/sensors/A")                  \
+    X(MQTT_T_SENSORS_ADDR,     "ard/" MQTT_CLIENT_SHORT_NAME "/sensors/T/addr/")            \
+    X(MQTT_T_SENSORS_T,        "ard/" MQTT_CLIENT_SHORT_NAME "/sensors/T/values/")          \
+    X(MQTT_T_SENSORS_T_MATA,   "ard/" MQTT_CLIENT_SHORT_NAME "/sensors/T/values/mata")      \
+    X(MQTT_T_SENSORS_BIN_IN,   "ard/" MQTT_CLIENT_SHORT_NAME "/sensors/bin_in/")            \
+    X(MQTT_T_SENSORS_BIN_IN_STATE, "ard/" MQTT_CLIENT_SHORT_NAME "/sensors/bin_in/state")   \
+    X(MQTT_T_STATS_TIMERS,     "ard/" MQTT_CLIENT_SHORT_NAME "/stats/timers")               \
+    X(MQTT_T_STATS_QUEUE,      "ard/" MQTT_CLIENT_SHORT_NAME "/stats/queue")                \
+    X(MQTT_T_STATS_PUBLISH,    "ard/" MQTT_CLIENT_SHORT_NAME "/stats/publish")              \
+    X(MQTT_T_STATS_HEAP,       "ard/" MQTT_CLIENT_SHORT_NAME "/stats/heap")                 \
+    X(MQTT_T_STATS_LATENCY,    "ard/" MQTT_CLIENT_SHORT_NAME "/stats/latency")              \
+    X(MQTT_T_STATS_TASKS,      "ard/" MQTT_CLIENT_SHORT_NAME "/stats/tasks/")               \
+    X(MQTT_T_STATS_PROFILE,    "ard/" MQTT_CLIENT_SHORT_NAME "/stats/prof/")                \
+    X(MQTT_T_TELEMETRY,        "ard/" MQTT_CLIENT_SHORT_NAME "/telemetry")                  \
+    X(MQTT_T_DEV_STATE,        "devices/" MQTT_PART_STATE "/" MQTT_CLIENT_SHORT_NAME "/")   \
+    X(MQTT_T_DEV_STATE_ERRORS, "devices/" MQTT_PART_STATE "/" MQTT_PART_ERRORS "/")         \
+    X(MQTT_T_DEV_STATE_BUILDTIME, "devices/" MQTT_PART_STATE "/" MQTT_PART_BUILDTIME "/")   \
+    X(MQTT_T_DEV_PRESENCE,     "devices/" MQTT_PART_STATE "/" MQTT_PART_PRESENCE "/")   \
+    X(MQTT_T_NODE_PRESENCE,    "devices/" MQTT_PART_STATE "/" MQTT_PART_PRESENCE "/" MQTT_CLIENT_SHORT_NAME)   \
+    X(MQTT_T_NODE_BUILDTIME,   "devices/" MQTT_PART_STATE "/" MQTT_PART_BUILDTIME "/" MQTT_CLIENT_SHORT_NAME) \
+    X(MQTT_T_STATE_BIN_OUT,    "ard/" MQTT_CLIENT_SHORT_NAME "/state/B/")                   \
+    X(MQTT_T_STATE_PWM,        "ard/" MQTT_CLIENT_SHORT_NAME "/state/P/")
+
+#ifndef MQTT_TOPICS_ENUM_DEFINED
+#define MQTT_TOPICS_ENUM_DEFINED
+#define MQTT_TOPIC_ENUM(ID, STR) ID,
+typedef enum { MQTT_TOPICS(MQTT_TOPIC_ENUM) MQTT_T_COUNT } mqtt_topic_t;
+
+/// topic copied from flash to o_sTopic, which has room for MQTT_MAX_TOPIC_LENGTH + 1 chars
+/// (mqtt_publish.h). Returns o_sTopic
+const char* MQTT_TopicStr(uint8_t i_uTopic, char* o_sTopic);
+/// topic in flash, for *_P functions
+PGM_P MQTT_TopicStr_P(uint8_t i_uTopic);
+#endif // MQTT_TOPICS_ENUM_DEFINED
 
 // some rationales
 
@@ -0,0 +1,131 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Bounded reader of command frames, shared by all decoders. Include after "my_common.h".
+//
+// The reader never goes past the frame end: reading from an exhausted reader returns 0 and
+// marks the reader with CMND_ERR_TRUNCATED. Only the first error is kept, so after decoding
+// m_err tells what went wrong first. Nothing is copied, the frame is parsed in place.
+
+#ifndef CMND_READER_H
+#define CMND_READER_H
+
+// for frames of unknown length, i.e. already validated commands from EEPROM
+#define CMND_READER_UNBOUNDED (0xFFFF)
+
+typedef enum {
+    CMND_ERR_NONE = 0,
+    CMND_ERR_TRUNCATED,  // frame ended before the command did
+    CMND_ERR_NOT_DIGIT,  // a digit was expected
+    CMND_ERR_NO_MODULE,  // unknown module letter
+    CMND_ERR_NO_DECODER, // module doesn't accept commands
+    CMND_ERR_RANGE,      // a field out of its range
+    CMND_ERR_SUM,        // bad sum
+    CMND_ERR_QUEUE_FULL, // decoded fine, but no room to queue it
+    CMND_ERR_EXEC,       // decoded fine, but the module failed to execute it
+    CMND_ERR_DUPLICATE,  // already seen sequence number, not executed again
+} cmnd_err_t;
+
+typedef struct cmnd_reader_s {
+    const byte* m_pos;
+    u16 m_left;
+    u8 m_err;
+} cmnd_reader_t;
+
+static inline void CR_Init(cmnd_reader_t& r, const byte* i_pPayload, u16 i_uLength) {
+    r.m_pos = i_pPayload;
+    r.m_left = i_uLength;
+    r.m_err = CMND_ERR_NONE;
+}
+
+/// records the first error only, returns false for convenience
+static inline bool CR_Fail(cmnd_reader_t& r, u8 i_uErr) {
+    if (CMND_ERR_NONE == r.m_err)
+        r.m_err = i_uErr;
+    return false;
+}
+
+static inline bool CR_IsOk(const cmnd_reader_t& r) {
+    return (CMND_ERR_NONE == r.m_err);
+}
+
+static inline bool CR_IsEmpty(const cmnd_reader_t& r) {
+    return (0 == r.m_left);
+}
+
+static inline byte CR_Peek(const cmnd_reader_t& r) {
+    return (0 == r.m_left) ? 0 : *r.m_pos;
+}
+
+static inline byte CR_Byte(cmnd_reader_t& r) {
+    if (0 == r.m_left) {
+        CR_Fail(r, CMND_ERR_TRUNCATED);
+        return 0;
+    }
+
+    r.m_left--;
+    return *r.m_pos++;
+}
+
+/// next byte as a decimal digit [0..9]
+static inline u8 CR_Digit(cmnd_reader_t& r) {
+    byte c = CR_Byte(r);
+    if (c < '0' || c > '9') {
+        CR_Fail(r, CMND_ERR_NOT_DIGIT);
+        return 0;
+    }
+
+    return c - '0';
+}
+
+/// next byte as a hex digit [0..9A..F]
+static inline u8 CR_HexDigit(cmnd_reader_t& r) {
+    byte c = CR_Byte(r);
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return 10 + c - 'A';
+
+    CR_Fail(r, CMND_ERR_NOT_DIGIT);
+    return 0;
+}
+
+/// skips given number of bytes, which have been already parsed by other means
+static inline bool CR_Skip(cmnd_reader_t& r, u16 i_uCount) {
+    if (i_uCount > r.m_left) {
+        r.m_pos += r.m_left;
+        r.m_left = 0;
+        return CR_Fail(r, CMND_ERR_TRUNCATED);
+    }
+
+    r.m_pos += i_uCount;
+    r.m_left -= i_uCount;
+    return true;
+}
+
+/// number of bytes read since i_pStart
+static inline u8 CR_Consumed(const cmnd_reader_t& r, const byte* i_pStart) {
+    return (u8)(r.m_pos - i_pStart);
+}
+
+/// sets the error of failed decoding, for decoders that validate all fields at once
+static inline bool CR_FailSanity(cmnd_reader_t& r, const state_t& s) {
+    return CR_Fail(r, (true == isSumOk(s)) ? CMND_ERR_RANGE : CMND_ERR_SUM);
+}
+
+/// old style decoder entry: unbounded frame, length returned by o_CmndLen
+static inline bool CR_DecodeUnbounded(bool (*i_fDecoder)(cmnd_reader_t&, state_t&),
+    const byte* payload, state_t& s, u8* o_CmndLen) {
+    cmnd_reader_t r;
+    CR_Init(r, payload, CMND_READER_UNBOUNDED);
+
+    bool ret = i_fDecoder(r, s);
+
+    if (NULL != o_CmndLen)
+        *o_CmndLen = CR_Consumed(r, payload);
+
+    return ret;
+}
+
+#endif // CMND_READER_H
@@ -0,0 +1,82 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Commands core extensions. Include after "my_common.h".
+
+#ifndef CMNDS_CORE_H
+#define CMNDS_CORE_H
+
+#include "cmnd_reader.h"
+
+/// Like CMNDS_ScheduleAction, but fun_start is also recalled every i_uPeriod secs,
+/// till s.count secs pass and fun_stop is called
+bool CMNDS_SchedulePeriodicAction(const state_t& s, actions_t& i_rActions,
+    actions_context_t& i_rActionsContext, u16 i_uPeriod);
+
+/// Decodes a single command, module letter included, sets s.action too. Stops at the end
+/// of the command, so r can be used to decode the next one. On failure r.m_err tells why
+bool CMNDS_decodeCmnd(cmnd_reader_t& r, state_t& s);
+
+// batch frame: CMNDS_BATCH_MARKER followed by concatenated commands, optionally
+// separated by ' ' or ';', e.g. "*B011S1;B111S1;P0A5"
+#define CMNDS_BATCH_MARKER '*'
+#define CMNDS_BATCH_MAX_CMNDS (32) // one bit per command in the result bitmap
+
+// a batch executed in place is copied first, as publishing overwrites the frame received.
+// Longer ones are rejected then, queued ones are not limited
+#ifndef CMNDS_BATCH_MAX_LENGTH
+#define CMNDS_BATCH_MAX_LENGTH (128)
+#endif
+
+/// Decodes and executes all commands in the batch frame, in order. Stops at the first
+/// command that can't be decoded. Result "<processed>,<bitmap in hex>" is published on
+/// MQTT_DEVICES_RESULTS, bit i set means command i succeeded
+bool CMNDS_LaunchBatch(const byte* payload, unsigned int length);
+void CMNDS_PublishBatchResult(u8 i_uProcessed, u32 i_uResults);
+
+// binary frame, all multi-byte fields but count are big endian:
+//   CMNDS_BIN_MARKER | module letter | command | channel | count (varint) | module args | CRC16
+// count is LEB128 encoded (7 bits per byte, least significant group first), CRC16 is
+// CCITT over all the preceding bytes, including the marker
+#define CMNDS_BIN_MARKER (0xB1)
+#define CMNDS_BIN_MIN_LENGTH (7) // marker, module, command, channel, 1 byte count, CRC16
+
+/// Checks, decodes and executes a binary command frame
+bool CMNDS_LaunchBinary(const byte* payload, unsigned int length);
+
+// correlation id prefix of a text command: CMNDS_CORR_ID_MARKER, decimal id [1..65535], ';',
+// e.g. "#17;B011S1". Such a command is acknowledged on MQTT_DEVICES_ACKS with
+// "<id>,<rc>,<decode_us>,<exec_us>", where rc is cmnd_err_t (CMND_ERR_NONE when executed fine).
+// Binary frames are acknowledged the same way. Batch frames are not, as their result is
+// published on MQTT_DEVICES_RESULTS anyway, so the id is ignored for them
+#define CMNDS_CORR_ID_MARKER '#'
+#define CMNDS_NO_CORR_ID (0)
+
+void CMNDS_PublishAck(u16 i_uCorrId, u8 i_uResult, u32 i_uDecodeUs, u32 i_uExecUs);
+
+// sequence number prefix of any frame: CMNDS_SEQ_MARKER, sender letter [A..Z], decimal epoch
+// [0..4294967295], CMNDS_SEQ_EPOCH_END, decimal sequence number [0..65535], ';'. It goes before
+// the correlation id, e.g. "@A1700000000:1234;#17;B011S1".
+// The epoch has to go up each time the sender starts (its start time will do), and its sequence
+// numbers can start anywhere then. Frames of an older epoch, or replayed within the last
+// CMNDS_DEDUP_WINDOW sequence numbers of the current one, are not executed again, but still
+// acknowledged (rc CMND_ERR_DUPLICATE), and older sequence numbers are dropped the same way.
+// A frame counts as seen once any of its commands got executed or queued, so only frames
+// rejected before that (bad command, queue full) can be resent.
+// CMNDS_DEDUP_SENDERS most recent senders are tracked
+#define CMNDS_SEQ_MARKER '@'
+#define CMNDS_SEQ_EPOCH_END ':'
+#define CMNDS_DEDUP_SENDERS (4)
+#define CMNDS_DEDUP_WINDOW (32) // bits of u32
+
+/// Entry point for commands received from network, any of the frames above. Commands are
+/// decoded here, but executed later from loop(), see mngr_cmnd_queue.h
+bool CMNDS_Submit(const byte* payload, unsigned int length);
+
+/// Entry point for commands received on a module topic (MQTT_T_DEVICES_CMNDS "/<letter>").
+/// Same frames, except batch and binary ones, and commands don't start with the module letter,
+/// e.g. "@A1700000000:1234;#17;011S1" on ".../control/commands/B"
+bool CMNDS_SubmitToModule(char i_cModule, const byte* payload, unsigned int length);
+
+#endif // CMNDS_CORE_H
@@ -0,0 +1,42 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// SCHEDULE module - commands launched locally at given wall-clock times. Include after "my_common.h".
+
+#ifndef CMNDS_SCHEDULE_H
+#define CMNDS_SCHEDULE_H
+
+// opt-in, as SCHED_EEPROM_OFFSET has to be checked against the EEPROM layout of the board first
+#ifndef N32_CFG_SCHEDULE_ENABLED
+#define N32_CFG_SCHEDULE_ENABLED 0
+#endif
+
+#ifndef SCHED_MAX_ENTRIES
+#define SCHED_MAX_ENTRIES (4)
+#endif
+
+#define SCHED_MAX_CMND_LENGTH (12)   // stored command, module letter and sum included
+#define SCHED_CHECK_INTERVAL_IN_S (20) // has to be shorter than a minute, not to miss any entry
+
+// wear-levelled area of the schedule table, has to be past the one of QA (at offset 0)
+#ifndef SCHED_EEPROM_OFFSET
+#define SCHED_EEPROM_OFFSET (512)
+#endif
+
+typedef enum {
+    CMND_SCHED_C0_ADD_ENTRY = 0,
+    CMND_SCHED_C1_REMOVE_ENTRY,
+    CMND_SCHED_C2_CLEAR_ALL,
+    CMND_SCHED_C3_SHOW_ENTRIES,
+    CMND_SCHED_MAX_VALUE = CMND_SCHED_C3_SHOW_ENTRIES
+} sched_cmnds_t;
+
+#if 1 == N32_CFG_SCHEDULE_ENABLED
+bool decode_CMND_C(const byte* payload, state_t& s, u8* o_CmndLen);
+void SCHED_ModuleInit(void);
+void SCHED_DisplayAssignments(void);
+module_caps_t SCHED_getCapabilities(void);
+#endif // N32_CFG_SCHEDULE_ENABLED
+
+#endif // CMNDS_SCHEDULE_H
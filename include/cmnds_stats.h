@@ -0,0 +1,35 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// STATS module - runtime statistics on request. Include after "my_common.h".
+
+#ifndef CMNDS_STATS_H
+#define CMNDS_STATS_H
+
+#ifndef N32_CFG_STATS_ENABLED
+#define N32_CFG_STATS_ENABLED 1
+#endif
+
+typedef enum {
+    CMND_STATS_S0_SHOW_TIMERS = 0,
+    CMND_STATS_S1_PUBLISH_TIMERS,
+    CMND_STATS_S2_RESET_TIMERS,
+    CMND_STATS_S3_PUBLISH_QUEUE,
+    CMND_STATS_S4_RESET_QUEUE,
+    CMND_STATS_S5_PUBLISH_PUB_QUEUE,
+    CMND_STATS_S6_PUBLISH_HEAP,
+    CMND_STATS_S7_PUBLISH_LATENCY,
+    CMND_STATS_S8_PUBLISH_TASKS,
+    CMND_STATS_S9_PUBLISH_PROFILE,
+    CMND_STATS_MAX_VALUE = CMND_STATS_S9_PUBLISH_PROFILE
+} stats_cmnds_t;
+
+#if 1 == N32_CFG_STATS_ENABLED
+bool decode_CMND_S(const byte* payload, state_t& s, u8* o_CmndLen);
+bool STATS_ExecuteCommand(const state_t& s);
+void STATS_ModuleInit(void);
+module_caps_t STATS_getCapabilities(void);
+#endif // N32_CFG_STATS_ENABLED
+
+#endif // CMNDS_STATS_H
@@ -0,0 +1,33 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Queue of decoded commands waiting for execution in loop(). Include after "my_common.h".
+
+#ifndef MNGR_CMND_QUEUE_H
+#define MNGR_CMND_QUEUE_H
+
+#ifndef N32_CFG_CMND_QUEUE_ENABLED
+#define N32_CFG_CMND_QUEUE_ENABLED 1
+#endif
+
+#ifndef CQUEUE_SIZE
+#define CQUEUE_SIZE (8)
+#endif
+
+#define CQUEUE_BUDGET_IN_MS (20) // time for executing queued commands, per loop() pass
+#define CQUEUE_NOT_IN_BATCH (0xFF)
+
+#if 1 == N32_CFG_CMND_QUEUE_ENABLED
+bool CQUEUE_Push(const state_t& s, u8 i_uBatchPos = CQUEUE_NOT_IN_BATCH,
+    u16 i_uCorrId = 0, u32 i_uDecodeUs = 0, u32 i_uReceivedUs = 0);
+void CQUEUE_BatchBegin(void);
+bool CQUEUE_BatchEnd(u8 i_uProcessed);
+void CQUEUE_BatchAbort(void);
+void CQUEUE_ProcessPending(u32 i_uBudgetMs);
+u8 CQUEUE_GetDepth(void);
+void CQUEUE_ResetStats(void);
+bool CQUEUE_PublishStats(void);
+#endif // N32_CFG_CMND_QUEUE_ENABLED
+
+#endif // MNGR_CMND_QUEUE_H
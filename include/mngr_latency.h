@@ -0,0 +1,36 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Latency probe - from a command received to its first pin write. Include after "my_common.h".
+
+#ifndef MNGR_LATENCY_H
+#define MNGR_LATENCY_H
+
+// opt-in, it costs LAT_SAMPLES * 4 bytes of RAM, and 4 bytes per command queue entry
+#ifndef N32_CFG_LATENCY_PROBE_ENABLED
+#define N32_CFG_LATENCY_PROBE_ENABLED 0
+#endif
+
+#ifndef LAT_SAMPLES
+#define LAT_SAMPLES (32) // the most recent ones are kept
+#endif
+
+#define LAT_NO_STAMP (0) // command not measured
+
+#if 1 == N32_CFG_LATENCY_PROBE_ENABLED
+void LAT_MarkReceived(void);
+u32 LAT_TakeReceived(void);
+void LAT_BeginCommand(u32 i_uReceivedUs);
+void LAT_MarkActuated(void);
+void LAT_EndCommand(void);
+bool LAT_PublishStats(void);
+#else
+#define LAT_MarkReceived()
+#define LAT_TakeReceived() (LAT_NO_STAMP)
+#define LAT_BeginCommand(receivedUs)
+#define LAT_MarkActuated()
+#define LAT_EndCommand()
+#endif // N32_CFG_LATENCY_PROBE_ENABLED
+
+#endif // MNGR_LATENCY_H
@@ -0,0 +1,39 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Modules manager extensions. Include after "my_common.h".
+
+#ifndef MNGR_MODULES_H
+#define MNGR_MODULES_H
+
+#include "cmnd_reader.h"
+
+/// fields of a binary command frame, already checked against its CRC. Module specific
+/// arguments (if any) are left as raw bytes, see CMNDS_LaunchBinary
+typedef struct cmnd_bin_s {
+    u8 command;
+    u8 channel;
+    u32 count;
+    const byte* args;
+    u8 args_len;
+} cmnd_bin_t;
+
+/// decoders read their command from r, never past its end. On failure r.m_err tells why
+typedef bool (*mod_cmnd_decoder_f)(cmnd_reader_t& r, state_t& s);
+typedef bool (*mod_cmnd_bin_decoder_f)(const cmnd_bin_t& i_rBin, state_t& s);
+typedef bool (*mod_cmnd_executor_f)(const state_t& s);
+typedef void (*mod_init_f)(void);
+
+/// a row of the letter-indexed dispatch table. Kept in PROGMEM, so it has to be
+/// copied with MOD_getDispatch before use
+typedef struct module_dispatch_s {
+    mod_cmnd_decoder_f m_cmnd_decoder;
+    mod_cmnd_executor_f m_cmnd_executor;
+    mod_init_f m_mod_init;
+    mod_cmnd_bin_decoder_f m_cmnd_bin_decoder;
+} module_dispatch_t;
+
+bool MOD_getDispatch(char i_cModule, module_dispatch_t& o_rDispatch);
+
+#endif // MNGR_MODULES_H
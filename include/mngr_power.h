@@ -0,0 +1,31 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Idle (power) manager. Include after "my_common.h".
+
+#ifndef MNGR_POWER_H
+#define MNGR_POWER_H
+
+#ifndef N32_CFG_IDLE_ENABLED
+#define N32_CFG_IDLE_ENABLED 1
+#endif
+
+// W5500 INT line, -1 when not wired. Without it, sockets are polled over SPI every
+// POWER_NET_POLL_MS while idle, so incoming data still ends the idle early
+#ifndef N32_CFG_W5500_INT_PIN
+#define N32_CFG_W5500_INT_PIN (-1)
+#endif
+
+#ifndef POWER_NET_POLL_MS
+#define POWER_NET_POLL_MS (10)
+#endif
+
+// the loop is run at least that often, i.e. for MQTT keep alive & watchdog
+#define POWER_IDLE_MAX_MS (1000)
+
+void POWER_ModInit(void);
+void POWER_RequestWakeup(void);
+void POWER_IdleUntilNextEvent(u32 i_uPollMs);
+
+#endif // MNGR_POWER_H
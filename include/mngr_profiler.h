@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Loop profiler - time taken by each stage of loop(). Include after "my_common.h".
+
+#ifndef MNGR_PROFILER_H
+#define MNGR_PROFILER_H
+
+// opt-in, it costs about 50 bytes of RAM per stage and a micros() pair per stage run
+#ifndef N32_CFG_PROFILER_ENABLED
+#define N32_CFG_PROFILER_ENABLED 0
+#endif
+
+#define PROF_BUCKETS (16) // powers of two, in us: <2us, <4us, ..., <32ms, >=32ms
+
+// stage id, letter in statistics
+#define PROF_STAGES(X)                  \
+    X(PROF_ETH_MAINTAIN,    'E')        \
+    X(PROF_MQTT_LOOP,       'M')        \
+    X(PROF_MQTT_RECONNECT,  'R')        \
+    X(PROF_CMND_QUEUE,      'Q')        \
+    X(PROF_PUB_QUEUE,       'P')        \
+    X(PROF_NTP,             'N')        \
+    X(PROF_TIMERS,          'T')        \
+    X(PROF_TIMERS_MS,       't')        \
+    X(PROF_ALARMS,          'A')
+
+#define PROF_STAGE_ENUM(id, letter) id,
+typedef enum {
+    PROF_STAGES(PROF_STAGE_ENUM)
+    PROF_COUNT
+} prof_stage_t;
+#undef PROF_STAGE_ENUM
+
+#if 1 == N32_CFG_PROFILER_ENABLED
+void PROF_Record(u8 i_uStage, u32 i_uDurationUs);
+bool PROF_PublishStats(void);
+
+// runs the code given and records how long it took
+#define PROF_STAGE(stage, ...)                          \
+    do {                                                \
+        const u32 profStartedUs = micros();             \
+        __VA_ARGS__;                                    \
+        PROF_Record(stage, micros() - profStartedUs);   \
+    } while (0)
+#else
+#define PROF_STAGE(stage, ...) do { __VA_ARGS__; } while (0)
+#endif // N32_CFG_PROFILER_ENABLED
+
+#endif // MNGR_PROFILER_H
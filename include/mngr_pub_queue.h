@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Outbound queue of MQTT messages. Telemetry keeps one message per topic, latest value wins.
+// Include after "my_common.h".
+
+#ifndef MNGR_PUB_QUEUE_H
+#define MNGR_PUB_QUEUE_H
+
+#ifndef N32_CFG_PUB_QUEUE_ENABLED
+#define N32_CFG_PUB_QUEUE_ENABLED 1
+#endif
+
+// each entry takes about 87 bytes of RAM (topic and payload with their terminators, priority,
+// flags, order), so the default 8 take about 700 bytes
+#ifndef PQUEUE_SIZE
+#define PQUEUE_SIZE (8) // number of messages waiting at once
+#endif
+
+#define PQUEUE_MAX_TOPIC_LENGTH (40)   // longer messages are published directly
+#define PQUEUE_MAX_PAYLOAD_LENGTH (40)
+
+#ifndef PQUEUE_RATE_PER_S
+#define PQUEUE_RATE_PER_S (20) // drain rate, messages per second
+#endif
+#define PQUEUE_BURST (4) // messages published at once, after a quiet period
+
+// lower value goes first
+typedef enum {
+    PQUEUE_PRIO_ALARM = 0,
+    PQUEUE_PRIO_CONTROL, // command replies
+    PQUEUE_PRIO_TELEMETRY,
+} pqueue_prio_t;
+
+#if 1 == N32_CFG_PUB_QUEUE_ENABLED
+bool PQUEUE_Push(const char* topic, const char* payload, u8 i_uPrio, bool i_bCoalesce,
+    bool i_bRetained = false);
+void PQUEUE_ProcessPending(void);
+u8 PQUEUE_GetDepth(void);
+u32 PQUEUE_GetTimeToNextMs(u32 i_uMaxMs);
+bool PQUEUE_PublishStats(void);
+#endif // N32_CFG_PUB_QUEUE_ENABLED
+
+#endif // MNGR_PUB_QUEUE_H
@@ -0,0 +1,34 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Retained node state: presence (with the Last Will), build info and output states.
+// Include after "my_common.h".
+
+#ifndef MNGR_STATE_H
+#define MNGR_STATE_H
+
+#ifndef N32_CFG_RETAINED_STATE_ENABLED
+#define N32_CFG_RETAINED_STATE_ENABLED 1
+#endif
+
+#define STATE_PRESENCE_ONLINE "online"
+#define STATE_PRESENCE_OFFLINE "offline" // Last Will payload
+#define STATE_WILL_QOS (1)
+
+#if 1 == N32_CFG_RETAINED_STATE_ENABLED
+void STATE_OnConnected(void);
+void STATE_PublishOutput(u8 i_uTopic, u8 i_uChannel, u8 i_uValue);
+
+#if 1 == N32_CFG_BIN_OUT_ENABLED
+void BIN_OUT_PublishStates(void);
+#endif // N32_CFG_BIN_OUT_ENABLED
+#if 1 == N32_CFG_PWM_ENABLED
+void PWM_PublishStates(void);
+#endif // N32_CFG_PWM_ENABLED
+#else
+#define STATE_OnConnected()
+#define STATE_PublishOutput(topic, channel, value)
+#endif // N32_CFG_RETAINED_STATE_ENABLED
+
+#endif // MNGR_STATE_H
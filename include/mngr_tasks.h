@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Cooperative task scheduler, run from loop(). Include after "my_common.h".
+//
+// On each loop() pass, the most important task due is picked, run, and the choice is made
+// again, till nothing is due. So a safety task waits at most for the task currently running,
+// never for a whole pass. Tasks must not block: each has a run-time budget, and overruns are
+// counted (S8).
+
+#ifndef MNGR_TASKS_H
+#define MNGR_TASKS_H
+
+#ifndef N32_CFG_TASKS_ENABLED
+#define N32_CFG_TASKS_ENABLED 1
+#endif
+
+#ifndef TASKS_MAX
+#define TASKS_MAX (12)
+#endif
+
+#define TASK_NULL (0xFF)
+
+#define TASK_PERIOD_POLL (0) // run once per loop() pass, doesn't keep the MCU awake
+
+// lower value goes first
+typedef enum {
+    TASK_PRIO_SAFETY = 0,  // i.e. over-temperature checks
+    TASK_PRIO_CONTROL,     // timers, commands, inputs
+    TASK_PRIO_NETWORK,     // Ethernet, MQTT
+    TASK_PRIO_BACKGROUND,  // publishing, sensors reading, logs
+} task_prio_t;
+
+typedef void (*task_f)(void);
+
+#if 1 == N32_CFG_TASKS_ENABLED
+u8 TASK_Register(task_f i_fTask, u8 i_uPrio, u32 i_uPeriodMs, u16 i_uBudgetUs, char i_cOwner);
+void TASK_RunPending(void);
+u32 TASK_GetTimeToNextMs(u32 i_uMaxMs);
+bool TASK_PublishStats(void);
+#endif // N32_CFG_TASKS_ENABLED
+
+#endif // MNGR_TASKS_H
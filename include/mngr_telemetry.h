@@ -0,0 +1,35 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Telemetry aggregator - readings of all modules in one frame per node. Include after "my_common.h".
+
+#ifndef MNGR_TELEMETRY_H
+#define MNGR_TELEMETRY_H
+
+// opt-in, as consumers have to switch from per channel topics to the telemetry one
+#ifndef N32_CFG_TELEMETRY_ENABLED
+#define N32_CFG_TELEMETRY_ENABLED 0
+#endif
+
+#define TELEM_FORMAT_JSON (0)   // {"seq":N,"ts":T,"v":{"T0":2150,"A1":512,...}}
+#define TELEM_FORMAT_BINARY (1) // see mngr_telemetry.cpp
+
+#ifndef TELEM_FORMAT
+#define TELEM_FORMAT TELEM_FORMAT_JSON
+#endif
+
+#ifndef TELEM_MAX_READINGS
+#define TELEM_MAX_READINGS (40) // distinct module/channel pairs
+#endif
+
+// PubSubClient buffer is 256 bytes by default, topic and header included.
+// Readings not fitting go in the next frame.
+#define TELEM_FRAME_MAX_LENGTH (200)
+
+#if 1 == N32_CFG_TELEMETRY_ENABLED
+void TELEM_Put(char i_cModule, u8 i_uChannel, i16 i_iValue);
+void TELEM_Flush(void);
+#endif // N32_CFG_TELEMETRY_ENABLED
+
+#endif // MNGR_TELEMETRY_H
@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Timer lateness & callback duration histograms. Include after "my_common.h".
+
+#ifndef MNGR_TIMER_STATS_H
+#define MNGR_TIMER_STATS_H
+
+#ifndef N32_CFG_TIMER_STATS_ENABLED
+#define N32_CFG_TIMER_STATS_ENABLED 1
+#endif
+
+#define TSTATS_BUCKETS (8)
+
+#if 1 == N32_CFG_TIMER_STATS_ENABLED
+void TSTATS_RecordLateness(char i_cOwner, u32 i_uLateSecs);
+void TSTATS_RecordCallback(char i_cOwner, u32 i_uDurationUs);
+void TSTATS_Reset(void);
+void TSTATS_DisplayHistograms(void);
+bool TSTATS_PublishCompact(void);
+#else
+#define TSTATS_RecordLateness(owner, late)
+#define TSTATS_RecordCallback(owner, duration)
+#define TSTATS_Reset()
+#define TSTATS_DisplayHistograms()
+#define TSTATS_PublishCompact() (true)
+#endif // N32_CFG_TIMER_STATS_ENABLED
+
+#endif // MNGR_TIMER_STATS_H
@@ -0,0 +1,38 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Timers manager extensions. Include after "my_common.h".
+
+#ifndef MNGR_TIMERS_H
+#define MNGR_TIMERS_H
+
+#define TIMER_OWNER_NONE '?'
+
+u8 TIMER_StartOwned(char i_cOwner, const actions_t& i_rActions, actions_context_t& i_rActionContext,
+    unsigned long time_seconds, timer_type_t i_eTimerType = TIMER_SHOT_ONCE);
+u8 TIMER_StartPeriodic(char i_cOwner, const actions_t& i_rActions, actions_context_t& i_rActionContext,
+    unsigned long time_seconds, u16 i_uPeriod, u16 i_uPhase = 0);
+u16 TIMER_GetMissedPeriods(u8 timer_id);
+u8 TIMER_GetNumberOfActiveTimers();
+bool TIMER_GetNextDeadline(time_t& o_tDeadline);
+
+// ------------- millisecond timers -------------
+
+#ifndef MAX_MS_TIMERS
+#define MAX_MS_TIMERS (8)
+#endif
+
+/// TIMER_SHOT_ONCE:     fun_start on start, fun_stop after time_ms
+/// TIMER_SHOT_MULTIPLE: fun_start on start and then every time_ms, fun_stop on TIMER_MS_Stop
+u8 TIMER_MS_Start(const actions_t& i_rActions, actions_context_t& i_rActionContext,
+    u16 time_ms, timer_type_t i_eTimerType = TIMER_SHOT_ONCE);
+bool TIMER_MS_ReStart(u8 timer_id, u16 time_ms);
+bool TIMER_MS_Stop(u8 timer_id);
+bool TIMER_MS_IsActive(u8 timer_id);
+actions_context_t* TIMER_MS_getActionContext(u8 timer_id);
+void TIMER_MS_ModInit(void);
+void TIMER_MS_ProcessAllTimers(void);
+u32 TIMER_MS_GetTimeToNextDeadline(u32 i_uMaxMs);
+
+#endif // MNGR_TIMERS_H
@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Binary trace log - log site ID and raw arguments, formatted on the host by
+// tools/trace_decode.cpp. Include after "my_common.h".
+
+#ifndef MNGR_TRACE_H
+#define MNGR_TRACE_H
+
+#include "trace_ids.h"
+
+#ifndef N32_CFG_TRACE_ENABLED
+#define N32_CFG_TRACE_ENABLED 1
+#endif
+
+#ifndef TRACE_BUFFER_SIZE
+#define TRACE_BUFFER_SIZE (192) // frame header included, has to fit in PubSubClient buffer
+#endif
+
+#define TRACE_FLUSH_THRESHOLD (TRACE_BUFFER_SIZE / 2)
+#define TRACE_FLUSH_MAX_AGE_MS (2000UL)
+
+#if 1 == N32_CFG_TRACE_ENABLED
+void TRACE_Log(u8 i_uId, const u32* i_pArgs, u8 i_uArgc);
+void TRACE_ProcessPending(void);
+
+static inline void TRACE_Args(u8 i_uId) {
+    TRACE_Log(i_uId, NULL, 0);
+}
+
+template <typename... A>
+static inline void TRACE_Args(u8 i_uId, A... args) {
+    static_assert(sizeof...(args) <= TRACE_MAX_ARGS, "Too many trace arguments");
+    const u32 v[] = { (u32)args... };
+    TRACE_Log(i_uId, v, sizeof...(args));
+}
+
+// records only when the file's debug level is LOG or higher, like IF_DEB_L()
+#define TRACE_L(...) do { IF_DEB_L() TRACE_Args(__VA_ARGS__); } while (0)
+#else
+#define TRACE_L(...) do { } while (0)
+#define TRACE_ProcessPending()
+#endif // N32_CFG_TRACE_ENABLED
+
+#endif // MNGR_TRACE_H
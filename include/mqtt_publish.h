@@ -0,0 +1,33 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Heap-free publishing: topics come from the flash table (MQTT_TOPICS in cfg_global.h),
+// topic and payload are built in one static buffer. Statistics, state and presence messages
+// are built this way, while debug dumps and free-form state messages still use String.
+// Include after "my_common.h".
+
+#ifndef MQTT_PUBLISH_H
+#define MQTT_PUBLISH_H
+
+#define MQTT_MAX_TOPIC_LENGTH (48)   // checked against the table at compile time, channel included
+#define MQTT_MAX_PAYLOAD_LENGTH (100) // longer payloads are truncated and not published
+
+#define MQTT_NO_CHANNEL (0xFF) // nothing appended to the topic
+
+// usage: MSG_Begin(MQTT_T_..., channel); MSG_AppendU32(...); ...; MSG_Send();
+void MSG_Begin(u8 i_uTopic, u8 i_uChannel);
+void MSG_AppendChar(char c);
+void MSG_AppendStr(const char* str);
+void MSG_AppendStr_P(PGM_P str);
+void MSG_AppendU32(u32 i_uValue, u8 i_uBase = 10);
+void MSG_AppendI32(i32 i_iValue);
+void MSG_AppendFloat(float i_fValue, u8 i_uDecimals);
+bool MSG_Send(void);
+bool MSG_SendRetained(void); // queued too, the latest state per topic
+
+bool MSG_PublishTopic(u8 i_uTopic, u8 i_uChannel, const char* payload);
+bool MSG_PublishTopic_P(u8 i_uTopic, u8 i_uChannel, PGM_P payload);
+bool MSG_PublishValue(u8 i_uTopic, u8 i_uChannel, i32 i_iValue);
+
+#endif // MQTT_PUBLISH_H
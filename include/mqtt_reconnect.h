@@ -0,0 +1,20 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// MQTT connection extensions. Include after "my_common.h".
+//
+// MQTT_reconnect() never blocks for longer than a single connect attempt. It's meant to be
+// called on every loop() pass while disconnected, and it attempts to connect only when the
+// backoff time has passed and the link is up.
+
+#ifndef MQTT_RECONNECT_H
+#define MQTT_RECONNECT_H
+
+#define MQTT_BACKOFF_MIN_MS (1000UL)  // the first retry after a failure
+#define MQTT_BACKOFF_MAX_MS (60000UL) // backoff is doubled per failure, up to this
+
+/// Feeds the result of Ethernet.maintain() (DHCP_CHECK_*), to track the link state
+void MQTT_OnEthernetMaintain(int i_iDhcpResult);
+
+#endif // MQTT_RECONNECT_H
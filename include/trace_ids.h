@@ -0,0 +1,41 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Trace log sites: compile-time ID and format string. Shared with tools/trace_decode.cpp,
+// so it has to stay plain C++, with no board dependencies.
+// Formats: %u, %d, %x, %c - one per argument.
+
+#ifndef TRACE_IDS_H
+#define TRACE_IDS_H
+
+// new sites go at the end, not to change IDs of the existing ones
+#define TRACE_IDS(X)                                                                                     \
+    X(TRC_CMNDS_SET_SLOT,       "CMNDS: setting slot: %u, state=%u, prev_state=%u")                     \
+    X(TRC_CMNDS_SCHED,          "CMNDS: Sched: count=%u, action=%c, slot=%u")                           \
+    X(TRC_CMNDS_SLOT_EXTENDED,  "CMNDS: slot already active: extended, count=%u, action=%c")            \
+    X(TRC_CMNDS_NO_DECODER,     "CMNDS: no decoder fun installed for module: '%c'")                     \
+    X(TRC_CMNDS_MODULE_FOUND,   "CMNDS: Module found: '%c'")                                            \
+    X(TRC_CMNDS_NO_EXECUTOR,    "CMNDS: module '%c' doesn't have execution capabilities - ignoring")    \
+    X(TRC_CMNDS_NO_MODULE,      "CMNDS: module not found - message ignored: '%c'")                      \
+    X(TRC_CMNDS_DECODE_FAILED,  "CMNDS: decoding failed, message ignored, err=%u")                      \
+    X(TRC_CMNDS_EXEC_FAILED,    "CMNDS: cmnd execution failed, module '%c'")                            \
+    X(TRC_CMNDS_DUPLICATE,      "CMNDS: duplicate ignored, sender=%c, seq=%u")                          \
+    X(TRC_TIMER_START,          "TIMER: start: stop-start=%u, timer_id=%u, slot=%u, active=%u, type=%u, period=%u") \
+    X(TRC_TIMER_STOP,           "TIMER: stop: timer_id=%u, var1=%u, var2=%u, slot=%u, active=%u, type=%u") \
+    X(TRC_TIMER_RETRIGGERED,    "TIMER: client retriggered the timer, timer_id=%u")                     \
+    X(TRC_TIMER_SHUTDOWN,       "TIMER: shutting down: timer_id=%u, var1=%u, var2=%u, slot=%u, active=%u, type=%u")
+
+#define TRACE_ID_ENUM(ID, FMT) ID,
+typedef enum { TRACE_IDS(TRACE_ID_ENUM) TRC_COUNT } trace_id_t;
+
+#define TRACE_MAX_ARGS (6)
+
+// frame published on MQTT_T_TRACE, little endian:
+//   u8 version, u16 seq, u8 dropped records (saturated),
+//   records: u8 id, u8 argc, u16 millis (low bits), argc * u32 arg
+#define TRACE_FRAME_VERSION (1)
+#define TRACE_FRAME_HEADER_LENGTH (4)
+#define TRACE_RECORD_HEADER_LENGTH (4)
+
+#endif // TRACE_IDS_H
@@ -3,6 +3,12 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "my_common.h"
+#include "mngr_modules.h"
+#include "cmnd_reader.h"
+#include "mngr_power.h"
+#include "mqtt_publish.h"
+#include "mngr_telemetry.h"
+#include "mngr_tasks.h"
 
 #if 1 == N32_CFG_BIN_IN_ENABLED
 
@@ -32,6 +38,7 @@ static bool bin_in_getPinFromChannelNum(u8 i_LogicalChannelNum, u8& o_PhysicalPi
 static volatile u8 portBstatus = 0;
 static void pin_change() {
     portBstatus = PINB;
+    POWER_RequestWakeup();
 }
 
 /// @brief Sets up a logical channel
@@ -122,17 +129,15 @@ static bool bin_in_UpdateStatus(bool i_bForced = false) {
     if (current_mask != prev_mask || true == i_bForced) {
         u16 diffs = current_mask ^ prev_mask;
 
-        String strCurrent, strDiff, strOut, str;
+        char strCurrent[BIN_IN_NUM_OF_AVAIL_CHANNELS + 1];
+        char strDiff[BIN_IN_NUM_OF_AVAIL_CHANNELS + 1];
         bool bHasChanged;
         _FOR(i, 0, BIN_IN_NUM_OF_AVAIL_CHANNELS) {
             bHasChanged = (0x0 != ((1 << i) & diffs));
 
             if (true == bHasChanged) {
                 // first we have to change states
-                strDiff += F("1");
-
-                String stringPath(MQTT_SENSORS_BIN_IN);
-                stringPath += i;
+                strDiff[i] = '1';
 
                 bState = 0x0 != ((1 << i) & current_mask);
 
@@ -149,30 +154,32 @@ static bool bin_in_UpdateStatus(bool i_bForced = false) {
                 }
 #endif // N32_CFG_QUICK_ACTIONS_ENABLED
 
-                if (true == bState)
-                    str = F("OPENED");
-                else
-                    str = F("CLOSED");
-
                 // and finally publish state to the broker
-                MSG_Publish(stringPath.c_str(), str.c_str());
+#if 1 == N32_CFG_TELEMETRY_ENABLED
+                TELEM_Put(BIN_IN_LETTER, i, bState);
+#else
+                MSG_PublishTopic_P(MQTT_T_SENSORS_BIN_IN, i, bState ? PSTR("OPENED") : PSTR("CLOSED"));
+#endif // N32_CFG_TELEMETRY_ENABLED
             }
             else
-                strDiff += F("0");
+                strDiff[i] = '0';
 
-            if (true == bHasChanged)
-                strCurrent += F("1");
-            else
-                strCurrent += F("0");
+            strCurrent[i] = (true == bHasChanged) ? '1' : '0';
         }
-
-        strOut = F("Current: ");
-        strOut += strCurrent;
-        strOut += F(", Diff: ");
-        strOut += strDiff;
-        String stringPath(MQTT_SENSORS_BIN_IN);
-        stringPath += F("state");
-        MSG_Publish(stringPath.c_str(), strOut.c_str());
+        strCurrent[BIN_IN_NUM_OF_AVAIL_CHANNELS] = 0;
+        strDiff[BIN_IN_NUM_OF_AVAIL_CHANNELS] = 0;
+
+#if 1 == N32_CFG_TELEMETRY_ENABLED
+        // inputs are events, so they don't wait for the reporting window
+        TELEM_Flush();
+#else
+        MSG_Begin(MQTT_T_SENSORS_BIN_IN_STATE, MQTT_NO_CHANNEL);
+        MSG_AppendStr_P(PSTR("Current: "));
+        MSG_AppendStr(strCurrent);
+        MSG_AppendStr_P(PSTR(", Diff: "));
+        MSG_AppendStr(strDiff);
+        MSG_Send();
+#endif // N32_CFG_TELEMETRY_ENABLED
 
         prev_mask = current_mask;
     }
@@ -217,7 +224,11 @@ void BIN_IN_ModuleInit(void) {
     prev_mask = readMask();
 
     // BIN_IN monitoring task
+#if 1 == N32_CFG_TASKS_ENABLED
+    TASK_Register(bin_in_AlarmFun, TASK_PRIO_CONTROL, 1000UL * BIN_IN_CHECK_INTERVAL_IN_SECS, 5000, BIN_IN_LETTER);
+#else
     SETUP_RegisterTimer(BIN_IN_CHECK_INTERVAL_IN_SECS, bin_in_AlarmFun);
+#endif // N32_CFG_TASKS_ENABLED
 
     bModuleInitialised = true;
 }
@@ -240,22 +251,20 @@ bool BIN_IN_ExecuteCommand(const state_t& s) {
  * I0S - Update the state (forced)
  * I1S - Update the state (forced)
  */
-bool decode_CMND_I(const byte* payload, state_t& s, u8* o_CmndLen) {
+bool decode_CMND_I(cmnd_reader_t& r, state_t& s) {
     CHECK_MODULE_SANITY();
 
-    const byte* cmndStart = payload;
-
-    s.command = (*payload++) - '0'; // [0..8] - command
-    s.sum = (*payload++) - '0'; // sum = 1
+    s.command = CR_Digit(r); // [0..8] - command
+    s.sum = CR_Byte(r) - '0'; // sum = 1
 
     bool sanity_ok = false;
-    if (s.command >= 0 && s.command <= CMND_BIN_IN_MAX_VALUE)
-        if (true == isSumOk(s))
-            sanity_ok = true;
+    if (true == CR_IsOk(r))
+        if (s.command <= CMND_BIN_IN_MAX_VALUE)
+            if (true == isSumOk(s))
+                sanity_ok = true;
 
-    // setting decoded and valid cmnd length
-    if (NULL != o_CmndLen)
-        *o_CmndLen = payload - cmndStart;
+    if (false == sanity_ok)
+        CR_FailSanity(r, s);
 
     // Info display
     IF_DEB_L() {
@@ -264,16 +273,30 @@ bool decode_CMND_I(const byte* payload, state_t& s, u8* o_CmndLen) {
         str += F(", Sum: ");
         u8 i = s.sum + '0';
         str += i;
-        if (NULL != o_CmndLen) {
-            str += F(", decoded cmnd len: ");
-            str += *o_CmndLen;
-        }
+        str += F(", err: ");
+        str += r.m_err;
         DEBLN(str);
     }
 
     return (sanity_ok);
 }
 
+bool decode_CMND_I(const byte* payload, state_t& s, u8* o_CmndLen) {
+    return CR_DecodeUnbounded(decode_CMND_I, payload, s, o_CmndLen);
+}
+
+/// @brief Binary frame counterpart of decode_CMND_I, channel and count are ignored
+/// @param i_rBin binary command fields
+/// @param s state to be filled
+/// @return true if the command is valid
+bool decodeBinary_CMND_I(const cmnd_bin_t& i_rBin, state_t& s) {
+    CHECK_MODULE_SANITY();
+
+    s.command = i_rBin.command;
+
+    return (0 == i_rBin.args_len && s.command <= CMND_BIN_IN_MAX_VALUE);
+}
+
 module_caps_t BIN_IN_getCapabilities(void) {
     module_caps_t mc = {
         .m_is_input = true,
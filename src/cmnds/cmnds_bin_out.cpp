@@ -3,6 +3,10 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "my_common.h"
+#include "mngr_modules.h"
+#include "cmnd_reader.h"
+#include "mngr_state.h"
+#include "mngr_latency.h"
 
 #if 1 == N32_CFG_BIN_OUT_ENABLED
 
@@ -49,6 +53,7 @@ static void binout_SetPhysicalPinInActiveState(u8 i_logSchannelNumber, u8 i_uPhy
         if (HIGH != state)
             digitalWrite(i_uPhysicalPinBum, HIGH); // var2 == pin
     }
+    LAT_MarkActuated();
 }
 
 static void binout_SetPhysicalPinInInActiveState(u8 i_logSchannelNumber, u8 i_uPhysicalPinBum) {
@@ -65,6 +70,7 @@ static void binout_SetPhysicalPinInInActiveState(u8 i_logSchannelNumber, u8 i_uP
         if (LOW != state)
             digitalWrite(i_uPhysicalPinBum, LOW); // var2 == pin
     }
+    LAT_MarkActuated();
 }
 
 static void binout_ChannelTurnON(actions_context_t& i_rActionsContext) {
@@ -94,6 +100,7 @@ static void binout_ChannelTurnON(actions_context_t& i_rActionsContext) {
     }
 
     binout_SetPhysicalPinInActiveState(i_rActionsContext.var1, PhysicalPinBum);
+    STATE_PublishOutput(MQTT_T_STATE_BIN_OUT, i_rActionsContext.var1, 1);
 };
 
 static void binout_ChannelTurnOFF(actions_context_t& i_rActionsContext) {
@@ -123,6 +130,7 @@ static void binout_ChannelTurnOFF(actions_context_t& i_rActionsContext) {
     }
 
     binout_SetPhysicalPinInInActiveState(i_rActionsContext.var1, PhysicalPinBum);
+    STATE_PublishOutput(MQTT_T_STATE_BIN_OUT, i_rActionsContext.var1, 0);
 }
 
 void BIN_OUT_ModuleInit(void) {
@@ -146,6 +154,23 @@ void BIN_OUT_ModuleInit(void) {
     bModuleInitialised = true;
 }
 
+#if 1 == N32_CFG_RETAINED_STATE_ENABLED
+/// @brief Publishes retained states of all channels, 1 - active
+void BIN_OUT_PublishStates(void) {
+    u8 PhysicalPinNumber;
+
+    _FOR(i, 0, BIN_OUT_NUM_OF_AVAIL_CHANNELS) {
+        if (false == binout_getPinFromChannelNum(i, PhysicalPinNumber))
+            continue;
+
+        // DH channels are active when LOW, see binout_SetPhysicalPinInActiveState
+        const u8 state = digitalRead(PhysicalPinNumber);
+        const bool bActive = (i < BIN_OUT_LINE_DH_COUNT) ? (LOW == state) : (HIGH == state);
+        STATE_PublishOutput(MQTT_T_STATE_BIN_OUT, i, bActive);
+    }
+}
+#endif // N32_CFG_RETAINED_STATE_ENABLED
+
 bool BIN_OUT_ExecuteCommand(const state_t& s) {
     CHECK_MODULE_SANITY();
 
@@ -204,31 +229,35 @@ bool BIN_OUT_ExecuteCommand(const state_t& s) {
  * B1ANS - Output "A" is reset (set LOW forced)
  * B2ANS - All outputs are reset (set NOT ACTIIVE forced)
  */
-bool decode_CMND_B(const byte* payload, state_t& s, u8* o_CmndLen) {
+bool decode_CMND_B(cmnd_reader_t& r, state_t& s) {
     CHECK_MODULE_SANITY();
 
-    const byte* cmndStart = payload;
     bool sanity_ok = false;
 
-    s.command = (*payload++) - '0'; // [0..8] - command
+    s.command = CR_Digit(r); // [0..8] - command
     s.c.b.channel =
-        getDecodedChannelNum((*payload++) - '0'); // [0..9] - Channel
+        getDecodedChannelNum(CR_Byte(r) - '0'); // [0..9] - Channel
 
-    char number = (*payload++) - '0'; // [0..9] - number
-    char scale = *payload++; // [SMTH] - Seconds/Minutes/TenMinutes/Hours
+    char number = CR_Digit(r); // [0..9] - number
+    char scale = CR_Byte(r); // [SMTH] - Seconds/Minutes/TenMinutes/Hours
     s.count = getSecondsFromNumberAndScale(number, scale);
 
-    if (false == binout_getPinFromChannelNum(s.c.b.channel, s.c.b.pin))
+    if (false == binout_getPinFromChannelNum(s.c.b.channel, s.c.b.pin)) {
+        CR_Fail(r, CMND_ERR_RANGE);
         goto SKIP;
+    }
 
-    s.sum = (*payload++) - '0'; // sum = 1
+    s.sum = CR_Byte(r) - '0'; // sum = 1
 
-    if (s.command >= 0 && s.command <= CMND_BIN_OUT_MAX_VALUE)
-        if (s.c.b.channel >= 0 && s.c.b.channel < BIN_OUT_NUM_OF_AVAIL_CHANNELS)
-            if (number >= 0 && number <= 9)
+    if (true == CR_IsOk(r))
+        if (s.command <= CMND_BIN_OUT_MAX_VALUE)
+            if (s.c.b.channel < BIN_OUT_NUM_OF_AVAIL_CHANNELS)
                 if (true == isSumOk(s))
                     sanity_ok = true;
 
+    if (false == sanity_ok)
+        CR_FailSanity(r, s);
+
 SKIP:
     // Info display
     IF_DEB_L() {
@@ -248,13 +277,34 @@ SKIP:
         DEBLN(str);
     }
 
-    // setting decoded and valid cmnd length
-    if (NULL != o_CmndLen)
-        *o_CmndLen = payload - cmndStart;
-
     return (sanity_ok);
 }
 
+bool decode_CMND_B(const byte* payload, state_t& s, u8* o_CmndLen) {
+    return CR_DecodeUnbounded(decode_CMND_B, payload, s, o_CmndLen);
+}
+
+/// @brief Binary frame counterpart of decode_CMND_B, no module arguments
+/// @param i_rBin binary command fields
+/// @param s state to be filled
+/// @return true if the command is valid
+bool decodeBinary_CMND_B(const cmnd_bin_t& i_rBin, state_t& s) {
+    CHECK_MODULE_SANITY();
+
+    s.command = i_rBin.command;
+    s.c.b.channel = i_rBin.channel;
+    s.count = i_rBin.count;
+
+    if (0 != i_rBin.args_len)
+        return false;
+
+    if (s.command <= CMND_BIN_OUT_MAX_VALUE)
+        if (s.c.b.channel < BIN_OUT_NUM_OF_AVAIL_CHANNELS)
+            return binout_getPinFromChannelNum(s.c.b.channel, s.c.b.pin);
+
+    return false;
+}
+
 module_caps_t BIN_OUT_getCapabilities(void) {
     module_caps_t mc = {
         .m_is_input = false,
@@ -3,6 +3,15 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "my_common.h"
+#include "mngr_timers.h"
+#include "cmnds_core.h"
+#include "mngr_modules.h"
+#include "mngr_cmnd_queue.h"
+#include "mqtt_publish.h"
+#include "mngr_trace.h"
+#include "mngr_latency.h"
+
+#include <FastCRC.h>
 
 static debug_level_t uDebugLevel = DEBUG_WARN;
 
@@ -23,15 +32,20 @@ typedef struct {
 static CMNDS_channel_state_t SLOT_States[CMNDS_NUM_OF_AVAIL_SLOTS] = { 0 };
 static u8 g_CountCmnds = 0;
 
-
-
-typedef struct {
-    char module_id;
-    u8 m_first_slot;
-} CMNDS_module_t;
-static CMNDS_module_t MODULES_States[CMNDS_NUM_OF_AVAIL_MODULES] = { 0 };
-static u8 CountModulesRegistered = 0;
-static u8 FirstAvailSlot = 0;
+// Slots layout, fixed at compile time. Modules take consecutive slot ranges in the
+// order: B, I, P, L, T, H. A module without channels takes no slots
+static constexpr u8 CMNDS_FIRST_SLOT_B = 0;
+static constexpr u8 CMNDS_FIRST_SLOT_I = CMNDS_FIRST_SLOT_B + BIN_OUT_NUM_OF_AVAIL_CHANNELS;
+static constexpr u8 CMNDS_FIRST_SLOT_P = CMNDS_FIRST_SLOT_I + BIN_IN_NUM_OF_AVAIL_CHANNELS;
+static constexpr u8 CMNDS_FIRST_SLOT_L = CMNDS_FIRST_SLOT_P + PWM_NUM_OF_AVAIL_CHANNELS;
+static constexpr u8 CMNDS_FIRST_SLOT_T = CMNDS_FIRST_SLOT_L + LED_NUM_OF_AVAIL_CHANNELS;
+static constexpr u8 CMNDS_FIRST_SLOT_H = CMNDS_FIRST_SLOT_T + DS18B20_NUM_OF_AVAIL_CHANNELS;
+static constexpr u16 CMNDS_SLOTS_USED = (u16)CMNDS_FIRST_SLOT_H + HIST_NUM_OF_AVAIL_CHANNELS;
+
+static_assert(CMNDS_SLOTS_USED <= CMNDS_NUM_OF_AVAIL_SLOTS,
+    "CMNDS_NUM_OF_AVAIL_SLOTS is too small for channels of all modules");
+static_assert(CMNDS_NUM_OF_AVAIL_SLOTS < CMNDS_NULL,
+    "slot numbers have to be distinguishable from CMNDS_NULL");
 
 void CMNDS_ModuleInit(void) {
 
@@ -42,81 +56,6 @@ void CMNDS_ModuleInit(void) {
         SLOT_States[i].m_actions.fun_start = NULL;
         SLOT_States[i].m_actions.fun_stop = NULL;
     }
-
-    _FOR(i, 0, CMNDS_NUM_OF_AVAIL_MODULES) {
-        MODULES_States[i].module_id = 0;
-        MODULES_States[i].m_first_slot = 0;
-    }
-
-    u8 AllModulesCount = CMNDS_GetNumOfAvailSubModules();
-
-    char ModuleId;
-    _FOR(i, 0, AllModulesCount)
-        if ('?' != (ModuleId = CMNDS_GetModuleID(i)))
-            if (false == CMNDS_RegisterSubModule(ModuleId)) {
-                IF_DEB_W() {
-                    String str(F("CMNDS: can't register sub module: '"));
-                    str += ModuleId;
-                    str += F("'!");
-                    SERIAL_publish(str.c_str());
-                    MSG_Publish_Debug(str.c_str());
-                }
-
-                THROW_ERROR();
-            }
-}
-
-static bool cmnds_GetFirstSlot4Module(char i_cModule, u8& o_FirstSlotNumber) {
-
-    _FOR(i, 0, CountModulesRegistered)
-        if (i_cModule == MODULES_States[i].module_id) {
-            o_FirstSlotNumber = MODULES_States[i].m_first_slot;
-            return true;
-        }
-
-    o_FirstSlotNumber = CMNDS_NULL;
-
-    IF_DEB_W() {
-        String str(F("CMNDS: requested module: '"));
-        str += i_cModule;
-        str += F("', hasn't been registered, yet!");
-        MSG_Publish_Debug(str.c_str());
-    }
-
-    return false;
-}
-
-bool CMNDS_RegisterSubModule(char i_cModule) {
-
-    if (FirstAvailSlot >= CMNDS_NUM_OF_AVAIL_SLOTS) {
-        IF_DEB_L() {
-            String str(F("CMNDS: no more free slots available!"));
-            SERIAL_publish(str.c_str());
-            MSG_Publish_Debug(str.c_str());
-        }
-        THROW_ERROR();
-        return false;
-    }
-
-    _FOR(i, 0, CountModulesRegistered)
-        if (i_cModule == MODULES_States[i].module_id) {
-            IF_DEB_L() {
-                String str(F("CMNDS: module already registered!"));
-                SERIAL_publish(str.c_str());
-                MSG_Publish_Debug(str.c_str());
-            }
-            THROW_ERROR();
-            return false;
-        }
-
-    MODULES_States[CountModulesRegistered].module_id = i_cModule;
-    MODULES_States[CountModulesRegistered].m_first_slot = FirstAvailSlot;
-
-    CountModulesRegistered++;
-
-    FirstAvailSlot += CMNDS_GetSlotsCount(i_cModule);
-
-    return true;
 }
 
 bool CMNDS_isSlotActive(u8 slot) {
@@ -136,16 +75,7 @@ static u8 cmnds_getTimerIdForSlot(u8 slot) {
 static bool cmnds_setSlotState(u8 slot, bool isActive) {
     if (slot < CMNDS_NUM_OF_AVAIL_SLOTS) {
 
-        IF_DEB_L() {
-            String str(F(" cmnds: setting slot: "));
-            str += slot;
-            str += F(", state=");
-            str += isActive;
-            str += F(", prev_state=");
-            str += SLOT_States[slot].state;
-            // DEBLN(str);
-            MSG_Publish_Debug(str.c_str());
-        }
+        TRACE_L(TRC_CMNDS_SET_SLOT, slot, isActive, SLOT_States[slot].state);
 
         // do we want to set slot active?
         if (true == isActive) {
@@ -169,27 +99,33 @@ void CMNDS_DisplayAssignments(void) {
 
     String str;
     u8 SlotsRegistered = 0;
-    _FOR(i, 0, CountModulesRegistered) {
+    const u8 ModulesCount = CMNDS_GetNumOfAvailSubModules();
+    _FOR(i, 0, ModulesCount) {
+        const char ModuleId = CMNDS_GetModuleID(i);
+        const u8 SlotsCount = CMNDS_GetSlotsCount(ModuleId);
+
+        if (0 == SlotsCount)
+            continue;
+
         str = F(" ");
         str += i;
         str += F(": Module='");
-        str += MODULES_States[i].module_id;
+        str += ModuleId;
         str += F("', Slots=");
-        str += MODULES_States[i].m_first_slot;
+        str += CMNDS_GetFirstSlotNumber(ModuleId);
         str += F("..");
-        str += MODULES_States[i].m_first_slot +
-            CMNDS_GetSlotsCount(MODULES_States[i].module_id) - 1;
+        str += CMNDS_GetFirstSlotNumber(ModuleId) + SlotsCount - 1;
         str += F(", Count=");
-        str += CMNDS_GetSlotsCount(MODULES_States[i].module_id);
+        str += SlotsCount;
         // DEBLN(str);
         MSG_Publish_Debug(str.c_str());
 
-        SlotsRegistered += CMNDS_GetSlotsCount(MODULES_States[i].module_id);
+        SlotsRegistered += SlotsCount;
     }
     str = F("Total: slots reserved: ");
     str += SlotsRegistered;
-    str += F(", modules registered: ");
-    str += CountModulesRegistered;
+    str += F(", modules: ");
+    str += ModulesCount;
     MSG_Publish_Debug(str.c_str());
 
     {
@@ -337,11 +273,22 @@ u8 CMNDS_GetNumOfAvailSubModules() {
     return (SubModules);
 }
 
+#define FIRST_SLOT_CASE(MODULE_ID, FIRST_SLOT, MAX_CHANNELS)                  \
+    case MODULE_ID:                                                            \
+        if (MAX_CHANNELS > 0)                                                  \
+            return (FIRST_SLOT);                                               \
+        break;
+
 u8 CMNDS_GetFirstSlotNumber(char i_cModule) {
 
-    u8 FirstSlotNumber = 0;
-    if (true == cmnds_GetFirstSlot4Module(i_cModule, FirstSlotNumber))
-        return FirstSlotNumber;
+    switch (i_cModule) {
+        FIRST_SLOT_CASE('B', CMNDS_FIRST_SLOT_B, BIN_OUT_NUM_OF_AVAIL_CHANNELS);
+        FIRST_SLOT_CASE('I', CMNDS_FIRST_SLOT_I, BIN_IN_NUM_OF_AVAIL_CHANNELS);
+        FIRST_SLOT_CASE('P', CMNDS_FIRST_SLOT_P, PWM_NUM_OF_AVAIL_CHANNELS);
+        FIRST_SLOT_CASE('L', CMNDS_FIRST_SLOT_L, LED_NUM_OF_AVAIL_CHANNELS);
+        FIRST_SLOT_CASE('T', CMNDS_FIRST_SLOT_T, DS18B20_NUM_OF_AVAIL_CHANNELS);
+        FIRST_SLOT_CASE('H', CMNDS_FIRST_SLOT_H, HIST_NUM_OF_AVAIL_CHANNELS);
+    }
 
     THROW_ERROR();
     DEBLN(F("ERR: Couldn't get first slot number!"));
@@ -349,43 +296,22 @@ u8 CMNDS_GetFirstSlotNumber(char i_cModule) {
     return CMNDS_NULL;
 }
 
-u8 CMNDS_GetSlotNumber(const state_t& s) {
-
-    switch (s.action) {
-    case 'B': // BIN OUTPUT
-        if (s.c.b.channel < CMNDS_GetSlotsCount(s.action))
-            return (CMNDS_GetFirstSlotNumber(s.action) + s.c.b.channel);
-        break;
-
-    case 'I': // BINARY INPUT
-        if (s.c.i.channel < CMNDS_GetSlotsCount(s.action))
-            return (CMNDS_GetFirstSlotNumber(s.action) + s.c.i.channel);
-        break;
-
-    case 'P': // PWM
-        if (s.c.p.channel < CMNDS_GetSlotsCount(s.action))
-            return (CMNDS_GetFirstSlotNumber(s.action) + s.c.p.channel);
-        break;
-
-    case 'L': // LED
-        if (s.c.l.channel < CMNDS_GetSlotsCount(s.action))
-            return (CMNDS_GetFirstSlotNumber(s.action) + s.c.l.channel);
-        break;
-
-    case 'T': // TEMP
-        if (s.c.t.channel < CMNDS_GetSlotsCount(s.action))
-            return (CMNDS_GetFirstSlotNumber(s.action) + s.c.t.channel);
+#define SLOT_CASE(MODULE_ID, FIRST_SLOT, MAX_CHANNELS, CHANNEL)                \
+    case MODULE_ID:                                                            \
+        if (CHANNEL < MAX_CHANNELS)                                            \
+            return (FIRST_SLOT + CHANNEL);                                     \
         break;
 
-    case 'Z': // Valve
-        if (s.c.v.v1 < CMNDS_GetSlotsCount(s.action))
-            return (CMNDS_GetFirstSlotNumber(s.action) + s.c.v.v1);
-        break;
+u8 CMNDS_GetSlotNumber(const state_t& s) {
 
-    case 'H': // HIST
-        if (s.c.h.channel < CMNDS_GetSlotsCount(s.action))
-            return (CMNDS_GetFirstSlotNumber(s.action) + s.c.h.channel);
-        break;
+    switch (s.action) {
+        SLOT_CASE('B', CMNDS_FIRST_SLOT_B, BIN_OUT_NUM_OF_AVAIL_CHANNELS, s.c.b.channel); // BIN OUTPUT
+        SLOT_CASE('I', CMNDS_FIRST_SLOT_I, BIN_IN_NUM_OF_AVAIL_CHANNELS, s.c.i.channel); // BINARY INPUT
+        SLOT_CASE('P', CMNDS_FIRST_SLOT_P, PWM_NUM_OF_AVAIL_CHANNELS, s.c.p.channel); // PWM
+        SLOT_CASE('L', CMNDS_FIRST_SLOT_L, LED_NUM_OF_AVAIL_CHANNELS, s.c.l.channel); // LED
+        SLOT_CASE('T', CMNDS_FIRST_SLOT_T, DS18B20_NUM_OF_AVAIL_CHANNELS, s.c.t.channel); // TEMP
+        SLOT_CASE('H', CMNDS_FIRST_SLOT_H, HIST_NUM_OF_AVAIL_CHANNELS, s.c.h.channel); // HIST
+        // 'Z' (Valve) has no slots, yet
     }
 
     THROW_ERROR();
@@ -471,19 +397,17 @@ static void fun_stop_wrapper(actions_context_t& i_rActionsContext) {
     // return( doesFunWantToBeRestarted );
 }
 
-bool CMNDS_ScheduleAction(const state_t& s, actions_t& i_rActions,
-    actions_context_t& i_rActionsContext) {
+/// @brief Schedules module action on its slot, or extends the one already going
+/// @param s decoded command, s.count is the whole action length
+/// @param i_rActions module actions
+/// @param i_rActionsContext module actions context, timer_id is filled here
+/// @param i_uPeriod when not 0, fun_start is recalled every i_uPeriod secs
+/// @return result of the operation
+static bool cmnds_scheduleAction(const state_t& s, actions_t& i_rActions,
+    actions_context_t& i_rActionsContext, u16 i_uPeriod) {
     u8 slot = CMNDS_GetSlotNumber(s);
 
-    IF_DEB_L() {
-        String str(F("CMNDS: Sched: count="));
-        str += s.count;
-        str += F(", s.action=");
-        str += s.action;
-        str += F(", slot=");
-        str += slot;
-        MSG_Publish_Debug(str.c_str());
-    }
+    TRACE_L(TRC_CMNDS_SCHED, s.count, s.action, slot);
 
     if (CMNDS_NULL == slot) {
         // someting wrong, ignorring
@@ -491,13 +415,7 @@ bool CMNDS_ScheduleAction(const state_t& s, actions_t& i_rActions,
     }
     else if (true == CMNDS_isSlotActive(slot)) {
         // when channel is already active, we want only to extend timer
-        IF_DEB_L() {
-            String str(F("CMNDS: slot already active: extended, count="));
-            str += s.count;
-            str += F(", action=");
-            str += s.action;
-            MSG_Publish_Debug(str.c_str());
-        }
+        TRACE_L(TRC_CMNDS_SLOT_EXTENDED, s.count, s.action);
 
         do {
             u8 timer_id = cmnds_getTimerIdForSlot(slot);
@@ -518,7 +436,12 @@ bool CMNDS_ScheduleAction(const state_t& s, actions_t& i_rActions,
         actions_t WrappedActions{ fun_start_wrapper, fun_stop_wrapper };
 
         // timer when fires, is going to call wrappers
-        if (TIMER_NULL != (SLOT_States[slot].timer_id = TIMER_Start(WrappedActions, i_rActionsContext, s.count))) {
+        if (0 != i_uPeriod)
+            SLOT_States[slot].timer_id = TIMER_StartPeriodic(s.action, WrappedActions, i_rActionsContext, s.count, i_uPeriod);
+        else
+            SLOT_States[slot].timer_id = TIMER_StartOwned(s.action, WrappedActions, i_rActionsContext, s.count);
+
+        if (TIMER_NULL != SLOT_States[slot].timer_id) {
             i_rActionsContext.timer_id = SLOT_States[slot].timer_id;
             g_CountCmnds++;
 
@@ -533,121 +456,717 @@ bool CMNDS_ScheduleAction(const state_t& s, actions_t& i_rActions,
     return false; // error
 }
 
+bool CMNDS_ScheduleAction(const state_t& s, actions_t& i_rActions,
+    actions_context_t& i_rActionsContext) {
+    return cmnds_scheduleAction(s, i_rActions, i_rActionsContext, 0);
+}
+
+bool CMNDS_SchedulePeriodicAction(const state_t& s, actions_t& i_rActions,
+    actions_context_t& i_rActionsContext, u16 i_uPeriod) {
+    return cmnds_scheduleAction(s, i_rActions, i_rActionsContext, i_uPeriod);
+}
+
+/// @brief Asks given module to decode the command
+/// @param i_rDispatch module's functions
+/// @param r reader placed just after the module letter
+/// @param i_State state to be filled by the decoder, with i_State.action already set
+/// @return a result of the operation
+static bool cmnds_decode(const module_dispatch_t& i_rDispatch, cmnd_reader_t& r, state_t& i_State) {
+    if (0 == i_rDispatch.m_cmnd_decoder) {
+        TRACE_L(TRC_CMNDS_NO_DECODER, i_State.action);
+        return CR_Fail(r, CMND_ERR_NO_DECODER);
+    }
+
+    TRACE_L(TRC_CMNDS_MODULE_FOUND, i_State.action);
+
+    // finally, let's ask a module to try to decode the command
+    return i_rDispatch.m_cmnd_decoder(r, i_State);
+}
+
+/// @brief Asks given module to execute decoded command
+/// @param i_rDispatch module's functions
+/// @param s a reference to a cmnd's state struct
+/// @return a result of the operation
+static bool cmnds_execute(const module_dispatch_t& i_rDispatch, state_t& s) {
+    bool bOk = true;
+
+    if (0 == i_rDispatch.m_cmnd_executor)
+        TRACE_L(TRC_CMNDS_NO_EXECUTOR, s.action);
+    else
+        bOk = i_rDispatch.m_cmnd_executor(s);
+
+    LAT_EndCommand();
+
+    return bOk;
+}
+
+/// @brief Looks up module's functions by the module letter
+/// @param i_cModule a module identification letter
+/// @param o_rDispatch is used to store module's functions
+/// @return false if no such module
+static bool cmnds_getDispatch(char i_cModule, module_dispatch_t& o_rDispatch) {
+    if (true == MOD_getDispatch(i_cModule, o_rDispatch))
+        return true;
+
+    TRACE_L(TRC_CMNDS_NO_MODULE, i_cModule);
+    return false;
+}
+
+/// @brief Asks given module to decode the command
+/// @param i_cModule a module identification letter
+/// @param r reader placed just after the module letter, or at the command of a module topic
+/// @param i_State state to be filled
+/// @param o_rDispatch is used to store module's functions, for the execution
+/// @return a result of the operation
+static bool cmnds_decodeFor(char i_cModule, cmnd_reader_t& r, state_t& i_State, module_dispatch_t& o_rDispatch) {
+    i_State.action = i_cModule;
+
+    // single table lookup, for both decoding and execution
+    if (false == cmnds_getDispatch(i_State.action, o_rDispatch))
+        return CR_Fail(r, CMND_ERR_NO_MODULE);
+
+    return cmnds_decode(o_rDispatch, r, i_State);
+}
+
+/// @brief Reads the module letter and asks that module to decode the rest of the command
+/// @param r reader placed at the module letter
+/// @param i_State state to be filled
+/// @param o_rDispatch is used to store module's functions, for the execution
+/// @return a result of the operation
+static bool cmnds_decodeNext(cmnd_reader_t& r, state_t& i_State, module_dispatch_t& o_rDispatch) {
+    const char module = CR_Byte(r); // ACTION
+
+    if (false == CR_IsOk(r))
+        return false;
+
+    return cmnds_decodeFor(module, r, i_State, o_rDispatch);
+}
+
 // can be called recurrently?
+bool CMNDS_decodeCmnd(cmnd_reader_t& r, state_t& i_State) {
+    module_dispatch_t d;
+
+    return cmnds_decodeNext(r, i_State, d);
+}
+
 bool CMNDS_decodeCmnd(const byte* payload, state_t& i_State, u8* o_uCmndLen) {
-    module_funs_t module_slot;
-    mIndex iModuleIndex = 255;
+    cmnd_reader_t r;
 
     if (0 == payload )
         return false;
 
-    char ch = *payload++;
-    if (false == MOD_getModuleIndex(ch, iModuleIndex)) {
-        IF_DEB_L() {
-            String str(F(" module not found - message ignored: '"));
-            str += char(*(payload - 1));
-            str += F("'");
-            SERIAL_publish(str.c_str());
-        }
+    CR_Init(r, payload, CMND_READER_UNBOUNDED);
+
+    bool ret = CMNDS_decodeCmnd(r, i_State);
+
+    if (NULL != o_uCmndLen)
+        *o_uCmndLen = CR_Consumed(r, payload + 1); // without the module letter
+
+    return ret;
+}
+
+/// @brief Executes given state by finding responsible module, and finally calling "executor" function
+/// @param s a reference to a cmnd's state struct
+/// @return a result of the operation
+bool CMNDS_executeCmnd(state_t& s) {
+    module_dispatch_t d;
+
+    if (false == cmnds_getDispatch(s.action, d))
+        return false;
+
+    return cmnds_execute(d, s);
+}
+
+bool CMNDS_modInit(char i_cModule) {
+    module_dispatch_t d;
+
+    if (false == MOD_getDispatch(i_cModule, d))
+        return false;
+
+    if (NULL == d.m_mod_init)
+        return false;
+
+    d.m_mod_init();
+
+    return true;
+}
+
+/// @brief Publishes command ack on MQTT_DEVICES_ACKS
+/// @param i_uCorrId correlation id, as received with the command
+/// @param i_uResult cmnd_err_t, CMND_ERR_NONE on success
+/// @param i_uDecodeUs decoding time
+/// @param i_uExecUs execution time, 0 if not executed
+void CMNDS_PublishAck(u16 i_uCorrId, u8 i_uResult, u32 i_uDecodeUs, u32 i_uExecUs) {
+    MSG_Begin(MQTT_T_DEVICES_ACKS, MQTT_NO_CHANNEL);
+    MSG_AppendU32(i_uCorrId);
+    MSG_AppendChar(',');
+    MSG_AppendU32(i_uResult);
+    MSG_AppendChar(',');
+    MSG_AppendU32(i_uDecodeUs);
+    MSG_AppendChar(',');
+    MSG_AppendU32(i_uExecUs);
+    MSG_Send();
+}
+
+// receipt time of the frame being submitted, for the latency probe. Only its first command
+// takes it, later ones and commands launched locally are not measured
+static u32 LatReceivedUs = LAT_NO_STAMP;
+
+static u32 cmnds_takeReceivedUs(void) {
+    const u32 stamp = LatReceivedUs;
+    LatReceivedUs = LAT_NO_STAMP;
+    return stamp;
+}
+
+/// @brief Decodes the command and executes it right away or queues it
+/// @param payload command
+/// @param length command length, the decoder never reads past it
+/// @param i_bDefer true if the command should be queued
+/// @param i_uCorrId correlation id to be acknowledged, CMNDS_NO_CORR_ID if none
+/// @param o_bTaken set when the command got executed or queued, whatever the result
+/// @param i_cModule module letter given by the topic, then the command doesn't start with it.
+/// 0 when the command starts with the letter
+/// @return a result of the operation
+static bool cmnds_launch(const byte* payload, u16 length, bool i_bDefer, u16 i_uCorrId, bool& o_bTaken,
+    char i_cModule = 0) {
+    module_dispatch_t d;
+    cmnd_reader_t r;
+    state_t s;
+
+    const u32 decodeStarted = micros();
+
+    o_bTaken = false;
+
+    CR_Init(r, payload, length);
+
+    const bool bDecoded = (0 == i_cModule) ? cmnds_decodeNext(r, s, d) : cmnds_decodeFor(i_cModule, r, s, d);
+    if (false == bDecoded) {
+        TRACE_L(TRC_CMNDS_DECODE_FAILED, r.m_err);
+        if (CMNDS_NO_CORR_ID != i_uCorrId)
+            CMNDS_PublishAck(i_uCorrId, r.m_err, micros() - decodeStarted, 0);
         return false;
     }
 
-    module_slot = MOD_getModuleSlot(iModuleIndex);
-    if (0 == module_slot.m_get_caps) {
-        IF_DEB_L() {
-            String str1(F(" no caps for given module!"));
-            SERIAL_publish(str1.c_str());
+    const u32 decodeUs = micros() - decodeStarted;
+
+#if 1 == N32_CFG_CMND_QUEUE_ENABLED
+    if (true == i_bDefer) {
+        if (true == CQUEUE_Push(s, CQUEUE_NOT_IN_BATCH, i_uCorrId, decodeUs, cmnds_takeReceivedUs())) {
+            o_bTaken = true;
+            return true; // ack is published after the execution
         }
+
+        if (CMNDS_NO_CORR_ID != i_uCorrId)
+            CMNDS_PublishAck(i_uCorrId, CMND_ERR_QUEUE_FULL, decodeUs, 0);
         return false;
     }
+#endif // N32_CFG_CMND_QUEUE_ENABLED
 
-    // let's get a module's caps
-    struct module_caps_s caps_instance = (module_slot.m_get_caps)();
-    if (0 == caps_instance.m_cmnd_decoder) {
-        IF_DEB_L() {
-            String str(F(" no decoder fun installed for given module!"));
-            SERIAL_publish(str.c_str());
-        }
+    const u32 execStarted = micros();
+    LAT_BeginCommand(cmnds_takeReceivedUs());
+    const bool bOk = cmnds_execute(d, s);
+    o_bTaken = true;
+
+    if (CMNDS_NO_CORR_ID != i_uCorrId)
+        CMNDS_PublishAck(i_uCorrId, (true == bOk) ? CMND_ERR_NONE : CMND_ERR_EXEC,
+            decodeUs, micros() - execStarted);
+
+    if (false == bOk) {
+        TRACE_L(TRC_CMNDS_EXEC_FAILED, s.action);
         return false;
     }
 
-    IF_DEB_L() {
-        String str2(F("CMNDS: Module found: '"));
-        str2 += char(ch);
-        str2 += F("', slot: ");
-        str2 += iModuleIndex;
-        SERIAL_publish(str2.c_str());
+    return true;
+}
+
+bool CMNDS_Launch(byte* payload) {
+    bool bTaken;
+    return cmnds_launch(payload, CMND_READER_UNBOUNDED, false, CMNDS_NO_CORR_ID, bTaken);
+}
+
+/// @brief Reads decimal number of a frame prefix
+/// @param r reader placed at the first digit, left just after i_cEnd
+/// @param i_cEnd character ending the number
+/// @param i_uMax the highest value allowed
+/// @param o_uValue decoded number
+/// @return false if there are no digits, or the number is above i_uMax
+static bool cmnds_readPrefixNumber(cmnd_reader_t& r, char i_cEnd, u32 i_uMax, u32& o_uValue) {
+    u32 value = 0;
+    u8 digits = 0;
+
+    while (true == CR_IsOk(r) && i_cEnd != CR_Peek(r)) {
+        const u8 digit = CR_Digit(r);
+        if (value > (i_uMax - digit) / 10)
+            return CR_Fail(r, CMND_ERR_RANGE);
+        value = 10 * value + digit;
+        digits++;
     }
 
-    // finally, let's ask a module to try to decode the command
-    return caps_instance.m_cmnd_decoder(payload, i_State, o_uCmndLen);
+    CR_Byte(r); // i_cEnd
+
+    if (0 == digits)
+        return CR_Fail(r, CMND_ERR_NOT_DIGIT);
+
+    o_uValue = value;
+
+    return CR_IsOk(r);
 }
 
-/// @brief Executes given state by finding responsible module, checking capabilities and finally calling "executor" function
-/// @param s a reference to a cmnd's state struct
-/// @return a result of the operation
-bool CMNDS_executeCmnd(state_t& s) {
+/// @brief Reads correlation id prefix, "#<id>;"
+/// @param r reader placed at CMNDS_CORR_ID_MARKER, left just after the prefix
+/// @param o_uCorrId decoded id
+/// @return false if the prefix is malformed
+static bool cmnds_readCorrId(cmnd_reader_t& r, u16& o_uCorrId) {
+    u32 value;
 
-    mIndex i = 255;
-    if (false == MOD_getModuleIndex(s.action, i))
-        return false;
+    CR_Byte(r); // CMNDS_CORR_ID_MARKER
 
-    const module_funs_t module_slot = MOD_getModuleSlot(i);
-    if (0 == module_slot.m_get_caps)
+    if (false == cmnds_readPrefixNumber(r, ';', 0xFFFF, value))
         return false;
 
-    struct module_caps_s caps_instance = (module_slot.m_get_caps)();
-    if (0 == caps_instance.m_cmnd_executor) {
-        IF_DEB_L() {
-            String str2(F("CMNDS: module doesn't have execution capabilities - ignoring"));
-            SERIAL_publish(str2.c_str());
-        }
-        return true;
-    }
-    return caps_instance.m_cmnd_executor(s);
+    if (CMNDS_NO_CORR_ID == value)
+        return CR_Fail(r, CMND_ERR_RANGE);
+
+    o_uCorrId = value;
+
+    return true;
 }
 
-bool CMNDS_modInit(char i_cModule) {
-    module_funs_t module_slot;
-    mIndex i = 255;
+/// @brief Reads sequence number prefix, "@<sender><epoch>:<seq>;"
+/// @param r reader placed at CMNDS_SEQ_MARKER, left just after the prefix
+/// @param o_cSender sender letter
+/// @param o_uEpoch sender's epoch
+/// @param o_uSeq sequence number
+/// @return false if the prefix is malformed
+static bool cmnds_readSeq(cmnd_reader_t& r, char& o_cSender, u32& o_uEpoch, u16& o_uSeq) {
+    u32 value;
 
-    if (false == MOD_getModuleIndex(i_cModule, i))
-        return false;
+    CR_Byte(r); // CMNDS_SEQ_MARKER
 
-    module_slot = MOD_getModuleSlot(i);
-    if (0 == module_slot.m_get_caps)
+    o_cSender = CR_Byte(r);
+    if (o_cSender < 'A' || o_cSender > 'Z')
+        return CR_Fail(r, CMND_ERR_RANGE);
+
+    if (false == cmnds_readPrefixNumber(r, CMNDS_SEQ_EPOCH_END, 0xFFFFFFFF, o_uEpoch))
         return false;
 
-    struct module_caps_s caps_instance = (module_slot.m_get_caps)();
-    if (0 == caps_instance.m_mod_init)
+    if (false == cmnds_readPrefixNumber(r, ';', 0xFFFF, value))
         return false;
 
-    caps_instance.m_mod_init();
+    o_uSeq = value;
 
     return true;
 }
 
-bool CMNDS_Launch(byte* payload) {
+typedef struct {
+    char m_sender; // 0 for a free entry
+    u32 m_epoch; // sender's current epoch
+    u16 m_last_seq; // the highest sequence number seen in the epoch
+    u32 m_window; // bit i set: m_last_seq - i has been seen
+} cmnds_sender_t;
+static cmnds_sender_t SENDER_States[CMNDS_DEDUP_SENDERS] = { 0 };
+static u8 NextSenderEntry = 0;
+
+static cmnds_sender_t* cmnds_findSender(char i_cSender) {
+    _FOR(i, 0, CMNDS_DEDUP_SENDERS)
+        if (i_cSender == SENDER_States[i].m_sender)
+            return &SENDER_States[i];
+
+    return NULL;
+}
+
+/// @brief Checks the frame against the sender's epoch and window, nothing is changed
+/// @param i_cSender sender letter
+/// @param i_uEpoch sender's epoch
+/// @param i_uSeq sequence number
+/// @return true if the frame has been seen already, or is too old to tell
+static bool cmnds_isDuplicate(char i_cSender, u32 i_uEpoch, u16 i_uSeq) {
+    const cmnds_sender_t* p = cmnds_findSender(i_cSender);
+
+    if (NULL == p)
+        return false;
+
+    // epochs only go up, with wrap-around as well
+    const i32 epochDiff = (i32)(i_uEpoch - p->m_epoch);
+
+    if (epochDiff > 0)
+        return false; // the sender has restarted
+
+    if (epochDiff < 0)
+        return true; // sent before the restart, it could be a replay
+
+    // distance with wrap-around, so counters can overflow
+    const int16_t diff = (int16_t)(i_uSeq - p->m_last_seq);
+
+    if (diff > 0)
+        return false; // newer than anything seen
+
+    const u16 back = -(i32)diff;
+
+    if (back >= CMNDS_DEDUP_WINDOW)
+        return true; // past the window, it could be a replay
+
+    return 0 != (p->m_window & ((u32)1 << back));
+}
+
+/// @brief Marks the sequence number as seen, once its frame has been executed or queued, even partly
+/// @param i_cSender sender letter
+/// @param i_uEpoch sender's epoch
+/// @param i_uSeq sequence number, not a duplicate
+static void cmnds_markSeen(char i_cSender, u32 i_uEpoch, u16 i_uSeq) {
+    cmnds_sender_t* p = cmnds_findSender(i_cSender);
+
+    if (NULL == p || i_uEpoch != p->m_epoch) {
+        if (NULL == p) {
+            // new sender takes the oldest entry
+            p = &SENDER_States[NextSenderEntry];
+            NextSenderEntry = (NextSenderEntry + 1) % CMNDS_DEDUP_SENDERS;
+            p->m_sender = i_cSender;
+        }
+
+        p->m_epoch = i_uEpoch;
+        p->m_last_seq = i_uSeq;
+        p->m_window = 1;
+        return;
+    }
+
+    const int16_t diff = (int16_t)(i_uSeq - p->m_last_seq);
+
+    if (diff > 0) { // newer than anything seen, sliding the window
+        p->m_window = (diff >= CMNDS_DEDUP_WINDOW) ? 1 : ((p->m_window << diff) | 1);
+        p->m_last_seq = i_uSeq;
+    }
+    else if (-(i32)diff < CMNDS_DEDUP_WINDOW)
+        p->m_window |= ((u32)1 << -(i32)diff);
+}
+
+/// @brief Tells whether given byte separates commands in a batch frame
+/// @param c byte to be checked
+/// @return true for a separator
+static inline bool cmnds_isBatchSeparator(byte c) {
+    return (' ' == c || ';' == c);
+}
+
+/// @brief Publishes batch frame result on MQTT_DEVICES_RESULTS
+/// @param i_uProcessed number of processed commands
+/// @param i_uResults bit i set means command i succeeded
+void CMNDS_PublishBatchResult(u8 i_uProcessed, u32 i_uResults) {
+    MSG_Begin(MQTT_T_DEVICES_RESULTS, MQTT_NO_CHANNEL);
+    MSG_AppendU32(i_uProcessed);
+    MSG_AppendChar(',');
+    MSG_AppendU32(i_uResults, HEX);
+    MSG_Send();
+}
+
+/// @brief Decodes all commands of the batch frame, and executes them right away or queues them
+/// @param payload batch frame
+/// @param length batch frame length
+/// @param i_bDefer true if commands should be queued. Then the reply is published after the last one is executed
+/// @param o_bTaken set when any of the commands got executed or queued
+/// @return false if any command failed, or (when queued) the batch didn't fit in the queue
+static bool cmnds_launchBatch(const byte* payload, unsigned int length, bool i_bDefer, bool& o_bTaken) {
+    module_dispatch_t d;
+    cmnd_reader_t r;
+    u32 results = 0;
+    u8 processed = 0;
+    bool bAllOk = true;
+
+    o_bTaken = false;
+
+    if (false == i_bDefer) {
+        // executed commands publish, and that overwrites the client's buffer the frame is in
+        static byte Frame[CMNDS_BATCH_MAX_LENGTH];
+
+        if (length > sizeof(Frame)) {
+            CMNDS_PublishBatchResult(0, 0);
+            return false;
+        }
+
+        memcpy(Frame, payload, length);
+        payload = Frame;
+    }
+
+    // a single reader over the whole frame, each decoder stops where its command ends
+    CR_Init(r, payload + 1, (length > 1) ? length - 1 : 0); // skipping CMNDS_BATCH_MARKER
+
+#if 1 == N32_CFG_CMND_QUEUE_ENABLED
+    if (true == i_bDefer)
+        CQUEUE_BatchBegin();
+#endif // N32_CFG_CMND_QUEUE_ENABLED
+
+    while (processed < CMNDS_BATCH_MAX_CMNDS) {
+        while (false == CR_IsEmpty(r) && true == cmnds_isBatchSeparator(CR_Peek(r)))
+            CR_Skip(r, 1);
+
+        if (true == CR_IsEmpty(r))
+            break; // all done
+
+        const byte* cmndStart = r.m_pos;
+        state_t s;
+
+        processed++;
+
+        // we don't know where the next command starts, so giving up
+        if (false == cmnds_decodeNext(r, s, d)) {
+            IF_DEB_W() {
+                String str(F("CMNDS: batch: bad command at offset="));
+                str += (unsigned int)(cmndStart - payload);
+                str += F(", err=");
+                str += r.m_err;
+                DEB_W(str);
+            }
+            bAllOk = false;
+            break;
+        }
+
+#if 1 == N32_CFG_CMND_QUEUE_ENABLED
+        if (true == i_bDefer) {
+            // all or none, so a rejected batch can be simply resent
+            if (false == CQUEUE_Push(s, processed - 1, CMNDS_NO_CORR_ID, 0, cmnds_takeReceivedUs())) {
+                CQUEUE_BatchAbort();
+                CMNDS_PublishBatchResult(0, 0);
+                return false;
+            }
+            continue;
+        }
+#endif // N32_CFG_CMND_QUEUE_ENABLED
+
+        LAT_BeginCommand(cmnds_takeReceivedUs());
+        if (true == cmnds_execute(d, s))
+            results |= ((u32)1 << (processed - 1));
+        else
+            bAllOk = false;
+        o_bTaken = true;
+    }
+
+    if (false == CR_IsEmpty(r))
+        bAllOk = false; // more commands than CMNDS_BATCH_MAX_CMNDS
+
+#if 1 == N32_CFG_CMND_QUEUE_ENABLED
+    // when nothing got queued, there won't be any execution to publish the reply
+    if (true == i_bDefer && true == CQUEUE_BatchEnd(processed)) {
+        o_bTaken = true;
+        return bAllOk;
+    }
+#endif // N32_CFG_CMND_QUEUE_ENABLED
+
+    CMNDS_PublishBatchResult(processed, results);
+
+    return bAllOk;
+}
+
+bool CMNDS_LaunchBatch(const byte* payload, unsigned int length) {
+    bool bTaken;
+    return cmnds_launchBatch(payload, length, false, bTaken);
+}
+
+/// @brief Decodes LEB128 unsigned value
+/// @param payload first byte of the value
+/// @param i_uMaxLen bytes available
+/// @param o_uValue decoded value
+/// @return number of bytes consumed, 0 when the value is broken or doesn't fit u32
+static u8 cmnds_decodeVarint(const byte* payload, unsigned int i_uMaxLen, u32& o_uValue) {
+    o_uValue = 0;
+
+    for (u8 i = 0; i < 5 && i < i_uMaxLen; i++) {
+        o_uValue |= (u32)(payload[i] & 0x7F) << (7 * i);
+        if (0 == (payload[i] & 0x80))
+            return i + 1;
+    }
+
+    return 0;
+}
+
+/// @brief Checks and decodes the binary command frame, and executes it right away or queues it
+/// @param payload binary frame
+/// @param length binary frame length
+/// @param i_bDefer true if the command should be queued
+/// @param i_uCorrId correlation id to be acknowledged, CMNDS_NO_CORR_ID if none
+/// @param o_bTaken set when the command got executed or queued, whatever the result
+/// @return a result of the operation
+static bool cmnds_launchBinary(const byte* payload, unsigned int length, bool i_bDefer, u16 i_uCorrId,
+    bool& o_bTaken) {
+    static FastCRC16 CRC16;
+    module_dispatch_t d;
+    cmnd_bin_t b;
     state_t s;
+    u8 err = CMND_ERR_TRUNCATED;
+
+    const u32 decodeStarted = micros();
 
-    // command processing
-    s.action = *payload; // ACTION
+    o_bTaken = false;
 
-    if (false == CMNDS_decodeCmnd(payload, s)) {
-        IF_DEB_L() {
-            String str(F(" - failed, message ignored !"));
-            SERIAL_publish(str.c_str());
+    do {
+        if (length < CMNDS_BIN_MIN_LENGTH)
+            break;
+
+        u16 crc = ((u16)payload[length - 2] << 8) | payload[length - 1];
+        if (crc != CRC16.ccitt(payload, length - 2)) {
+            err = CMND_ERR_SUM;
+            break;
         }
-        return false;
+
+        s.action = payload[1];
+        b.command = payload[2];
+        b.channel = payload[3];
+
+        u8 countLen = cmnds_decodeVarint(payload + 4, length - 2 - 4, b.count);
+        if (0 == countLen)
+            break;
+
+        b.args = payload + 4 + countLen;
+        b.args_len = length - 2 - 4 - countLen;
+
+        if (false == cmnds_getDispatch(s.action, d)) {
+            err = CMND_ERR_NO_MODULE;
+            break;
+        }
+
+        if (NULL == d.m_cmnd_bin_decoder) {
+            err = CMND_ERR_NO_DECODER;
+            break;
+        }
+
+        if (false == d.m_cmnd_bin_decoder(b, s)) {
+            err = CMND_ERR_RANGE;
+            break;
+        }
+
+        const u32 decodeUs = micros() - decodeStarted;
+
+#if 1 == N32_CFG_CMND_QUEUE_ENABLED
+        if (true == i_bDefer) {
+            if (true == CQUEUE_Push(s, CQUEUE_NOT_IN_BATCH, i_uCorrId, decodeUs, cmnds_takeReceivedUs())) {
+                o_bTaken = true;
+                return true; // ack is published after the execution
+            }
+
+            if (CMNDS_NO_CORR_ID != i_uCorrId)
+                CMNDS_PublishAck(i_uCorrId, CMND_ERR_QUEUE_FULL, decodeUs, 0);
+            return false;
+        }
+#endif // N32_CFG_CMND_QUEUE_ENABLED
+
+        const u32 execStarted = micros();
+        LAT_BeginCommand(cmnds_takeReceivedUs());
+        const bool bOk = cmnds_execute(d, s);
+        o_bTaken = true;
+
+        if (CMNDS_NO_CORR_ID != i_uCorrId)
+            CMNDS_PublishAck(i_uCorrId, (true == bOk) ? CMND_ERR_NONE : CMND_ERR_EXEC,
+                decodeUs, micros() - execStarted);
+
+        if (false == bOk) {
+            TRACE_L(TRC_CMNDS_EXEC_FAILED, s.action);
+            return false;
+        }
+
+        return true;
+    } while (0);
+
+    IF_DEB_W() {
+        String str(F("CMNDS: bad binary frame, length="));
+        str += length;
+        str += F(", err=");
+        str += err;
+        DEB_W(str);
     }
 
-    if (false == CMNDS_executeCmnd(s)) {
-        IF_DEB_L() {
-            String str(F(" cmnd execution failed!"));
-            SERIAL_publish(str.c_str());
+    if (CMNDS_NO_CORR_ID != i_uCorrId)
+        CMNDS_PublishAck(i_uCorrId, err, micros() - decodeStarted, 0);
+
+    return false;
+}
+
+bool CMNDS_LaunchBinary(const byte* payload, unsigned int length) {
+    bool bTaken;
+    return cmnds_launchBinary(payload, length, false, CMNDS_NO_CORR_ID, bTaken);
+}
+
+/// @brief Handles frame prefixes and launches the frame
+/// @param i_cModule module letter given by the topic, 0 for the common commands topic
+/// @param payload frame
+/// @param length frame length
+/// @return a result of the operation
+static bool cmnds_submitFrame(char i_cModule, const byte* payload, unsigned int length) {
+    // without the queue, commands are just executed in place
+    const bool bDefer = (1 == N32_CFG_CMND_QUEUE_ENABLED);
+    u16 corrId = CMNDS_NO_CORR_ID;
+    char sender = 0;
+    u32 epoch = 0;
+    u16 seq = 0;
+    cmnd_reader_t r;
+
+    if (0 == length)
+        return false;
+
+    CR_Init(r, payload, length);
+
+    // optional prefixes, sequence number first
+    if ((CMNDS_SEQ_MARKER == CR_Peek(r) && false == cmnds_readSeq(r, sender, epoch, seq))
+        || (CMNDS_CORR_ID_MARKER == CR_Peek(r) && false == cmnds_readCorrId(r, corrId))) {
+        // without the id, there is nothing to put in the ack
+        IF_DEB_W() {
+            String str(F("CMNDS: bad frame prefix, err="));
+            str += r.m_err;
+            DEB_W(str);
         }
         return false;
     }
 
-    return true;
+    if (0 != sender && true == cmnds_isDuplicate(sender, epoch, seq)) {
+        TRACE_L(TRC_CMNDS_DUPLICATE, sender, seq);
+        if (CMNDS_NO_CORR_ID != corrId)
+            CMNDS_PublishAck(corrId, CMND_ERR_DUPLICATE, 0, 0);
+        return true; // it has been handled already
+    }
+
+    payload = r.m_pos;
+    length = r.m_left;
+
+    if (0 == length) {
+        if (CMNDS_NO_CORR_ID != corrId)
+            CMNDS_PublishAck(corrId, CMND_ERR_TRUNCATED, 0, 0);
+        return false;
+    }
+
+    bool bRet;
+    bool bTaken;
+
+    // batch and binary frames carry module letters of their own, batch replies on its own too
+    if (0 != i_cModule)
+        bRet = cmnds_launch(payload, length, bDefer, corrId, bTaken, i_cModule);
+    else if (CMNDS_BATCH_MARKER == payload[0])
+        bRet = cmnds_launchBatch(payload, length, bDefer, bTaken);
+    else if (CMNDS_BIN_MARKER == payload[0])
+        bRet = cmnds_launchBinary(payload, length, bDefer, corrId, bTaken);
+    else
+        bRet = cmnds_launch(payload, length, bDefer, corrId, bTaken);
+
+    // a frame rejected before anything ran or got queued (i.e. queue full) can be resent,
+    // and it's not a duplicate then. Once anything did, resending must not repeat it
+    if (0 != sender && true == bTaken)
+        cmnds_markSeen(sender, epoch, seq);
+
+    return bRet;
+}
+
+/// @brief Submits the frame, with its receipt time for the latency probe
+static bool cmnds_submit(char i_cModule, const byte* payload, unsigned int length) {
+    LatReceivedUs = LAT_TakeReceived();
+
+    const bool bRet = cmnds_submitFrame(i_cModule, payload, length);
+
+    // not taken by any command, as the frame wasn't executed
+    LatReceivedUs = LAT_NO_STAMP;
+
+    return bRet;
+}
+
+bool CMNDS_Submit(const byte* payload, unsigned int length) {
+    return cmnds_submit(0, payload, length);
+}
+
+bool CMNDS_SubmitToModule(char i_cModule, const byte* payload, unsigned int length) {
+    return cmnds_submit(i_cModule, payload, length);
 }
\ No newline at end of file
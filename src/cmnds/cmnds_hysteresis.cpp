@@ -3,6 +3,10 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "my_common.h"
+#include "mngr_modules.h"
+#include "cmnd_reader.h"
+#include "cmnds_core.h"
+#include "mngr_tasks.h"
 
 #if 1==N32_CFG_HISTERESIS_ENABLED
 
@@ -28,6 +32,7 @@
 #define HIST_MAX_TEMP_READ_IN_C (35)
 //#define HIST_TIME_SLOT_LENGTH 60
 #define HIST_TIME_SLOT_LENGTH 20
+#define HIST_SAFETY_PERIOD_IN_MS (1000UL) // over-temperature check, much more often than the control
 
 // 25C - 10k + 15K => 25K | 10/25 x/1024 => x= 10240/25= 410
 // 627/1024  9900/x => x= 9900 * 1024 / 636 = 16k3
@@ -130,6 +135,8 @@ debug_level_t HYSTERESIS_SetDebugLevel(debug_level_t i_uNewDebugLevel) {
     return prev;
 }
 
+static void hyst_SafetyCheck(void);
+
 void HYSTERESIS_ModuleInit(void) {
     PIN_RegisterPins(hyst_getPinFromChannelNum, HIST_NUM_OF_AVAIL_CHANNELS, F("HYST_OUT"));
 
@@ -148,6 +155,12 @@ void HYSTERESIS_ModuleInit(void) {
 
     for (channel = HIST_LINE_DH_COUNT; channel < HIST_NUM_OF_AVAIL_CHANNELS; channel++)
         hyst_SetupChannel(channel, LOW);
+
+#if 1 == N32_CFG_TASKS_ENABLED
+    TASK_Register(hyst_SafetyCheck, TASK_PRIO_SAFETY, HIST_SAFETY_PERIOD_IN_MS, 3000, 'H');
+#else
+    SETUP_RegisterTimer(HIST_SAFETY_PERIOD_IN_MS / 1000, hyst_SafetyCheck);
+#endif // N32_CFG_TASKS_ENABLED
 }
 
 static u32 getTempBasedOnR(u32 Rdev) {
@@ -338,6 +351,21 @@ static bool hist_Control(hist_slot_number_t i_SlotNumber) {
         return(true); // no change, currentTemp is between
 }
 
+// hist_Control checks the max temperature too, but only every HIST_TIME_SLOT_LENGTH secs.
+// This one runs as the most important task, not to wait for network or sensors
+static void hyst_SafetyCheck(void) {
+    _FOR(i, 0, HIST_NUM_OF_AVAIL_CHANNELS) {
+        if (false == hyst_isSlotActive(i))
+            continue;
+
+        if (HYSTERESIS_getTemp(i) > HIST_MAX_TEMP_READ_IN_C) {
+            hist_EmergencyShutdown();
+            THROW_ERROR();
+            return;
+        }
+    }
+}
+
 static void hyst_StartProcess(actions_context_t& i_rActionsContext) {
     IF_DEB_L() {
         String str(F("HIST: tick1!"));
@@ -345,17 +373,9 @@ static void hyst_StartProcess(actions_context_t& i_rActionsContext) {
         MSG_Publish_Debug(str.c_str());
     }
 
-    hist_slot_number_t slot = i_rActionsContext.var1;
-    if (true == hyst_isSlotActive(slot))
-        IF_DEB_W() {
-        String str(F(" WARN: hist: slot="));
-        str += slot;
-        str += F(" has already been started!");
-        MSG_Publish_Debug(str.c_str());
-    }
-
+    // called on start and then every HIST_TIME_SLOT_LENGTH, by the periodic timer
     // finally, we're executing actual (possible) heating here
-    hist_Control(slot);
+    hist_Control(i_rActionsContext.var1);
 }
 
 static void hyst_setNewFinishTime(hist_slot_number_t i_HistSlot, unsigned long secs) {
@@ -377,56 +397,44 @@ static void hyst_StopProcess(actions_context_t& i_rActionsContext) {
         return;
     }
 
-    // heating finished, so turning off
-    if (HIST_States[slot].time_end <= now()) {
-        IF_DEB_L() {
-            String str1(F("HIST: no more heating needed, shutting down slot"));
-            //DEBLN(str1);
-            MSG_Publish_Debug(str1.c_str());
-        }
-
-        if (false == hist_ShutDownChannel(slot)) {
-            hist_EmergencyShutdown();
-            THROW_ERROR();
-            return;
-        }
-
-        if (false == hyst_deallocateSlot(slot)) {
-            hist_EmergencyShutdown();
-            THROW_ERROR();
-            return;
-        }
-
-        return;
+    // the whole heating time passed (or heating was stopped), so turning off
+    IF_DEB_L() {
+        String str1(F("HIST: no more heating needed, shutting down slot"));
+        //DEBLN(str1);
+        MSG_Publish_Debug(str1.c_str());
     }
 
-    // conditions to get here:
-    // 1. user-provided time not passed yet
-    // 2. slot is ok
-    // 3. timeout HIST_TIME_SLOT_LENGTH happened
-    if (false == hist_Control(slot)) {
+    if (false == hist_ShutDownChannel(slot)) {
         hist_EmergencyShutdown();
         THROW_ERROR();
         return;
     }
 
-    IF_DEB_L() {
-        String str2(F("HIST: restarting timer="));
-        str2 += i_rActionsContext.timer_id;
-        str2 += F(", for ");
-        str2 += HIST_TIME_SLOT_LENGTH;
-        str2 += F(" secs. ");
-        MSG_Publish_Debug(str2.c_str());
-    }
-
-    // heating slot still active, so continuing
-    if (false == TIMER_ReStart(i_rActionsContext.timer_id, HIST_TIME_SLOT_LENGTH)) {
+    if (false == hyst_deallocateSlot(slot)) {
         hist_EmergencyShutdown();
         THROW_ERROR();
         return;
     }
 }
 
+/// @brief Stops heating on given channel, together with its timer if any is going
+/// @param i_SlotNumber hysteresis slot
+/// @return result of the operation
+static bool hyst_StopSlot(hist_slot_number_t i_SlotNumber) {
+    // stopping the timer calls hyst_StopProcess, which also releases the slot
+    if (true == hyst_isSlotActive(i_SlotNumber) && true == TIMER_IsActive(HIST_States[i_SlotNumber].timer_id))
+        if (false == TIMER_Stop(HIST_States[i_SlotNumber].timer_id)) {
+            hist_EmergencyShutdown();
+            THROW_ERROR();
+            return false; // with error
+        }
+
+    if (true == hyst_isSlotActive(i_SlotNumber))
+        hyst_deallocateSlot(i_SlotNumber);
+
+    return(hist_ShutDownChannel(i_SlotNumber));
+}
+
 static bool hyst_RetriggerOnAlreadyGoing(const state_t& s) {
     // ok, so we have a new command on already active channel
 
@@ -440,23 +448,8 @@ static bool hyst_RetriggerOnAlreadyGoing(const state_t& s) {
             MSG_Publish_Debug(str.c_str());
         }
 
-        // timer_id was set in the previous command on this channel, so we can use it here
-        if (false == TIMER_Stop(HIST_States[s.c.h.channel].timer_id)) {
-            hist_EmergencyShutdown();
-            THROW_ERROR();
-            return false; // with error
-        }
-
-        if (false == hist_ShutDownChannel(s.c.h.channel)) {
-            hist_EmergencyShutdown();
-            THROW_ERROR();
-            return false; // with error
-        }
-
         // the currently ongoing session is finished, right now
-        hyst_setNewFinishTime(s.c.h.channel, 0);
-
-        return true; // looks good
+        return(hyst_StopSlot(s.c.h.channel));
     }
 
     IF_DEB_L() {
@@ -469,7 +462,7 @@ static bool hyst_RetriggerOnAlreadyGoing(const state_t& s) {
         MSG_Publish_Debug(str.c_str());
     }
 
-    // ok, if got here, it means it's just the slot's timer restart
+    // ok, if got here, it means it's just the slot's timer restart, ticks keep their phase
     if (false == TIMER_ReStart(HIST_States[s.c.h.channel].timer_id, s.count)) {
         hist_EmergencyShutdown();
         THROW_ERROR();
@@ -495,7 +488,6 @@ bool HYST_ExecuteCommand(const state_t& s) {
 
     actions_t Actions = { 0 }; //{bin_ChannelTurnON, bin_ChannelTurnOFF};
     actions_context_t ActionsContext = { 0 };
-    state_t _s = s;
 
     ActionsContext.slot = s.c.h.channel;
     ActionsContext.timer_id = 0;
@@ -512,12 +504,8 @@ bool HYST_ExecuteCommand(const state_t& s) {
 
         case CMND_HIST_H1_START_HEATING:
             // is it just stopping?
-            if (0 == s.count) {
-                if (true == hyst_isSlotActive(s.c.h.channel))
-                    hyst_deallocateSlot(s.c.h.channel);
-
-                return(hist_ShutDownChannel(s.c.h.channel));
-            }
+            if (0 == s.count)
+                return(hyst_StopSlot(s.c.h.channel));
 
             // is some action already going on that slot?
             if (true == hyst_isSlotActive(s.c.h.channel))
@@ -532,12 +520,12 @@ bool HYST_ExecuteCommand(const state_t& s) {
             HIST_States[HistSlot].temp_low = s.c.h.low;
             HIST_States[HistSlot].temp_high = s.c.h.high;
             hyst_setNewFinishTime(HistSlot, s.count); // s.count is whole action length
-            _s.count = HIST_TIME_SLOT_LENGTH; // but we want to restart each HIST_TIME_SLOT_LENGTH
 
             ActionsContext.var1 = HistSlot;
             ActionsContext.var2 = 0; // not used
 
-            if (false == CMNDS_ScheduleAction(_s, Actions, ActionsContext)) {
+            // controlling each HIST_TIME_SLOT_LENGTH, till the whole action length passes
+            if (false == CMNDS_SchedulePeriodicAction(s, Actions, ActionsContext, HIST_TIME_SLOT_LENGTH)) {
                 hyst_deallocateSlot(HistSlot);
                 THROW_ERROR();
                 return(false);
@@ -556,9 +544,7 @@ bool HYST_ExecuteCommand(const state_t& s) {
             return(true);
 
         case CMND_HIST_H3_STOP_HEATING:
-            if (true == hyst_isSlotActive(s.c.h.channel))
-                hyst_deallocateSlot(s.c.h.channel);
-            return(hist_ShutDownChannel(s.c.h.channel));
+            return(hyst_StopSlot(s.c.h.channel));
 
         default:
         case CMND_HIST_H2_SHOW_TEMP:
@@ -577,24 +563,23 @@ bool HYST_ExecuteCommand(const state_t& s) {
  * H2x     - Show read temperatures in message broker (MQTT)
  * H3A     - Stop heating in channel 'A'
  */
-bool decode_CMND_H(const byte* payload, state_t& s, u8* o_CmndLen) {
-    const byte* cmndStart = payload;
+bool decode_CMND_H(cmnd_reader_t& r, state_t& s) {
     bool sanity_ok = false;
 
-    s.command = (*payload++) - '0';
-    s.c.h.channel = (*payload++) - '0';
+    s.command = CR_Digit(r);
+    s.c.h.channel = CR_Byte(r) - '0';
 
     u8 number = 0, scale = 0;
 
     switch (s.command) {
     case CMND_HIST_H1_START_HEATING:
-        s.c.h.low = 10 * ((*payload++) - '0'); // LL reading
-        s.c.h.low += 1 * ((*payload++) - '0');
-        s.c.h.high = 10 * ((*payload++) - '0'); // HH reading
-        s.c.h.high += 1 * ((*payload++) - '0');
+        s.c.h.low = 10 * CR_Digit(r); // LL reading
+        s.c.h.low += 1 * CR_Digit(r);
+        s.c.h.high = 10 * CR_Digit(r); // HH reading
+        s.c.h.high += 1 * CR_Digit(r);
 
-        number = (*payload++) - '0'; // [0..9] - number
-        scale = *payload++; // [SMTH] - Seconds/Minutes/TenMinutes/Hours
+        number = CR_Digit(r); // [0..9] - number
+        scale = CR_Byte(r); // [SMTH] - Seconds/Minutes/TenMinutes/Hours
         s.count = getSecondsFromNumberAndScale(number, scale);
         goto CONTINUE;
 
@@ -602,23 +587,32 @@ bool decode_CMND_H(const byte* payload, state_t& s, u8* o_CmndLen) {
     case CMND_HIST_H2_SHOW_TEMP:
     case CMND_HIST_H3_STOP_HEATING:
     default:
+        CR_Fail(r, CMND_ERR_RANGE);
         goto ERROR;
     }
 
 CONTINUE:
-    if (false == hyst_getPinFromChannelNum(s.c.h.channel, s.c.h.pin))
+    if (false == hyst_getPinFromChannelNum(s.c.h.channel, s.c.h.pin)) {
+        CR_Fail(r, CMND_ERR_RANGE);
         goto ERROR;
+    }
 
-    if (s.c.h.low >= s.c.h.high) // at least one 1C needed
+    if (s.c.h.low >= s.c.h.high) { // at least one 1C needed
+        CR_Fail(r, CMND_ERR_RANGE);
         goto ERROR;
+    }
+
+    s.sum = CR_Byte(r) - '0'; // sum = 1
 
-    s.sum = (*payload++) - '0'; // sum = 1
+    if (true == CR_IsOk(r))
+        if (s.c.h.low >= HIST_MIN_TEMP_IN_C && s.c.h.high <= HIST_MAX_TEMP_IN_C)
+            if (s.command < CMND_HIST_MAX_VALUE)
+                if (s.c.h.channel < HIST_NUM_OF_AVAIL_CHANNELS)
+                    if (true == isSumOk(s))
+                        sanity_ok = true;
 
-    if (s.c.h.low >= HIST_MIN_TEMP_IN_C && s.c.h.high <= HIST_MAX_TEMP_IN_C)
-        if (s.command >= 0 && s.command < CMND_HIST_MAX_VALUE)
-            if (s.c.h.channel >= 0 && s.c.h.channel < HIST_NUM_OF_AVAIL_CHANNELS)
-                if (true == isSumOk(s))
-                    sanity_ok = true;
+    if (false == sanity_ok)
+        CR_FailSanity(r, s);
 
 ERROR:
 
@@ -641,13 +635,13 @@ ERROR:
         MSG_Publish_Debug(str.c_str());
     }
 
-    // setting decoded and valid cmnd length
-    if (NULL != o_CmndLen)
-        *o_CmndLen = payload - cmndStart;
-
     return (sanity_ok);
 }
 
+bool decode_CMND_H(const byte* payload, state_t& s, u8* o_CmndLen) {
+    return CR_DecodeUnbounded(decode_CMND_H, payload, s, o_CmndLen);
+}
+
 void HIST_DisplayAssignments(void) {
     String str;
 
@@ -681,6 +675,30 @@ void HIST_DisplayAssignments(void) {
     MSG_Publish_Debug(str.c_str());
 }
 
+/// @brief Binary frame counterpart of decode_CMND_H, args: low and high temp (1 byte each).
+/// Same as in ASCII, only H1 is accepted
+/// @param i_rBin binary command fields
+/// @param s state to be filled
+/// @return true if the command is valid
+bool decodeBinary_CMND_H(const cmnd_bin_t& i_rBin, state_t& s) {
+    if (2 != i_rBin.args_len || CMND_HIST_H1_START_HEATING != i_rBin.command)
+        return false;
+
+    s.command = i_rBin.command;
+    s.c.h.channel = i_rBin.channel;
+    s.c.h.low = i_rBin.args[0];
+    s.c.h.high = i_rBin.args[1];
+    s.count = i_rBin.count;
+
+    if (false == hyst_getPinFromChannelNum(s.c.h.channel, s.c.h.pin))
+        return false;
+
+    if (s.c.h.low >= s.c.h.high) // at least one 1C needed
+        return false;
+
+    return (s.c.h.low >= HIST_MIN_TEMP_IN_C && s.c.h.high <= HIST_MAX_TEMP_IN_C);
+}
+
 module_caps_t HYST_getCapabilities(void) {
     module_caps_t mc = {
         .m_is_input = false,
@@ -3,11 +3,16 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "my_common.h"
+#include "mngr_modules.h"
+#include "cmnd_reader.h"
+#include "mngr_timers.h"
+#include "mngr_state.h"
+#include "mngr_latency.h"
 
 #if 1==N32_CFG_PWM_ENABLED
 
-#define PWM_FADE_IN_DELAY_IN_MS (3)
-#define PWM_FADE_OUT_DELAY_IN_MS (20)
+#define PWM_FADE_STEP_IN_MS (12)
+#define PWM_FADE_STEP_VALUE (4)
 #define PWM_MAX (0xFF)
 
 #ifdef DEBUG
@@ -25,23 +30,85 @@ static bool pwm_getPinFromChannelNum(u8 i_ChannelNumber, u8& o_PinNumber) {
     return false; // error, means function failed to execute command
 }
 
+static void pwm_Panic(u8 i_PhysicalPin) {
+    analogWrite(i_PhysicalPin, 0);
+}
+
+// fades are run by ms timers, so the loop is not blocked while fading
+static u8 pwm_Value[PWM_NUM_OF_AVAIL_CHANNELS];
+static u8 pwm_FadeTarget[PWM_NUM_OF_AVAIL_CHANNELS];
+static u8 pwm_FadeTimer[PWM_NUM_OF_AVAIL_CHANNELS];
+
+static void pwm_FadeStep(actions_context_t& i_rActionsContext) {
+    u8 channel = i_rActionsContext.var1, PhysicalPin;
+    if (false == pwm_getPinFromChannelNum(channel, PhysicalPin)) {
+        TIMER_MS_Stop(i_rActionsContext.timer_id);
+        THROW_ERROR();
+        return; // error, means function failed to execute command
+    }
+
+    u8 value = pwm_Value[channel];
+    u8 target = pwm_FadeTarget[channel];
+    if (value < target)
+        value = (target - value > PWM_FADE_STEP_VALUE) ? value + PWM_FADE_STEP_VALUE : target;
+    else if (value > target)
+        value = (value - target > PWM_FADE_STEP_VALUE) ? value - PWM_FADE_STEP_VALUE : target;
+
+    pwm_Value[channel] = value;
+    analogWrite(PhysicalPin, value);
+    LAT_MarkActuated(); // the first step of a fade started by a command
+
+    if (value == target)
+        TIMER_MS_Stop(i_rActionsContext.timer_id);
+}
+
+static void pwm_FadeDone(actions_context_t& i_rActionsContext) {
+    const u8 channel = i_rActionsContext.var1;
+    if (channel < PWM_NUM_OF_AVAIL_CHANNELS) {
+        pwm_FadeTimer[channel] = TIMER_NULL;
+
+        // only the final value, not fades interrupted by pwm_SetValue
+        if (pwm_Value[channel] == pwm_FadeTarget[channel])
+            STATE_PublishOutput(MQTT_T_STATE_PWM, channel, pwm_Value[channel]);
+    }
+}
+
+static void pwm_StartFade(u8 i_Channel, u8 i_Target) {
+    pwm_FadeTarget[i_Channel] = i_Target;
+
+    // ongoing fade just picks up the new target
+    if (TIMER_NULL != pwm_FadeTimer[i_Channel])
+        return;
+
+    actions_t Actions = { pwm_FadeStep, pwm_FadeDone };
+    actions_context_t ActionsContext = { 0 };
+    ActionsContext.var1 = i_Channel;
+
+    u8 timer_id = TIMER_MS_Start(Actions, ActionsContext, PWM_FADE_STEP_IN_MS, TIMER_SHOT_MULTIPLE);
+
+    // the first step may have already finished the fade
+    if (true == TIMER_MS_IsActive(timer_id))
+        pwm_FadeTimer[i_Channel] = timer_id;
+}
+
+static void pwm_SetValue(u8 i_Channel, u8 i_PhysicalPin, u8 i_Value) {
+    if (TIMER_NULL != pwm_FadeTimer[i_Channel])
+        TIMER_MS_Stop(pwm_FadeTimer[i_Channel]);
+
+    pwm_Value[i_Channel] = i_Value;
+    analogWrite(i_PhysicalPin, i_Value);
+    LAT_MarkActuated();
+    STATE_PublishOutput(MQTT_T_STATE_PWM, i_Channel, i_Value);
+}
+
 static void pwm_cmnd_FADE_IN(actions_context_t& i_rActionsContext) {
     u8 PhysicalPin;
     if (false == pwm_getPinFromChannelNum(i_rActionsContext.var1, PhysicalPin)) {
         THROW_ERROR();
         return; // error, means function failed to execute command
     }
-    if (0xFF != i_rActionsContext.var2)
-        while (i_rActionsContext.var2 < 255) {
-            i_rActionsContext.var2++;
-            analogWrite(PhysicalPin, i_rActionsContext.var2);
-            delay(PWM_FADE_IN_DELAY_IN_MS); // 50ms?
-        }
-    else
-        analogWrite(PhysicalPin, i_rActionsContext.var2);
-}
-static void pwm_Panic(u8 i_PhysicalPin) {
-    analogWrite(i_PhysicalPin, 0);
+
+    pwm_StartFade(i_rActionsContext.var1, PWM_MAX);
 }
 
 static void pwm_cmnd_FADE_OUT(actions_context_t& i_rActionsContext) {
@@ -52,14 +119,7 @@ static void pwm_cmnd_FADE_OUT(actions_context_t& i_rActionsContext) {
         return; // error, means function failed to execute command
     }
 
-    if (i_rActionsContext.var2 > 0)
-        while (i_rActionsContext.var2 > 0) {
-            i_rActionsContext.var2--;
-            analogWrite(PhysicalPin, i_rActionsContext.var2);
-            delay(PWM_FADE_IN_DELAY_IN_MS); // 50ms?
-        }
-    else
-        analogWrite(PhysicalPin, i_rActionsContext.var2);
+    pwm_StartFade(i_rActionsContext.var1, 0);
 }
 static void pwm_cmnd_ON_RANDOM(actions_context_t& i_rActionsContext) {
     u8 PhysicalPin;
@@ -70,7 +130,7 @@ static void pwm_cmnd_ON_RANDOM(actions_context_t& i_rActionsContext) {
     }
 
     i_rActionsContext.var2 = 128; // TODO: get random value here
-    analogWrite(PhysicalPin, i_rActionsContext.var2);
+    pwm_SetValue(i_rActionsContext.var1, PhysicalPin, i_rActionsContext.var2);
 }
 static void pwm_cmnd_ON(actions_context_t& i_rActionsContext) {
     u8 PhysicalPin;
@@ -81,7 +141,7 @@ static void pwm_cmnd_ON(actions_context_t& i_rActionsContext) {
     }
 
     i_rActionsContext.var2 = 0xFF;
-    analogWrite(PhysicalPin, i_rActionsContext.var2);
+    pwm_SetValue(i_rActionsContext.var1, PhysicalPin, i_rActionsContext.var2);
 }
 static void pwm_cmnd_OFF(actions_context_t& i_rActionsContext) {
     u8 PhysicalPin;
@@ -92,7 +152,7 @@ static void pwm_cmnd_OFF(actions_context_t& i_rActionsContext) {
     }
 
     i_rActionsContext.var2 = 0x0;
-    analogWrite(PhysicalPin, i_rActionsContext.var2);
+    pwm_SetValue(i_rActionsContext.var1, PhysicalPin, i_rActionsContext.var2);
 }
 
 // TODO: finish for all pins
@@ -105,7 +165,7 @@ static void pwm_cmnd_ALL_ON(actions_context_t& i_rActionsContext) {
     }
 
     i_rActionsContext.var2 = 0xFF;
-    analogWrite(PhysicalPin, i_rActionsContext.var2);
+    pwm_SetValue(i_rActionsContext.var1, PhysicalPin, i_rActionsContext.var2);
 }
 static void pwm_cmnd_ALL_OFF(actions_context_t& i_rActionsContext) {
     u8 PhysicalPin;
@@ -116,7 +176,7 @@ static void pwm_cmnd_ALL_OFF(actions_context_t& i_rActionsContext) {
     }
 
     i_rActionsContext.var2 = 0x0;
-    analogWrite(PhysicalPin, i_rActionsContext.var2);
+    pwm_SetValue(i_rActionsContext.var1, PhysicalPin, i_rActionsContext.var2);
 }
 
 void pwm_SetupChannel(u8 i_uLogChannel) {
@@ -129,6 +189,10 @@ void pwm_SetupChannel(u8 i_uLogChannel) {
 
     pinMode(PhysicalPin, OUTPUT);
     analogWrite(PhysicalPin, LOW);
+
+    pwm_Value[i_uLogChannel] = 0;
+    pwm_FadeTarget[i_uLogChannel] = 0;
+    pwm_FadeTimer[i_uLogChannel] = TIMER_NULL;
 }
 
 void PWM_ModuleInit(void) {
@@ -138,6 +202,16 @@ void PWM_ModuleInit(void) {
     PIN_RegisterPins(pwm_getPinFromChannelNum, PWM_NUM_OF_AVAIL_CHANNELS, F("PWM"));
 }
 
+#if 1 == N32_CFG_RETAINED_STATE_ENABLED
+/// @brief Publishes retained values of all channels, fade targets for fading ones
+void PWM_PublishStates(void) {
+    _FOR(channel, 0, PWM_NUM_OF_AVAIL_CHANNELS) {
+        const bool bFading = (TIMER_NULL != pwm_FadeTimer[channel]);
+        STATE_PublishOutput(MQTT_T_STATE_PWM, channel, bFading ? pwm_FadeTarget[channel] : pwm_Value[channel]);
+    }
+}
+#endif // N32_CFG_RETAINED_STATE_ENABLED
+
 /**
  * PA1xxxNS - Channel "A" is on (== 100%) for NS secs
  * PA2xxxNS - Fade in in channel "A" ( from current to fully light).
@@ -186,7 +260,7 @@ bool PWM_ExecuteCommand(const state_t& s) {
             return (false);              // NOT IMPLEMENTED YET
 
         case CMND_PWM_SET_CHANNEL: // DONE
-            analogWrite(s.c.p.pin, map(s.c.p.percentage, 0, 100, 0, 255));
+            pwm_SetValue(s.c.p.channel, s.c.p.pin, map(s.c.p.percentage, 0, 100, 0, 255));
             // CHANNELS_States[s.c.p.channel].last_cmd = s.c.p.command;
             return (true);
 
@@ -214,32 +288,37 @@ bool PWM_ExecuteCommand(const state_t& s) {
  * all channels for NS secs P8Axxxyy - Reset channel "A" to default state
  * P9Axxxyy - Reset all channels to default state
  */
-bool decode_CMND_P(const byte* payload, state_t& s, u8* o_CmndLen) {
-    const byte* cmndStart = payload;
-
-    s.command = (*payload++) - '0';     // [0..8] - command
-    s.c.p.channel = (*payload++) - '0'; // [0..9] - Channel
-
-    s.c.p.percentage = 100 * ((*payload++) - '0'); // [0..1] - percentage
-    s.c.p.percentage += 10 * ((*payload++) - '0'); // [0..9] - percentage
-    s.c.p.percentage += (*payload++) - '0';        // [0..9] - percentage
-
-    char number = (*payload++) - '0'; // [0..9] - number
-    char scale = *payload++; // [SMTH] - Seconds/Minutes/TenMinutes/Hours
+bool decode_CMND_P(cmnd_reader_t& r, state_t& s) {
+    s.command = CR_Digit(r);            // [0..8] - command
+    s.c.p.channel = CR_Byte(r) - '0';   // [0..9] - Channel
+
+    // u16, so "999" doesn't wrap around into the range
+    u16 percentage = 100 * CR_Digit(r); // [0..1] - percentage
+    percentage += 10 * CR_Digit(r);     // [0..9] - percentage
+    percentage += CR_Digit(r);          // [0..9] - percentage
+    s.c.p.percentage = (percentage <= 100) ? percentage : PWM_MAX;
+
+    char number = CR_Digit(r); // [0..9] - number
+    char scale = CR_Byte(r); // [SMTH] - Seconds/Minutes/TenMinutes/Hours
     s.count = getSecondsFromNumberAndScale(number, scale);
 
     bool sanity_ok = false;
 
     if (true == pwm_getPinFromChannelNum(s.c.p.channel, s.c.p.pin)) {
-        s.sum = (*payload++) - '0'; // sum = 1
+        s.sum = CR_Byte(r) - '0'; // sum = 1
 
-        if (s.command >= 0 && s.command <= CMND_PWM_MAX_VALUE)
-            if (s.c.p.channel >= 0 && s.c.p.channel < PWM_NUM_OF_AVAIL_CHANNELS)
-                if (s.c.p.percentage >= 0 && s.c.p.percentage <= 100)
-                    if (number >= 0 && number <= 9)
+        if (true == CR_IsOk(r))
+            if (s.command <= CMND_PWM_MAX_VALUE)
+                if (s.c.p.channel < PWM_NUM_OF_AVAIL_CHANNELS)
+                    if (s.c.p.percentage <= 100)
                         if (true == isSumOk(s))
                             sanity_ok = true;
+
+        if (false == sanity_ok)
+            CR_FailSanity(r, s);
     }
+    else
+        CR_Fail(r, CMND_ERR_RANGE);
 
     // Info display
 #if 1==DEBUG_LOCAL
@@ -259,13 +338,34 @@ bool decode_CMND_P(const byte* payload, state_t& s, u8* o_CmndLen) {
     MSG_Publish_Debug(str.c_str());
 #endif // DEBUG_LOCAL
 
-    // setting decoded and valid cmnd length
-    if (NULL != o_CmndLen)
-        *o_CmndLen = payload - cmndStart;
-
     return (sanity_ok);
 }
 
+bool decode_CMND_P(const byte* payload, state_t& s, u8* o_CmndLen) {
+    return CR_DecodeUnbounded(decode_CMND_P, payload, s, o_CmndLen);
+}
+
+/// @brief Binary frame counterpart of decode_CMND_P, args: percentage (1 byte)
+/// @param i_rBin binary command fields
+/// @param s state to be filled
+/// @return true if the command is valid
+bool decodeBinary_CMND_P(const cmnd_bin_t& i_rBin, state_t& s) {
+    if (1 != i_rBin.args_len)
+        return false;
+
+    s.command = i_rBin.command;
+    s.c.p.channel = i_rBin.channel;
+    s.c.p.percentage = i_rBin.args[0];
+    s.count = i_rBin.count;
+
+    if (s.command <= CMND_PWM_MAX_VALUE)
+        if (s.c.p.channel < PWM_NUM_OF_AVAIL_CHANNELS)
+            if (s.c.p.percentage <= 100)
+                return pwm_getPinFromChannelNum(s.c.p.channel, s.c.p.pin);
+
+    return false;
+}
+
 module_caps_t PWM_getCapabilities(void) {
     module_caps_t mc = {
         .m_is_input = false,
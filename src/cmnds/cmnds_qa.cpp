@@ -4,6 +4,7 @@
 
 #include "my_common.h"
 #include "eeprom_wear.h"
+#include "cmnds_core.h"
 
 #if 1 == N32_CFG_QUICK_ACTIONS_ENABLED
 
@@ -173,8 +174,17 @@ static bool qa_StoreConfiguration(const byte* command, const triplet_t& i_t, u8
 }
 
 // Q0 I111 L201M1 1
-static bool qa_AnalyzeCommand(const byte* command, triplet_t& o_t, u8& o_src_cmndLen, u8& o_dst_cmndLen) {
-    //decodedLen = 0;
+static bool qa_AnalyzeCommand(cmnd_reader_t& r, triplet_t& o_t, u8& o_src_cmndLen, u8& o_dst_cmndLen) {
+    const byte* command = r.m_pos;
+
+    o_src_cmndLen = sizeof(triplet_t) + 1; // 3 bytes for triplet + 1 byte of checksum
+    o_dst_cmndLen = 0;
+
+    if (false == CR_IsOk(r)) // command number already broken
+        return false;
+
+    if (r.m_left < o_src_cmndLen)
+        return CR_Fail(r, CMND_ERR_TRUNCATED);
 
     if (false == qa_decodeTiplet(o_t, command)) {
         IF_DEB_L() {
@@ -186,24 +196,25 @@ static bool qa_AnalyzeCommand(const byte* command, triplet_t& o_t, u8& o_src_cmn
             str += command[2];
             MSG_Publish_Debug(str.c_str());
         }
-        return false;
+        return CR_Fail(r, CMND_ERR_RANGE);
     }
 
     state_t s; // value stored here will be ignored
-    o_src_cmndLen = sizeof(triplet_t) + 1; // 3 bytes for triplet + 1 byte of checksum
-    o_dst_cmndLen = 0;
 
     command += o_src_cmndLen; // for now source command is stored as a triplet, so skipping
 
-    // let's try to decode destination command
-    if (false == CMNDS_decodeCmnd(command, s, &o_dst_cmndLen)) {
+    // let's try to decode destination command, it can't go past the end of the outer one
+    cmnd_reader_t dst;
+    CR_Init(dst, command, r.m_left - o_src_cmndLen);
+
+    if (false == CMNDS_decodeCmnd(dst, s)) {
         IF_DEB_L() {
             String str(F("QA: bad decoding with a command"));
             MSG_Publish_Debug(str.c_str());
         }
-        return false;
+        return CR_Fail(r, dst.m_err);
     }
-    o_dst_cmndLen += 1; // TODO: why is this needed?
+    o_dst_cmndLen = CR_Consumed(dst, command); // module letter included
 
     IF_DEB_T() {
         String str(F("QA: decoded dest length: '"));
@@ -237,10 +248,11 @@ static bool qa_RemoveCommand(const byte* command, u8& decodedLen) {
     if (true == QA_isStateTracked(t._topic, t._channel, t._value, slotNumber)) {
         struct eeprom_wear_s<struct myConfigData_s> ee;
 
-        e2prom_cfg.entries[slotNumber] = e2prom_cfg.entries[e2prom_cfg.num_of_valid_entries];
-
+        // the last entry takes the place of the removed one
         --e2prom_cfg.num_of_valid_entries;
 
+        e2prom_cfg.entries[slotNumber] = e2prom_cfg.entries[e2prom_cfg.num_of_valid_entries];
+
         // final write
         ee.writeCfgAbs(e2prom_cfg, 0);
 
@@ -312,19 +324,17 @@ void QA_DisplayAssignments(void) {
  * Q3         - Disable all quick actions
  * Q4         - Enable all quick actions
  */
-bool decode_CMND_Q(const byte* payload, state_t& s, u8* o_CmndLen) {
-    const byte* cmndStart = payload;
-
-    u8 src_cmndLen, dst_cmndLen;
+bool decode_CMND_Q(cmnd_reader_t& r, state_t& s) {
+    u8 src_cmndLen = 0, dst_cmndLen = 0;
     triplet_t t;
 
-    s.command = (*payload++) - '0'; // 0..4
+    s.command = CR_Digit(r); // 0..4
     bool sanity_ok = false;
 
     switch (s.command) {
     case CMND_QA_REGISTER_NEW_CMND:
     case CMND_QA_REMOVE_CMND:
-        sanity_ok = qa_AnalyzeCommand(payload, t, src_cmndLen, dst_cmndLen);
+        sanity_ok = qa_AnalyzeCommand(r, t, src_cmndLen, dst_cmndLen);
         break;
 
     case CMND_QA_CLEAR_ALL_CMNDS:
@@ -334,6 +344,7 @@ bool decode_CMND_Q(const byte* payload, state_t& s, u8* o_CmndLen) {
         break;
 
     default:
+        CR_Fail(r, CMND_ERR_RANGE);
         break;
     }
 
@@ -345,28 +356,30 @@ bool decode_CMND_Q(const byte* payload, state_t& s, u8* o_CmndLen) {
         // _FOR(i, 0, 15)
         //     DEB((char)payload[i]);
 
-        const byte* cmnd_base = payload;
+        const byte* cmnd_base = r.m_pos;
 
         decodedCmndLen = src_cmndLen + dst_cmndLen;
-        payload += decodedCmndLen;
+        CR_Skip(r, decodedCmndLen);
 
         // DEB("\n----------------- in decoder3:\n");
         // _FOR(i, 0, 15)
         //     DEB((char)payload[i]);
 
-        s.sum = (*payload++) - '0'; // sum = 1
+        s.sum = CR_Byte(r) - '0'; // sum = 1
 
-        String str(F("\nQA: s.sum= "));
-        str += s.sum;
-        str += F(", payload -1: '");
-        str += char(*(payload - 1));
-        str += F(", payload: '");
-        str += char(*(payload));
-        str += F("', decodedCmndLen: ");
-        str += decodedCmndLen;
-        MSG_Publish_Debug(str.c_str());
+        IF_DEB_T() {
+            String str(F("\nQA: s.sum= "));
+            str += s.sum;
+            str += F(", decodedCmndLen: ");
+            str += decodedCmndLen;
+            MSG_Publish_Debug(str.c_str());
+        }
 
-        if (true == (sanity_ok = isSumOk(s))) {
+        if (false == CR_IsOk(r) || false == isSumOk(s)) {
+            CR_FailSanity(r, s);
+            sanity_ok = false;
+        }
+        else {
             // it's ok, so change the states
             switch (s.command) {
             case CMND_QA_REGISTER_NEW_CMND:
@@ -392,6 +405,9 @@ bool decode_CMND_Q(const byte* payload, state_t& s, u8* o_CmndLen) {
             default:
                 break;
             }
+
+            if (false == sanity_ok)
+                CR_Fail(r, CMND_ERR_EXEC);
         }
     }
 
@@ -408,13 +424,13 @@ bool decode_CMND_Q(const byte* payload, state_t& s, u8* o_CmndLen) {
         MSG_Publish_Debug(str.c_str());
     }
 
-    // setting decoded and valid cmnd length
-    if (NULL != o_CmndLen)
-        *o_CmndLen = payload - cmndStart;
-
     return (sanity_ok);
 }
 
+bool decode_CMND_Q(const byte* payload, state_t& s, u8* o_CmndLen) {
+    return CR_DecodeUnbounded(decode_CMND_Q, payload, s, o_CmndLen);
+}
+
 module_caps_t QA_getCapabilities(void) {
     module_caps_t mc = {
         .m_is_input = false,
@@ -0,0 +1,315 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "my_common.h"
+#include "eeprom_wear.h"
+#include "mngr_modules.h"
+#include "cmnd_reader.h"
+#include "cmnds_core.h"
+#include "cmnds_schedule.h"
+
+#if 1 == N32_CFG_SCHEDULE_ENABLED
+
+// Module name: SCHEDULE
+// Module aim: to launch stored commands at given wall-clock times (i.e. nightly irrigation,
+// morning heating), without the broker and network being up at that moment.
+//
+// Entries are checked against NTP time by a TimeAlarms timer, every SCHED_CHECK_INTERVAL_IN_S.
+// Each entry fires at most once per its minute.
+
+static debug_level_t uDebugLevel = DEBUG_WARN;
+
+struct sched_entry_s {
+    u8 hour;     // [0..23]
+    u8 minute;   // [0..59]
+    u8 days;     // bit (weekday() - 1) set: fires that day, bit 0 is Sunday
+    u8 cmnd_len;
+    u8 cmnd[SCHED_MAX_CMND_LENGTH];
+};
+struct sched_cfg_s {
+    u8 num_of_valid_entries;
+    sched_entry_s entries[SCHED_MAX_ENTRIES];
+};
+
+static struct sched_cfg_s e2prom_sched;
+static u32 LastFiredMinute[SCHED_MAX_ENTRIES]; // minutes since epoch, not to fire twice in a minute
+
+static void sched_AlarmFun(void) {
+    if (timeStatus() != timeSet)
+        return; // no wall-clock yet
+
+    const time_t t = now();
+    const u32 minuteStamp = t / 60;
+
+    _FOR(i, 0, e2prom_sched.num_of_valid_entries) {
+        struct sched_entry_s& e = e2prom_sched.entries[i];
+
+        if (e.hour != hour(t) || e.minute != minute(t))
+            continue;
+
+        if (0 == (e.days & (1 << (weekday(t) - 1))) || LastFiredMinute[i] == minuteStamp)
+            continue;
+
+        LastFiredMinute[i] = minuteStamp;
+
+        IF_DEB_L() {
+            String str(F("SCHED: firing entry: "));
+            str += i;
+            MSG_Publish_Debug(str.c_str());
+        }
+
+        if (false == CMNDS_Launch(e.cmnd)) {
+            IF_DEB_W() {
+                String str(F("SCHED: entry failed: "));
+                str += i;
+                MSG_Publish_Debug(str.c_str());
+            }
+        }
+    }
+}
+
+void SCHED_ModuleInit(void) {
+    struct eeprom_wear_s<struct sched_cfg_s> ee;
+
+    if (false == ee.readCfgAbs(e2prom_sched, SCHED_EEPROM_OFFSET)
+        || e2prom_sched.num_of_valid_entries > SCHED_MAX_ENTRIES) {
+        // nothing read
+        e2prom_sched.num_of_valid_entries = 0;
+    }
+
+    _FOR(i, 0, SCHED_MAX_ENTRIES)
+        LastFiredMinute[i] = 0;
+
+    SETUP_RegisterTimer(SCHED_CHECK_INTERVAL_IN_S, sched_AlarmFun);
+
+    // Info display
+    IF_DEB_L() {
+        String str(F("SCHED: init with: "));
+        str += e2prom_sched.num_of_valid_entries;
+        str += F(" entries.");
+        MSG_Publish_Debug(str.c_str());
+    }
+}
+
+static bool sched_AddEntry(const struct sched_entry_s& i_rEntry) {
+    struct eeprom_wear_s<struct sched_cfg_s> ee;
+
+    u8 count = e2prom_sched.num_of_valid_entries;
+    if (count >= SCHED_MAX_ENTRIES) {
+        IF_DEB_W() {
+            String str(F("SCHED: no more free entries available!"));
+            MSG_Publish_Debug(str.c_str());
+        }
+        return false;
+    }
+
+    e2prom_sched.entries[count] = i_rEntry;
+    LastFiredMinute[count] = 0;
+    e2prom_sched.num_of_valid_entries++;
+
+    // final write
+    ee.writeCfgAbs(e2prom_sched, SCHED_EEPROM_OFFSET);
+
+    return true;
+}
+
+static bool sched_RemoveEntry(u8 i_uIndex) {
+    struct eeprom_wear_s<struct sched_cfg_s> ee;
+
+    if (i_uIndex >= e2prom_sched.num_of_valid_entries)
+        return false;
+
+    // order doesn't matter, so the last entry takes the place of removed one
+    --e2prom_sched.num_of_valid_entries;
+    e2prom_sched.entries[i_uIndex] = e2prom_sched.entries[e2prom_sched.num_of_valid_entries];
+    LastFiredMinute[i_uIndex] = LastFiredMinute[e2prom_sched.num_of_valid_entries];
+
+    // final write
+    ee.writeCfgAbs(e2prom_sched, SCHED_EEPROM_OFFSET);
+
+    return true;
+}
+
+static bool sched_RemoveAll(void) {
+    struct eeprom_wear_s<struct sched_cfg_s> ee;
+
+    e2prom_sched.num_of_valid_entries = 0;
+
+    // final write
+    ee.writeCfgAbs(e2prom_sched, SCHED_EEPROM_OFFSET);
+
+    return true;
+}
+
+void SCHED_DisplayAssignments(void) {
+    {
+        String str(F("\nSchedule entries:\n-=-=-=-=-="));
+        MSG_Publish_Debug(str.c_str());
+    }
+
+    _FOR(i, 0, e2prom_sched.num_of_valid_entries) {
+        struct sched_entry_s& e = e2prom_sched.entries[i];
+
+        String str = F("");
+        str += i;
+        str += F(": ");
+        str += e.hour;
+        str += F(":");
+        str += e.minute;
+        str += F(", days=");
+        str += String(e.days, HEX);
+        str += F(", cmnd='");
+        _FOR(j, 0, e.cmnd_len)
+            str += (char)e.cmnd[j];
+        str += F("'");
+        MSG_Publish_Debug(str.c_str());
+    }
+
+    String str = F("Total entries: ");
+    str += e2prom_sched.num_of_valid_entries;
+    str += F("\n");
+    MSG_Publish_Debug(str.c_str());
+}
+
+/// @brief Reads "HHMMDD<cmnd>" of C0, the stored command is validated by its module
+/// @param r reader placed at HH
+/// @param o_rEntry entry to be filled
+/// @return false if any field is bad
+static bool sched_ReadEntry(cmnd_reader_t& r, struct sched_entry_s& o_rEntry) {
+    memset(&o_rEntry, 0, sizeof(o_rEntry));
+
+    o_rEntry.hour = 10 * CR_Digit(r);
+    o_rEntry.hour += CR_Digit(r);
+    o_rEntry.minute = 10 * CR_Digit(r);
+    o_rEntry.minute += CR_Digit(r);
+    o_rEntry.days = CR_HexDigit(r) << 4;
+    o_rEntry.days |= CR_HexDigit(r);
+
+    if (false == CR_IsOk(r))
+        return false;
+
+    if (o_rEntry.hour > 23 || o_rEntry.minute > 59 || 0 == o_rEntry.days || o_rEntry.days > 0x7F)
+        return CR_Fail(r, CMND_ERR_RANGE);
+
+    // modules acting already while decoding can't be scheduled
+    const byte* cmnd = r.m_pos;
+    if ('C' == CR_Peek(r) || 'Q' == CR_Peek(r))
+        return CR_Fail(r, CMND_ERR_RANGE);
+
+    // the command can't go past the end of the outer one
+    cmnd_reader_t nested;
+    CR_Init(nested, cmnd, r.m_left);
+
+    state_t s; // value stored here will be ignored
+    if (false == CMNDS_decodeCmnd(nested, s))
+        return CR_Fail(r, nested.m_err);
+
+    const u8 cmndLen = CR_Consumed(nested, cmnd);
+    if (cmndLen > SCHED_MAX_CMND_LENGTH)
+        return CR_Fail(r, CMND_ERR_RANGE);
+
+    o_rEntry.cmnd_len = cmndLen;
+    memcpy(o_rEntry.cmnd, cmnd, cmndLen);
+
+    return CR_Skip(r, cmndLen);
+}
+
+/**
+ * C0HHMMDD<cmnd>S - Add an entry launching <cmnd> at HH:MM on days DD. DD is a hex mask of
+ *                   week days, bit 0 is Sunday, i.e. "7F" - every day, "3E" - Monday to Friday
+ * C1NS           - Remove N-th entry
+ * C2S            - Clear all entries
+ * C3S            - Show entries in message broker (debug topic)
+ */
+bool decode_CMND_C(cmnd_reader_t& r, state_t& s) {
+    struct sched_entry_s e;
+    u8 index = 0;
+    bool sanity_ok = false;
+
+    s.command = CR_Digit(r); // [0..3] - command
+
+    switch (s.command) {
+    case CMND_SCHED_C0_ADD_ENTRY:
+        sanity_ok = sched_ReadEntry(r, e);
+        break;
+
+    case CMND_SCHED_C1_REMOVE_ENTRY:
+        index = CR_Digit(r);
+        sanity_ok = CR_IsOk(r);
+        break;
+
+    case CMND_SCHED_C2_CLEAR_ALL:
+    case CMND_SCHED_C3_SHOW_ENTRIES:
+        sanity_ok = CR_IsOk(r);
+        break;
+
+    default:
+        CR_Fail(r, CMND_ERR_RANGE);
+        break;
+    }
+
+    if (true == sanity_ok) {
+        s.sum = CR_Byte(r) - '0'; // sum = 1
+
+        if (false == CR_IsOk(r) || false == isSumOk(s)) {
+            CR_FailSanity(r, s);
+            sanity_ok = false;
+        }
+        else {
+            // it's ok, so change the table
+            switch (s.command) {
+            case CMND_SCHED_C0_ADD_ENTRY:
+                sanity_ok = sched_AddEntry(e);
+                break;
+
+            case CMND_SCHED_C1_REMOVE_ENTRY:
+                sanity_ok = sched_RemoveEntry(index);
+                break;
+
+            case CMND_SCHED_C2_CLEAR_ALL:
+                sanity_ok = sched_RemoveAll();
+                break;
+
+            case CMND_SCHED_C3_SHOW_ENTRIES:
+                SCHED_DisplayAssignments();
+                break;
+            }
+
+            if (false == sanity_ok)
+                CR_Fail(r, CMND_ERR_EXEC);
+        }
+    }
+
+    // Info display
+    IF_DEB_L() {
+        String str(F("SCHED: Cmd: "));
+        str += s.command;
+        str += F(", Sanity: ");
+        str += sanity_ok;
+        str += F(", err: ");
+        str += r.m_err;
+        MSG_Publish_Debug(str.c_str());
+    }
+
+    return (sanity_ok);
+}
+
+bool decode_CMND_C(const byte* payload, state_t& s, u8* o_CmndLen) {
+    return CR_DecodeUnbounded(decode_CMND_C, payload, s, o_CmndLen);
+}
+
+module_caps_t SCHED_getCapabilities(void) {
+    module_caps_t mc = {
+        .m_is_input = false,
+        .m_number_of_channels = 0,
+        .m_module_name = F("SCHED"),
+        .m_mod_init = SCHED_ModuleInit,
+        .m_cmnd_decoder = decode_CMND_C,
+        .m_cmnd_executor = 0
+    };
+
+    return(mc);
+}
+
+#endif // N32_CFG_SCHEDULE_ENABLED
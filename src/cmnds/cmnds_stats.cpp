@@ -0,0 +1,187 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "my_common.h"
+#include "mngr_modules.h"
+#include "cmnd_reader.h"
+#include "cmnds_stats.h"
+#include "mngr_timer_stats.h"
+#include "mngr_cmnd_queue.h"
+#include "mngr_pub_queue.h"
+#include "mqtt_publish.h"
+#include "mngr_latency.h"
+#include "mngr_tasks.h"
+#include "mngr_profiler.h"
+
+#if 1 == N32_CFG_STATS_ENABLED
+
+// Module name: STATS
+// Module aim: to expose runtime statistics (timers lateness, callbacks duration, commands queue, ...) on request
+
+static debug_level_t uDebugLevel = DEBUG_WARN;
+
+#if defined(__AVR__)
+// avr-libc malloc internals, free blocks list
+struct heap_free_s {
+    size_t sz; // size without the header
+    struct heap_free_s* nx;
+};
+extern "C" struct heap_free_s* __flp;
+extern "C" char* __brkval;
+extern char __heap_start;
+#endif // __AVR__
+
+/// @brief Publishes "free,largest,frag%" on the heap stats topic. Free memory is the gap
+/// between heap and stack plus blocks on malloc free list, fragmentation is the part
+/// of it that can't be allocated at once
+/// @return result of queueing
+static bool stats_PublishHeap(void) {
+#if defined(__AVR__)
+    const char* heapEnd = (0 != __brkval) ? __brkval : &__heap_start;
+    const u16 gap = (u16)((char*)SP - heapEnd);
+
+    u16 total = gap;
+    u16 largest = gap;
+    for (struct heap_free_s* p = __flp; 0 != p; p = p->nx) {
+        total += p->sz;
+        if (p->sz > largest)
+            largest = p->sz;
+    }
+
+    const u8 frag = (0 == total) ? 0 : 100 - (u8)(((u32)largest * 100) / total);
+
+    MSG_Begin(MQTT_T_STATS_HEAP, MQTT_NO_CHANNEL);
+    MSG_AppendU32(total);
+    MSG_AppendChar(',');
+    MSG_AppendU32(largest);
+    MSG_AppendChar(',');
+    MSG_AppendU32(frag);
+
+    return MSG_Send();
+#else
+    return false; // not supported
+#endif // __AVR__
+}
+
+void STATS_ModuleInit(void) {
+    TSTATS_Reset();
+#if 1 == N32_CFG_CMND_QUEUE_ENABLED
+    CQUEUE_ResetStats();
+#endif // N32_CFG_CMND_QUEUE_ENABLED
+}
+
+bool STATS_ExecuteCommand(const state_t& s) {
+    switch (s.command) {
+    case CMND_STATS_S0_SHOW_TIMERS:
+        TSTATS_DisplayHistograms();
+        return true;
+
+    case CMND_STATS_S1_PUBLISH_TIMERS:
+        return TSTATS_PublishCompact();
+
+    case CMND_STATS_S2_RESET_TIMERS:
+        TSTATS_Reset();
+        return true;
+
+#if 1 == N32_CFG_CMND_QUEUE_ENABLED
+    case CMND_STATS_S3_PUBLISH_QUEUE:
+        return CQUEUE_PublishStats();
+
+    case CMND_STATS_S4_RESET_QUEUE:
+        CQUEUE_ResetStats();
+        return true;
+#endif // N32_CFG_CMND_QUEUE_ENABLED
+
+#if 1 == N32_CFG_PUB_QUEUE_ENABLED
+    case CMND_STATS_S5_PUBLISH_PUB_QUEUE:
+        return PQUEUE_PublishStats();
+#endif // N32_CFG_PUB_QUEUE_ENABLED
+
+    case CMND_STATS_S6_PUBLISH_HEAP:
+        return stats_PublishHeap();
+
+#if 1 == N32_CFG_LATENCY_PROBE_ENABLED
+    case CMND_STATS_S7_PUBLISH_LATENCY:
+        return LAT_PublishStats();
+#endif // N32_CFG_LATENCY_PROBE_ENABLED
+
+#if 1 == N32_CFG_TASKS_ENABLED
+    case CMND_STATS_S8_PUBLISH_TASKS:
+        return TASK_PublishStats();
+#endif // N32_CFG_TASKS_ENABLED
+
+#if 1 == N32_CFG_PROFILER_ENABLED
+    case CMND_STATS_S9_PUBLISH_PROFILE:
+        return PROF_PublishStats();
+#endif // N32_CFG_PROFILER_ENABLED
+    }
+
+    return false; // error
+}
+
+/**
+ * S0S - Show timers histograms in message broker (debug topic)
+ * S1S - Publish compact timers histograms on the stats topic
+ * S2S - Reset timers histograms
+ * S3S - Publish commands queue statistics on the stats topic
+ * S4S - Reset commands queue statistics
+ * S5S - Publish outbound messages queue statistics on the stats topic
+ * S6S - Publish heap statistics (free, largest free block, fragmentation %) on the stats topic
+ * S7S - Publish command to pin write latency (total, p50, p99, max in us) on the stats topic
+ * S8S - Publish tasks statistics (owner, priority, runs, budget overruns, max us), one per task
+ * S9S - Publish loop stages profile (stage, runs, min, avg, max, p99 in us), one per stage
+ */
+bool decode_CMND_S(cmnd_reader_t& r, state_t& s) {
+    s.command = CR_Digit(r); // [0..9] - command
+    s.sum = CR_Byte(r) - '0'; // sum = 1
+
+    bool sanity_ok = false;
+    if (true == CR_IsOk(r))
+        if (s.command <= CMND_STATS_MAX_VALUE)
+            if (true == isSumOk(s))
+                sanity_ok = true;
+
+    if (false == sanity_ok)
+        CR_FailSanity(r, s);
+
+    // Info display
+    IF_DEB_L() {
+        String str(F("STATS: Cmd: "));
+        str += s.command;
+        str += F(", Sanity: ");
+        str += sanity_ok;
+        MSG_Publish_Debug(str.c_str());
+    }
+
+    return (sanity_ok);
+}
+
+bool decode_CMND_S(const byte* payload, state_t& s, u8* o_CmndLen) {
+    return CR_DecodeUnbounded(decode_CMND_S, payload, s, o_CmndLen);
+}
+
+/// @brief Binary frame counterpart of decode_CMND_S, channel and count are ignored
+/// @param i_rBin binary command fields
+/// @param s state to be filled
+/// @return true if the command is valid
+bool decodeBinary_CMND_S(const cmnd_bin_t& i_rBin, state_t& s) {
+    s.command = i_rBin.command;
+
+    return (0 == i_rBin.args_len && s.command <= CMND_STATS_MAX_VALUE);
+}
+
+module_caps_t STATS_getCapabilities(void) {
+    module_caps_t mc = {
+        .m_is_input = false,
+        .m_number_of_channels = 0,
+        .m_module_name = F("STATS"),
+        .m_mod_init = STATS_ModuleInit,
+        .m_cmnd_decoder = decode_CMND_S,
+        .m_cmnd_executor = STATS_ExecuteCommand
+    };
+
+    return(mc);
+}
+
+#endif // N32_CFG_STATS_ENABLED
@@ -3,6 +3,11 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "my_common.h"
+#include "mngr_modules.h"
+#include "cmnd_reader.h"
+#include "mqtt_publish.h"
+#include "mngr_telemetry.h"
+#include "mngr_tasks.h"
 
 #if 1 == N32_CFG_TEMP_ENABLED
 
@@ -38,7 +43,7 @@ static void handler_UpdateSensorsAddr(void) {
         }
         DEB_L(stringAddr);
 
-        MSG_Publish(MQTT_SENSORS_ADDR, stringAddr.c_str());
+        MSG_PublishTopic(MQTT_T_SENSORS_ADDR, MQTT_NO_CHANNEL, stringAddr.c_str());
     }
 }
 
@@ -54,13 +59,14 @@ static void handler_OneWire(void) {
             float temperature_prev = ds18b20_sensors.getTempC();
             float temperature = constrain(temperature_prev, TEMP_MIN, TEMP_MAX);
 
-            String stringPath(MQTT_SENSORS_T);
-            stringPath += i;
-
-            String stringTemp;
-            stringTemp += temperature;
-            MSG_Publish(stringPath.c_str(), stringTemp.c_str());
-            DEBLN(stringTemp);
+#if 1 == N32_CFG_TELEMETRY_ENABLED
+            TELEM_Put('T', i, (i16)(temperature * 100));
+#else
+            MSG_Begin(MQTT_T_SENSORS_T, i);
+            MSG_AppendFloat(temperature, 2);
+            MSG_Send();
+#endif // N32_CFG_TELEMETRY_ENABLED
+            DEBLN(temperature);
 
             IF_DEB_L() {
                 String str(F(" 1-Wire: i="));
@@ -71,7 +77,6 @@ static void handler_OneWire(void) {
                 str += temperature;
                 DEBLN(str);
                 MSG_Publish_Debug(str.c_str());
-                DEBLN(stringPath + " : " + stringTemp);
             }
         }
 
@@ -98,7 +103,12 @@ void TEMP_ModuleInit(void) {
     ds18b20_sensors.doConversion();
 
     // make it cyclic
+#if 1 == N32_CFG_TASKS_ENABLED
+    // reading all sensors takes long, so it can't delay anything else
+    TASK_Register(temp_AlarmFun, TASK_PRIO_BACKGROUND, 1000UL * DEFAULT_DS18B20_READING_TIME_IN_S, 50000, 'T');
+#else
     SETUP_RegisterTimer(DEFAULT_DS18B20_READING_TIME_IN_S, temp_AlarmFun);
+#endif // N32_CFG_TASKS_ENABLED
 
     // module registry
     PIN_RegisterPins(ds18b20_getPinFromChannelNum,
@@ -130,15 +140,26 @@ static void temp_SendResults(actions_context_t& i_rActionsContext) {
         ds18b20_sensors.select(&address[0]);
         float temperature = ds18b20_sensors.getTempC();
 
-        String stringPath(MQTT_SENSORS_T);
-        stringPath += i;
-
-        String stringTemp;
-        stringTemp += temperature;
-        MSG_Publish(stringPath.c_str(), stringTemp.c_str());
-
-        DEB_L(stringPath + F(" : ") + stringTemp);
+#if 1 == N32_CFG_TELEMETRY_ENABLED
+        TELEM_Put('T', i, (i16)(temperature * 100));
+#else
+        MSG_Begin(MQTT_T_SENSORS_T, i);
+        MSG_AppendFloat(temperature, 2);
+        MSG_Send();
+#endif // N32_CFG_TELEMETRY_ENABLED
+
+        IF_DEB_L() {
+            String str(F("TEMP: "));
+            str += i;
+            str += F(" : ");
+            str += temperature;
+            DEB_L(str);
+        }
     }
+
+#if 1 == N32_CFG_TELEMETRY_ENABLED
+    TELEM_Flush(); // requested readings don't wait for the reporting window
+#endif // N32_CFG_TELEMETRY_ENABLED
 }
 
 bool TEMP_ExecuteCommand(const state_t& s) {
@@ -188,22 +209,24 @@ bool TEMP_ExecuteCommand(const state_t& s) {
  * T3A - Show sensor addresses in messaage broker (MQTT)
  * T4A - Pause/Restart temperature conversion
  */
-bool decode_CMND_T(const byte* payload, state_t& s, u8* o_CmndLen) {
+bool decode_CMND_T(cmnd_reader_t& r, state_t& s) {
     CHECK_MODULE_SANITY();
-    
-    const byte* cmndStart = payload;
 
-    s.command = (*payload++) - '0'; // 0..4
-    s.c.t.channel = (*payload++) - '0'; // 0..DS18B20_NUM_OF_AVAIL_CHANNELS
+    s.command = CR_Digit(r); // 0..4
+    s.c.t.channel = CR_Byte(r) - '0'; // 0..DS18B20_NUM_OF_AVAIL_CHANNELS
 
     s.count = DEFAULT_DELAY_FOR_CONVERSION_IN_S;
-    s.sum = (*payload++) - '0'; // sum = 1
+    s.sum = CR_Byte(r) - '0'; // sum = 1
 
     bool sanity_ok = false;
-    if (s.command >= 0 && s.command <= CMND_TEMP_MAX_VALUE)
-        if (s.c.t.channel >= 0 && s.c.t.channel < DS18B20_NUM_OF_AVAIL_CHANNELS)
-            if (true == isSumOk(s))
-                sanity_ok = true;
+    if (true == CR_IsOk(r))
+        if (s.command <= CMND_TEMP_MAX_VALUE)
+            if (s.c.t.channel < DS18B20_NUM_OF_AVAIL_CHANNELS)
+                if (true == isSumOk(s))
+                    sanity_ok = true;
+
+    if (false == sanity_ok)
+        CR_FailSanity(r, s);
 
     // Info display
     IF_DEB_L() {
@@ -220,13 +243,32 @@ bool decode_CMND_T(const byte* payload, state_t& s, u8* o_CmndLen) {
         DEBLN(str);
     }
 
-    // setting decoded and valid cmnd length
-    if (NULL != o_CmndLen)
-        *o_CmndLen = payload - cmndStart;
-
     return (sanity_ok);
 }
 
+bool decode_CMND_T(const byte* payload, state_t& s, u8* o_CmndLen) {
+    return CR_DecodeUnbounded(decode_CMND_T, payload, s, o_CmndLen);
+}
+
+/// @brief Binary frame counterpart of decode_CMND_T, count is ignored
+/// @param i_rBin binary command fields
+/// @param s state to be filled
+/// @return true if the command is valid
+bool decodeBinary_CMND_T(const cmnd_bin_t& i_rBin, state_t& s) {
+    CHECK_MODULE_SANITY();
+
+    s.command = i_rBin.command;
+    s.c.t.channel = i_rBin.channel;
+    s.count = DEFAULT_DELAY_FOR_CONVERSION_IN_S;
+
+    if (0 == i_rBin.args_len)
+        if (s.command <= CMND_TEMP_MAX_VALUE)
+            if (s.c.t.channel < DS18B20_NUM_OF_AVAIL_CHANNELS)
+                return true;
+
+    return false;
+}
+
 module_caps_t TEMP_getCapabilities(void) {
     module_caps_t mc = {
         .m_is_input = false,
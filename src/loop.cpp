@@ -3,12 +3,25 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "my_common.h"
+#include "mngr_timers.h"
+#include "mngr_power.h"
+#include "mngr_cmnd_queue.h"
+#include "mqtt_reconnect.h"
+#include "mngr_pub_queue.h"
+#include "mngr_trace.h"
+#include "mngr_tasks.h"
+#include "mngr_profiler.h"
 
 #define LOOP_DELAY_TIME_IN_MS (100)
+#define LOOP_ETH_PERIOD_IN_MS (1000) // DHCP lease maintenance
 
 static debug_level_t uDebugLevel = DEBUG_WARN;
 
-static void handler_Ethernet(void) { Ethernet.maintain(); }
+static void handler_Ethernet(void) {
+    int result;
+    PROF_STAGE(PROF_ETH_MAINTAIN, result = Ethernet.maintain());
+    MQTT_OnEthernetMaintain(result);
+}
 
 void digitalClockDisplay() {
     //digital clock display of the time
@@ -38,14 +51,8 @@ void printDigits(int digits) {
 }
 
 
-void loop() {
-    static time_t prev_t;
-
-#if 1==N32_CFG_WATCHDOG_ENABLED
-    wdt_reset();
-#endif // N32_CFG_WATCHDOG_ENABLED
-
 #if 1==N32_CFG_ETH_ENABLED
+static void loop_Network(void) {
     IF_DEB_L() {
         static u32 i = 0;
         i++;
@@ -53,21 +60,39 @@ void loop() {
             MSG_Publish_Debug(String(F("Tick!")).c_str());
     }
 
-    // low level ethernet section
-    handler_Ethernet();
-
-    // MQTT section
+    // MQTT section, reconnecting doesn't block local control
     if (!gClient_Mosq.connected())
-        MQTT_reconnect();
+        PROF_STAGE(PROF_MQTT_RECONNECT, MQTT_reconnect());
     else
-        gClient_Mosq.loop();
+        PROF_STAGE(PROF_MQTT_LOOP, gClient_Mosq.loop());
+}
+
+#if 1 == N32_CFG_CMND_QUEUE_ENABLED
+static void loop_Commands(void) {
+    // commands received by loop_Network are executed here, within the time budget
+    PROF_STAGE(PROF_CMND_QUEUE, CQUEUE_ProcessPending(CQUEUE_BUDGET_IN_MS));
+}
+#endif // N32_CFG_CMND_QUEUE_ENABLED
+
+static void loop_Publish(void) {
+#if 1 == N32_CFG_PUB_QUEUE_ENABLED
+    // replies to the commands included
+    PROF_STAGE(PROF_PUB_QUEUE, PQUEUE_ProcessPending());
+#endif // N32_CFG_PUB_QUEUE_ENABLED
+
+    TRACE_ProcessPending();
+}
+
+static void loop_Timers(void) {
+    static time_t prev_t;
 
     // TIME handling section
-    time_t t = now(); // blocking funtion, that eventually calls NTP for curret
+    time_t t;
+    PROF_STAGE(PROF_NTP, t = now()); // blocking funtion, that eventually calls NTP for curret
 
     // we just want to check it once a second
     if (prev_t != t) {
-        TIMER_ProcessAllTimers();
+        PROF_STAGE(PROF_TIMERS, TIMER_ProcessAllTimers());
 
         if (timeStatus() != timeSet) {
             IF_DEB_W() {
@@ -86,8 +111,58 @@ void loop() {
 
         prev_t = t;
     }
+}
 #endif // N32_CFG_ETH_ENABLED
 
-    // sleep some time between loops
-    Alarm.delay(LOOP_DELAY_TIME_IN_MS);
+static void loop_TimersMs(void) {
+    // sub-second timers are handled on every pass
+    PROF_STAGE(PROF_TIMERS_MS, TIMER_MS_ProcessAllTimers());
+}
+
+#if 1 == N32_CFG_TASKS_ENABLED
+// modules register their own tasks (inputs scanning, sensors, safety checks) on init
+static void loop_RegisterTasks(void) {
+#if 1==N32_CFG_ETH_ENABLED
+    TASK_Register(handler_Ethernet, TASK_PRIO_NETWORK, LOOP_ETH_PERIOD_IN_MS, 2000, 'E');
+    TASK_Register(loop_Network, TASK_PRIO_NETWORK, TASK_PERIOD_POLL, 20000, 'M');
+#if 1 == N32_CFG_CMND_QUEUE_ENABLED
+    TASK_Register(loop_Commands, TASK_PRIO_CONTROL, TASK_PERIOD_POLL, 1000UL * CQUEUE_BUDGET_IN_MS + 2000, 'Q');
+#endif // N32_CFG_CMND_QUEUE_ENABLED
+    TASK_Register(loop_Publish, TASK_PRIO_BACKGROUND, TASK_PERIOD_POLL, 10000, 'P');
+    TASK_Register(loop_Timers, TASK_PRIO_CONTROL, TASK_PERIOD_POLL, 5000, 'T');
+#endif // N32_CFG_ETH_ENABLED
+    TASK_Register(loop_TimersMs, TASK_PRIO_CONTROL, TASK_PERIOD_POLL, 2000, 't');
+}
+#endif // N32_CFG_TASKS_ENABLED
+
+void loop() {
+#if 1==N32_CFG_WATCHDOG_ENABLED
+    wdt_reset();
+#endif // N32_CFG_WATCHDOG_ENABLED
+
+#if 1 == N32_CFG_TASKS_ENABLED
+    static bool bTasksRegistered = false;
+    if (false == bTasksRegistered) {
+        loop_RegisterTasks();
+        bTasksRegistered = true;
+    }
+
+    TASK_RunPending();
+#else
+#if 1==N32_CFG_ETH_ENABLED
+    // low level ethernet section
+    handler_Ethernet();
+    loop_Network();
+#if 1 == N32_CFG_CMND_QUEUE_ENABLED
+    loop_Commands();
+#endif // N32_CFG_CMND_QUEUE_ENABLED
+    loop_Publish();
+    loop_Timers();
+#endif // N32_CFG_ETH_ENABLED
+
+    loop_TimersMs();
+#endif // N32_CFG_TASKS_ENABLED
+
+    // sleep till the closest due item, network or pin event
+    POWER_IdleUntilNextEvent(LOOP_DELAY_TIME_IN_MS);
 }
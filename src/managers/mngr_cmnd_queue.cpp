@@ -0,0 +1,185 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "my_common.h"
+#include "mngr_cmnd_queue.h"
+#include "cmnds_core.h"
+#include "mqtt_publish.h"
+#include "mngr_latency.h"
+
+#if 1 == N32_CFG_CMND_QUEUE_ENABLED
+
+// Module name: command queue
+// Module aim: MQTT_callback runs inside gClient_Mosq.loop(), so it only decodes commands and
+// puts them here. Execution happens later in loop(), within a time budget, so a slow executor
+// doesn't hold network processing.
+//
+// Commands of a batch frame are pushed all or none. Their results are gathered while they are
+// executed, and the batch reply is published after the last one.
+
+static debug_level_t uDebugLevel = DEBUG_WARN;
+
+typedef struct {
+    state_t m_state;
+    u32 m_enqueued_ms;
+    u8 m_batch_pos;    // position in the batch frame, CQUEUE_NOT_IN_BATCH for single commands
+    u8 m_batch_report; // for the last command of a batch: processed commands count to report, 0 otherwise
+    u16 m_corr_id;     // CMNDS_NO_CORR_ID if no ack is expected
+    u32 m_decode_us;   // reported in the ack
+#if 1 == N32_CFG_LATENCY_PROBE_ENABLED
+    u32 m_received_us; // LAT_NO_STAMP if not measured
+#endif // N32_CFG_LATENCY_PROBE_ENABLED
+} cqueue_entry_t;
+
+static cqueue_entry_t Q[CQUEUE_SIZE];
+static u8 Head = 0;  // next entry to be executed
+static u8 Count = 0; // entries waiting
+static u8 BatchStartCount = 0;
+static u32 BatchResults = 0;
+
+// statistics
+static u8 MaxDepth = 0;
+static u16 Drops = 0;
+static u32 Executed = 0;
+static u32 WaitSumMs = 0;
+static u32 WaitMaxMs = 0;
+
+/// @brief Puts decoded command at the end of the queue
+/// @param s decoded command
+/// @param i_uBatchPos position in the batch frame, CQUEUE_NOT_IN_BATCH otherwise
+/// @param i_uCorrId correlation id to be acknowledged after the execution
+/// @param i_uDecodeUs decoding time, for the ack
+/// @param i_uReceivedUs receipt time for the latency probe, LAT_NO_STAMP if not measured
+/// @return false if queue is full and the command was dropped
+bool CQUEUE_Push(const state_t& s, u8 i_uBatchPos, u16 i_uCorrId, u32 i_uDecodeUs, u32 i_uReceivedUs) {
+    if (Count >= CQUEUE_SIZE) {
+        if (0xFFFF != Drops)
+            Drops++;
+
+        IF_DEB_W() {
+            String str(F("CQUEUE: full, dropped cmnd="));
+            str += s.action;
+            DEB_W(str);
+        }
+        return false;
+    }
+
+    cqueue_entry_t& e = Q[(Head + Count) % CQUEUE_SIZE];
+    e.m_state = s;
+    e.m_enqueued_ms = millis();
+    e.m_batch_pos = i_uBatchPos;
+    e.m_batch_report = 0;
+    e.m_corr_id = i_uCorrId;
+    e.m_decode_us = i_uDecodeUs;
+#if 1 == N32_CFG_LATENCY_PROBE_ENABLED
+    e.m_received_us = i_uReceivedUs;
+#else
+    (void)i_uReceivedUs;
+#endif // N32_CFG_LATENCY_PROBE_ENABLED
+
+    Count++;
+    if (Count > MaxDepth)
+        MaxDepth = Count;
+
+    return true;
+}
+
+/// @brief Marks the place a batch starts at, so it can be rolled back
+void CQUEUE_BatchBegin(void) {
+    BatchStartCount = Count;
+}
+
+/// @brief Closes the batch, the reply is going to be published after its last command
+/// @param i_uProcessed processed commands count to report
+/// @return false if nothing was pushed since CQUEUE_BatchBegin
+bool CQUEUE_BatchEnd(u8 i_uProcessed) {
+    if (Count == BatchStartCount)
+        return false;
+
+    Q[(Head + Count - 1) % CQUEUE_SIZE].m_batch_report = i_uProcessed;
+    return true;
+}
+
+/// @brief Removes all commands pushed since CQUEUE_BatchBegin, i.e. when the queue got full
+void CQUEUE_BatchAbort(void) {
+    u8 removed = Count - BatchStartCount;
+    Drops = (Drops + removed < 0xFFFF) ? Drops + removed : 0xFFFF;
+    Count = BatchStartCount;
+}
+
+/// @brief Executes queued commands, till the queue is empty or time budget is used up.
+/// At least one command is executed per call
+/// @param i_uBudgetMs time budget
+void CQUEUE_ProcessPending(u32 i_uBudgetMs) {
+    const u32 started = millis();
+
+    while (Count > 0) {
+        // taking the entry out first, executors are free to push new commands
+        cqueue_entry_t e = Q[Head];
+        Head = (Head + 1) % CQUEUE_SIZE;
+        Count--;
+
+        u32 waited = started - e.m_enqueued_ms;
+        WaitSumMs += waited;
+        if (waited > WaitMaxMs)
+            WaitMaxMs = waited;
+        Executed++;
+
+        const u32 execStarted = micros();
+        LAT_BeginCommand(e.m_received_us);
+        bool bOk = CMNDS_executeCmnd(e.m_state);
+
+        if (CMNDS_NO_CORR_ID != e.m_corr_id)
+            CMNDS_PublishAck(e.m_corr_id, (true == bOk) ? CMND_ERR_NONE : CMND_ERR_EXEC,
+                e.m_decode_us, micros() - execStarted);
+
+        if (CQUEUE_NOT_IN_BATCH != e.m_batch_pos) {
+            if (0 == e.m_batch_pos)
+                BatchResults = 0;
+            if (true == bOk)
+                BatchResults |= ((u32)1 << e.m_batch_pos);
+            if (0 != e.m_batch_report)
+                CMNDS_PublishBatchResult(e.m_batch_report, BatchResults);
+        }
+
+        if (millis() - started >= i_uBudgetMs)
+            break;
+    }
+}
+
+/// @brief Returns number of commands waiting for execution
+/// @return queue depth
+u8 CQUEUE_GetDepth(void) {
+    return Count;
+}
+
+/// @brief Clears statistics, max depth starts over from the current depth
+void CQUEUE_ResetStats(void) {
+    MaxDepth = Count;
+    Drops = 0;
+    Executed = 0;
+    WaitSumMs = 0;
+    WaitMaxMs = 0;
+}
+
+/// @brief Publishes "depth,max_depth,drops,executed,avg_wait_ms,max_wait_ms" on the stats topic
+/// @return result of publishing
+bool CQUEUE_PublishStats(void) {
+    MSG_Begin(MQTT_T_STATS_QUEUE, MQTT_NO_CHANNEL);
+    MSG_AppendU32(Count);
+    MSG_AppendChar(',');
+    MSG_AppendU32(MaxDepth);
+    MSG_AppendChar(',');
+    MSG_AppendU32(Drops);
+    MSG_AppendChar(',');
+    MSG_AppendU32(Executed);
+    MSG_AppendChar(',');
+    MSG_AppendU32((0 != Executed) ? WaitSumMs / Executed : 0);
+    MSG_AppendChar(',');
+    MSG_AppendU32(WaitMaxMs);
+
+    return MSG_Send();
+}
+
+#endif // N32_CFG_CMND_QUEUE_ENABLED
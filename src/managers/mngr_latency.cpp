@@ -0,0 +1,100 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "my_common.h"
+#include "mngr_latency.h"
+#include "mqtt_publish.h"
+
+#if 1 == N32_CFG_LATENCY_PROBE_ENABLED
+
+// Module name: latency probe
+// Module aim: to measure, on the board, the time from a command received by MQTT_callback to
+// the first pin write it makes, queueing and decoding included. Percentiles are published on
+// request (S7), to be tracked over time by the broker side.
+//
+// The receipt time goes with the frame's first command, through the command queue too, and only
+// pin writes made while that command is executed count. So pin writes of timers, while the
+// command waits in the queue, are not taken. Frames not executed (bad ones, duplicates, full
+// queue, aborted batches) and commands not writing any pin give no sample.
+
+static u32 Samples[LAT_SAMPLES];
+static u8 NextSample = 0;
+static u8 NumOfSamples = 0;
+static u32 Total = 0; // samples taken since start
+
+static u32 ReceivedUs = LAT_NO_STAMP; // of the message in MQTT_callback, till a command takes it
+static u32 CommandReceivedUs = 0;     // of the command being executed
+static bool bPending = false;
+
+/// @brief Called when a message is received. micros() counts in 4us steps, so setting the
+/// lowest bit keeps it apart from LAT_NO_STAMP, without changing the result
+void LAT_MarkReceived(void) {
+    ReceivedUs = micros() | 1;
+}
+
+/// @brief Hands the receipt time over to the command decoded from the message
+/// @return the time, LAT_NO_STAMP if already taken
+u32 LAT_TakeReceived(void) {
+    const u32 stamp = ReceivedUs;
+    ReceivedUs = LAT_NO_STAMP;
+    return stamp;
+}
+
+/// @brief Called right before a command is executed
+/// @param i_uReceivedUs receipt time of the command, LAT_NO_STAMP if not measured
+void LAT_BeginCommand(u32 i_uReceivedUs) {
+    CommandReceivedUs = i_uReceivedUs;
+    bPending = (LAT_NO_STAMP != i_uReceivedUs);
+}
+
+/// @brief Called by modules right after writing a pin. Only the first write counts
+void LAT_MarkActuated(void) {
+    if (false == bPending)
+        return; // timer driven write
+
+    bPending = false;
+
+    Samples[NextSample] = micros() - CommandReceivedUs;
+    NextSample = (NextSample + 1) % LAT_SAMPLES;
+    if (NumOfSamples < LAT_SAMPLES)
+        NumOfSamples++;
+    Total++;
+}
+
+/// @brief Called after a command is executed, so later timer driven writes don't count
+void LAT_EndCommand(void) {
+    bPending = false;
+}
+
+/// @brief Publishes "total,p50_us,p99_us,max_us" on the stats topic. Percentiles are of the
+/// LAT_SAMPLES most recent samples, total counts all of them
+/// @return result of queueing
+bool LAT_PublishStats(void) {
+    u32 sorted[LAT_SAMPLES];
+
+    // insertion sort, there are just a few of them
+    _FOR(i, 0, NumOfSamples) {
+        u8 j = i;
+        for (; j > 0 && sorted[j - 1] > Samples[i]; j--)
+            sorted[j] = sorted[j - 1];
+        sorted[j] = Samples[i];
+    }
+
+    const u8 last = (0 == NumOfSamples) ? 0 : NumOfSamples - 1;
+    if (0 == NumOfSamples)
+        sorted[0] = 0;
+
+    MSG_Begin(MQTT_T_STATS_LATENCY, MQTT_NO_CHANNEL);
+    MSG_AppendU32(Total);
+    MSG_AppendChar(',');
+    MSG_AppendU32(sorted[(last * 50) / 100]);
+    MSG_AppendChar(',');
+    MSG_AppendU32(sorted[(last * 99) / 100]);
+    MSG_AppendChar(',');
+    MSG_AppendU32(sorted[last]);
+
+    return MSG_Send();
+}
+
+#endif // N32_CFG_LATENCY_PROBE_ENABLED
@@ -3,36 +3,139 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "my_common.h"
+#include "cmnds_stats.h"
+#include "cmnds_schedule.h"
+#include "mngr_modules.h"
 
-/// @brief a static table that is used to store all modules references and other data in the system
-const static module_funs_t MODS[] =
-{
+// The one list of modules, in their init order. Each enabled module adds its row:
+// X(letter, capabilities, init, decoder, executor, binary decoder), with MOD_FN(f) for each
+// function the module has and MOD_NO_FN for the ones it doesn't. MODS[], DISPATCH[] and
+// the functions prototypes are all generated from it, so they can't drift apart
 #if 1==N32_CFG_BIN_IN_ENABLED
-        {.m_module_letter = 'I', .m_module_name = 0, .m_get_caps = BIN_IN_getCapabilities },
+#define MOD_ROW_I(X) X('I', BIN_IN_getCapabilities, MOD_FN(BIN_IN_ModuleInit), MOD_FN(decode_CMND_I), MOD_FN(BIN_IN_ExecuteCommand), MOD_FN(decodeBinary_CMND_I))
+#else
+#define MOD_ROW_I(X)
 #endif // N32_CFG_BIN_IN_ENABLED
 #if 1==N32_CFG_BIN_OUT_ENABLED
-        {.m_module_letter = 'B', .m_module_name = 0, .m_get_caps = BIN_OUT_getCapabilities },
+#define MOD_ROW_B(X) X('B', BIN_OUT_getCapabilities, MOD_FN(BIN_OUT_ModuleInit), MOD_FN(decode_CMND_B), MOD_FN(BIN_OUT_ExecuteCommand), MOD_FN(decodeBinary_CMND_B))
+#else
+#define MOD_ROW_B(X)
 #endif // N32_CFG_BIN_OUT_ENABLED
 #if 1==N32_CFG_PWM_ENABLED
-        {.m_module_letter = 'P', .m_module_name = 0, .m_get_caps = PWM_getCapabilities },
+#define MOD_ROW_P(X) X('P', PWM_getCapabilities, MOD_FN(PWM_ModuleInit), MOD_FN(decode_CMND_P), MOD_FN(PWM_ExecuteCommand), MOD_FN(decodeBinary_CMND_P))
+#else
+#define MOD_ROW_P(X)
 #endif // N32_CFG_PWM_ENABLED
 #if 1==N32_CFG_LED_W2918_ENABLED
-        {.m_module_letter = 'L', .m_module_name = 0, .m_get_caps = LED_getCapabilities },
+#define MOD_ROW_L(X) X('L', LED_getCapabilities, MOD_FN(LED_ModuleInit), MOD_FN(decode_CMND_L), MOD_FN(LED_ExecuteCommand), MOD_NO_FN)
+#else
+#define MOD_ROW_L(X)
 #endif // N32_CFG_LED_W2918_ENABLED
 #if 1==N32_CFG_TEMP_ENABLED
-        {.m_module_letter = 'T', .m_module_name = 0, .m_get_caps = TEMP_getCapabilities },
+#define MOD_ROW_T(X) X('T', TEMP_getCapabilities, MOD_FN(TEMP_ModuleInit), MOD_FN(decode_CMND_T), MOD_FN(TEMP_ExecuteCommand), MOD_FN(decodeBinary_CMND_T))
+#else
+#define MOD_ROW_T(X)
 #endif // N32_CFG_TEMP_ENABLED
 #if 1 == N32_CFG_QUICK_ACTIONS_ENABLED
-        {.m_module_letter = 'Q', .m_module_name = 0, .m_get_caps = QA_getCapabilities },
+#define MOD_ROW_Q(X) X('Q', QA_getCapabilities, MOD_FN(QA_ModuleInit), MOD_FN(decode_CMND_Q), MOD_NO_FN, MOD_NO_FN)
+#else
+#define MOD_ROW_Q(X)
 #endif // N32_CFG_QUICK_ACTIONS_ENABLED
 #if 1==N32_CFG_ANALOG_IN_ENABLED
-    {.m_module_letter = 'A', .m_module_name = 0, .m_get_caps = ANALOG_getCapabilities },
+#define MOD_ROW_A(X) X('A', ANALOG_getCapabilities, MOD_FN(ANALOG_ModuleInit), MOD_NO_FN, MOD_NO_FN, MOD_NO_FN)
+#else
+#define MOD_ROW_A(X)
 #endif // N32_CFG_ANALOG_IN_ENABLED
 #if 1==N32_CFG_HISTERESIS_ENABLED
-    {.m_module_letter = 'H', .m_module_name = 0, .m_get_caps = HYST_getCapabilities },
+#define MOD_ROW_H(X) X('H', HYST_getCapabilities, MOD_FN(HYSTERESIS_ModuleInit), MOD_FN(decode_CMND_H), MOD_FN(HYST_ExecuteCommand), MOD_FN(decodeBinary_CMND_H))
+#else
+#define MOD_ROW_H(X)
 #endif // N32_CFG_HISTERESIS_ENABLED
+#if 1==N32_CFG_STATS_ENABLED
+#define MOD_ROW_S(X) X('S', STATS_getCapabilities, MOD_FN(STATS_ModuleInit), MOD_FN(decode_CMND_S), MOD_FN(STATS_ExecuteCommand), MOD_FN(decodeBinary_CMND_S))
+#else
+#define MOD_ROW_S(X)
+#endif // N32_CFG_STATS_ENABLED
+#if 1==N32_CFG_SCHEDULE_ENABLED
+#define MOD_ROW_C(X) X('C', SCHED_getCapabilities, MOD_FN(SCHED_ModuleInit), MOD_FN(decode_CMND_C), MOD_NO_FN, MOD_NO_FN)
+#else
+#define MOD_ROW_C(X)
+#endif // N32_CFG_SCHEDULE_ENABLED
+
+#define MODULES(X) MOD_ROW_I(X) MOD_ROW_B(X) MOD_ROW_P(X) MOD_ROW_L(X) MOD_ROW_T(X) \
+    MOD_ROW_Q(X) MOD_ROW_A(X) MOD_ROW_H(X) MOD_ROW_S(X) MOD_ROW_C(X)
+
+#define MOD_FN(f) f
+#define MOD_NO_FN NULL
+
+// prototypes, MOD_FN(f) and MOD_NO_FN are told apart by pasting their first token
+#define MOD_DECL_INIT_MOD_FN(f) void f(void);
+#define MOD_DECL_INIT_MOD_NO_FN
+#define MOD_DECL_DEC_MOD_FN(f) bool f(cmnd_reader_t& r, state_t& s);
+#define MOD_DECL_DEC_MOD_NO_FN
+#define MOD_DECL_EXEC_MOD_FN(f) bool f(const state_t& s);
+#define MOD_DECL_EXEC_MOD_NO_FN
+#define MOD_DECL_BIN_MOD_FN(f) bool f(const cmnd_bin_t& i_rBin, state_t& s);
+#define MOD_DECL_BIN_MOD_NO_FN
+#define MOD_DECLARE(letter, caps, init, dec, exec, bin) \
+    MOD_DECL_INIT_##init MOD_DECL_DEC_##dec MOD_DECL_EXEC_##exec MOD_DECL_BIN_##bin
+MODULES(MOD_DECLARE)
+
+/// @brief a static table that is used to store all modules references and other data in the system
+#define MOD_FUNS_ROW(letter, caps, init, dec, exec, bin) \
+    {.m_module_letter = letter, .m_module_name = 0, .m_get_caps = caps },
+const static module_funs_t MODS[] =
+{
+    MODULES(MOD_FUNS_ROW)
 };
 
+// Letter-indexed dispatch table, so finding a module's functions is a single PROGMEM read,
+// instead of MODS[] search followed by building module_caps_t. Rows are picked from the
+// modules list at compile time, rows of disabled modules and unused letters stay empty
+typedef struct {
+    char m_letter; // 0 ends the list
+    module_dispatch_t m_dispatch;
+} mod_row_t;
+
+#define MOD_DISPATCH_NONE { NULL, NULL, NULL, NULL }
+#define MOD_DISPATCH_ROW(letter, caps, init, dec, exec, bin) { letter, { dec, exec, init, bin } },
+static constexpr mod_row_t MOD_ROWS[] = { MODULES(MOD_DISPATCH_ROW) { 0, MOD_DISPATCH_NONE } };
+
+static constexpr module_dispatch_t mod_findRow(char i_cLetter, u8 i_uRow) {
+    return (0 == MOD_ROWS[i_uRow].m_letter) ? module_dispatch_t MOD_DISPATCH_NONE
+        : (i_cLetter == MOD_ROWS[i_uRow].m_letter) ? MOD_ROWS[i_uRow].m_dispatch
+        : mod_findRow(i_cLetter, i_uRow + 1);
+}
+#define MOD_DISPATCH_FOR(letter) mod_findRow(letter, 0)
+
+#define MOD_DISPATCH_LETTERS ('Z' - 'A' + 1)
+
+const static module_dispatch_t DISPATCH[MOD_DISPATCH_LETTERS] PROGMEM =
+{
+    MOD_DISPATCH_FOR('A'), MOD_DISPATCH_FOR('B'), MOD_DISPATCH_FOR('C'), MOD_DISPATCH_FOR('D'),
+    MOD_DISPATCH_FOR('E'), MOD_DISPATCH_FOR('F'), MOD_DISPATCH_FOR('G'), MOD_DISPATCH_FOR('H'),
+    MOD_DISPATCH_FOR('I'), MOD_DISPATCH_FOR('J'), MOD_DISPATCH_FOR('K'), MOD_DISPATCH_FOR('L'),
+    MOD_DISPATCH_FOR('M'), MOD_DISPATCH_FOR('N'), MOD_DISPATCH_FOR('O'), MOD_DISPATCH_FOR('P'),
+    MOD_DISPATCH_FOR('Q'), MOD_DISPATCH_FOR('R'), MOD_DISPATCH_FOR('S'), MOD_DISPATCH_FOR('T'),
+    MOD_DISPATCH_FOR('U'), MOD_DISPATCH_FOR('V'), MOD_DISPATCH_FOR('W'), MOD_DISPATCH_FOR('X'),
+    MOD_DISPATCH_FOR('Y'), MOD_DISPATCH_FOR('Z'),
+};
+
+/// @brief Retrieves module's functions from the dispatch table
+/// @param i_cModule a module identification letter
+/// @param o_rDispatch is used to store module's functions
+/// @return false if there is no such module
+bool MOD_getDispatch(char i_cModule, module_dispatch_t& o_rDispatch) {
+    u8 row = (u8)(i_cModule - 'A');
+    if (row >= MOD_DISPATCH_LETTERS)
+        return false;
+
+    memcpy_P(&o_rDispatch, &DISPATCH[row], sizeof(module_dispatch_t));
+
+    // every module has an init function, so an empty row means no module
+    return (NULL != o_rDispatch.m_mod_init);
+}
+
 /// @brief Returns a module index
 /// @param i_mModuleId a module identification letter
 /// @param o_ModuleIndex is used to store index of found module
@@ -66,15 +169,12 @@ const modCapabilities_f MOD_getModuleCapsFunc(mIndex i_Index) {
 bool MOD_callAllInitFuns() {
     bool bAllInitiated = true;
 
+    // MODS[] order is kept, since it's the order modules have always been initialized in
     _FOR(i, 0, int(sizeof(MODS) / sizeof(module_funs_t))) {
-
-        const modCapabilities_f modCaps_f = MOD_getModuleCapsFunc(i);
-        if (modCaps_f) {
-            struct module_caps_s s = modCaps_f();
-            if (s.m_mod_init) {
-                (s.m_mod_init)();
-                continue;
-            }
+        module_dispatch_t d;
+        if (true == MOD_getDispatch(MODS[i].m_module_letter, d) && NULL != d.m_mod_init) {
+            (d.m_mod_init)();
+            continue;
         }
         bAllInitiated = false;
     }
@@ -0,0 +1,202 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "my_common.h"
+#include "mngr_power.h"
+#include "mngr_timers.h"
+#include "mngr_cmnd_queue.h"
+#include "mngr_pub_queue.h"
+#include "mngr_tasks.h"
+#include "mngr_profiler.h"
+
+#include <avr/sleep.h>
+#include "utility/w5500.h"
+
+// Module name: idle
+// Module aim: instead of sleeping fixed time between loops, sleep till the closest due item
+// (1s timer, ms timer, TimeAlarms alarm) and wake up earlier on network event or pin change.
+// Network events come from the W5500 INT line when wired, otherwise sockets are polled
+// every POWER_NET_POLL_MS while idle.
+
+static volatile bool bWakeupRequested = false;
+static bool bModuleInitialised = false;
+
+// millis() taken when now() changed last time, so second based deadlines can be turned into ms
+static time_t tPrevSecond = 0;
+static u32 uSecondStartMs = 0;
+
+/// @brief Breaks current (or next) idle. Can be called from ISRs
+void POWER_RequestWakeup(void) {
+    bWakeupRequested = true;
+}
+
+#if N32_CFG_W5500_INT_PIN >= 0
+// socket events raising INT. SEND_OK is left to the Ethernet library, which polls and clears it
+#define POWER_SNIR_EVENTS (SnIR::RECV | SnIR::DISCON | SnIR::TIMEOUT | SnIR::CON)
+
+static volatile bool bW5500IntFired = false;
+
+static void power_W5500Isr(void) {
+    bW5500IntFired = true;
+    bWakeupRequested = true;
+}
+
+/// @brief Clears socket events, so INT goes high again, but only after it fired
+static void power_ClearW5500Int(void) {
+    if (false == bW5500IntFired)
+        return;
+
+    bW5500IntFired = false;
+
+    _FOR(sock, 0, MAX_SOCK_NUM) {
+        const u8 events = w5500.readSnIR(sock) & POWER_SNIR_EVENTS;
+        if (0 != events)
+            w5500.writeSnIR(sock, events); // write 1 to clear
+    }
+}
+#else
+static u8 SockStatus[MAX_SOCK_NUM];
+
+/// @brief Checks sockets for data waiting or a state change (i.e. a connection closed)
+/// @return true if the loop has network work to do
+static bool power_isNetworkPending(void) {
+    bool bPending = false;
+
+    _FOR(sock, 0, MAX_SOCK_NUM) {
+        const u8 status = w5500.readSnSR(sock);
+        if (status != SockStatus[sock]) {
+            SockStatus[sock] = status;
+            bPending = true;
+        }
+
+        if (0 != w5500.getRXReceivedSize(sock))
+            bPending = true;
+    }
+
+    return bPending;
+}
+#endif // N32_CFG_W5500_INT_PIN
+
+void POWER_ModInit(void) {
+#if N32_CFG_W5500_INT_PIN >= 0
+    // W5500 asserts INT on socket events only when they are unmasked
+    w5500.writeSIMR(0xFF);
+    pinMode(N32_CFG_W5500_INT_PIN, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(N32_CFG_W5500_INT_PIN), power_W5500Isr, FALLING);
+#endif // N32_CFG_W5500_INT_PIN
+
+    bModuleInitialised = true;
+}
+
+/// @brief Returns ms left till now() reaches given second
+static u32 power_getMsTillSecond(time_t i_tSecond, time_t i_tNow, u32 i_uNowMs) {
+    if (i_tSecond <= i_tNow)
+        return 0;
+
+    u32 elapsed = i_uNowMs - uSecondStartMs;
+    if (elapsed > 999)
+        elapsed = 999;
+
+    return (u32)(i_tSecond - i_tNow) * 1000 - elapsed;
+}
+
+/// @brief Works out how long nothing is due
+/// @param i_uPollMs not used, network events always end the idle
+static u32 power_getIdleBudget(u32 i_uPollMs) {
+    const time_t _now = now();
+    const u32 _nowMs = millis();
+
+    if (_now != tPrevSecond) {
+        tPrevSecond = _now;
+        uSecondStartMs = _nowMs;
+    }
+
+    // network events end the idle either way, by INT or by polling sockets
+    u32 budget = POWER_IDLE_MAX_MS;
+    (void)i_uPollMs;
+
+    budget = TIMER_MS_GetTimeToNextDeadline(budget);
+
+#if 1 == N32_CFG_CMND_QUEUE_ENABLED
+    // commands left over the loop() budget are waiting
+    if (0 != CQUEUE_GetDepth())
+        return 0;
+#endif // N32_CFG_CMND_QUEUE_ENABLED
+
+#if 1 == N32_CFG_PUB_QUEUE_ENABLED
+    // messages waiting for the drain rate
+    budget = PQUEUE_GetTimeToNextMs(budget);
+#endif // N32_CFG_PUB_QUEUE_ENABLED
+
+#if 1 == N32_CFG_TASKS_ENABLED
+    // periodic tasks, the polled ones run on each wake up anyway
+    budget = TASK_GetTimeToNextMs(budget);
+#endif // N32_CFG_TASKS_ENABLED
+
+    // 1s timers are processed on the first tick after their deadline
+    time_t tDue;
+    if (true == TIMER_GetNextDeadline(tDue))
+        budget = min(budget, power_getMsTillSecond(tDue + 1, _now, _nowMs));
+
+    // TimeAlarms, zero means no alarm scheduled
+    time_t tAlarm = Alarm.getNextTrigger();
+    if (0 != tAlarm)
+        budget = min(budget, power_getMsTillSecond(tAlarm, _now, _nowMs));
+
+    return budget;
+}
+
+/// @brief Sleeps (MCU idle mode) till the next due item or wake up request
+/// @param i_uPollMs max sleep time without the idle manager (N32_CFG_IDLE_ENABLED 0)
+void POWER_IdleUntilNextEvent(u32 i_uPollMs) {
+#if 1 == N32_CFG_IDLE_ENABLED
+    if (false == bModuleInitialised)
+        POWER_ModInit();
+
+    const u32 budget = power_getIdleBudget(i_uPollMs);
+    const u32 started = millis();
+#if N32_CFG_W5500_INT_PIN < 0
+    u32 lastPoll = started;
+#endif // N32_CFG_W5500_INT_PIN
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    while (millis() - started < budget) {
+#if N32_CFG_W5500_INT_PIN < 0
+        if (millis() - lastPoll >= POWER_NET_POLL_MS) {
+            lastPoll = millis();
+            if (true == power_isNetworkPending())
+                break;
+        }
+#endif // N32_CFG_W5500_INT_PIN
+
+
+        // flag check and sleep must be atomic, otherwise a wake up request could be lost
+        cli();
+        if (true == bWakeupRequested) {
+            sei();
+            break;
+        }
+        sleep_enable();
+        sei();
+        sleep_cpu(); // any interrupt wakes us, at the latest the millis() tick
+        sleep_disable();
+    }
+
+    bWakeupRequested = false;
+
+#if N32_CFG_W5500_INT_PIN >= 0
+    // INT stays low till socket interrupts are cleared
+    power_ClearW5500Int();
+#endif // N32_CFG_W5500_INT_PIN
+
+    // alarms servicing only
+    PROF_STAGE(PROF_ALARMS, Alarm.delay(0));
+#else
+#if 1 == N32_CFG_PROFILER_ENABLED
+    // alarm callbacks due now are measured apart from the waiting below
+    PROF_STAGE(PROF_ALARMS, Alarm.delay(0));
+#endif // N32_CFG_PROFILER_ENABLED
+    Alarm.delay(TIMER_MS_GetTimeToNextDeadline(i_uPollMs));
+#endif // N32_CFG_IDLE_ENABLED
+}
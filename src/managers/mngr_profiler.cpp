@@ -0,0 +1,128 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "my_common.h"
+#include "mngr_profiler.h"
+#include "mqtt_publish.h"
+
+#if 1 == N32_CFG_PROFILER_ENABLED
+
+// Module name: profiler
+// Module aim: to know where loop() time goes, per stage (Ethernet, MQTT, NTP, timers, alarms,
+// ...), as a basis for any latency work. Min, avg and max are exact, p99 is the upper bound
+// of its histogram bucket, so it's within a factor of two. micros() counts in 4us steps on
+// a 16MHz AVR, so shorter stages read as 0 or 4us.
+//
+// Once a counter would overflow, all counters of the stage are halved, so averages and
+// percentiles weigh recent runs more, and never stop being updated.
+
+typedef struct {
+    u16 m_buckets[PROF_BUCKETS];
+    u16 m_count;
+    u32 m_sum_us;
+    u32 m_min_us;
+    u32 m_max_us;
+} prof_stage_stats_t;
+
+static prof_stage_stats_t PS[PROF_COUNT];
+
+#define PROF_STAGE_LETTER(id, letter) letter,
+static const char PROF_LETTERS[PROF_COUNT] PROGMEM = { PROF_STAGES(PROF_STAGE_LETTER) };
+#undef PROF_STAGE_LETTER
+
+static u8 prof_getBucket(u32 i_uDurationUs) {
+    u8 bucket = 0;
+
+    i_uDurationUs >>= 1;
+    while (0 != i_uDurationUs && bucket < PROF_BUCKETS - 1) {
+        i_uDurationUs >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+static void prof_halve(prof_stage_stats_t& io_rStats) {
+    _FOR(b, 0, PROF_BUCKETS)
+        io_rStats.m_buckets[b] >>= 1;
+    io_rStats.m_count >>= 1;
+    io_rStats.m_sum_us >>= 1;
+}
+
+/// @brief Adds a run of a stage to its statistics
+/// @param i_uStage prof_stage_t
+/// @param i_uDurationUs run time
+void PROF_Record(u8 i_uStage, u32 i_uDurationUs) {
+    if (i_uStage >= PROF_COUNT)
+        return;
+
+    prof_stage_stats_t& ps = PS[i_uStage];
+    const u8 bucket = prof_getBucket(i_uDurationUs);
+
+    if (0 == ps.m_count)
+        ps.m_min_us = i_uDurationUs;
+
+    if (0xFFFF == ps.m_count || 0xFFFF == ps.m_buckets[bucket] || ps.m_sum_us + i_uDurationUs < ps.m_sum_us)
+        prof_halve(ps);
+
+    ps.m_buckets[bucket]++;
+    ps.m_count++;
+    ps.m_sum_us += i_uDurationUs;
+    if (i_uDurationUs < ps.m_min_us)
+        ps.m_min_us = i_uDurationUs;
+    if (i_uDurationUs > ps.m_max_us)
+        ps.m_max_us = i_uDurationUs;
+}
+
+/// @brief Works out the 99th percentile from the histogram
+/// @return upper bound of the bucket it falls into, but not more than max
+static u32 prof_getP99(const prof_stage_stats_t& i_rStats) {
+    u32 total = 0;
+    _FOR(b, 0, PROF_BUCKETS)
+        total += i_rStats.m_buckets[b];
+
+    const u32 rank = total - (total / 100); // runs at or below p99
+    u32 seen = 0;
+    u8 b = 0;
+    for (; b < PROF_BUCKETS - 1; b++) {
+        seen += i_rStats.m_buckets[b];
+        if (seen >= rank)
+            break;
+    }
+
+    const u32 upper = (PROF_BUCKETS - 1 == b) ? i_rStats.m_max_us : (2UL << b) - 1;
+
+    return min(upper, i_rStats.m_max_us);
+}
+
+/// @brief Publishes "stage,runs,min_us,avg_us,max_us,p99_us" of each stage that ran, one message
+/// per stage on the stats topic
+/// @return false if any of them failed
+bool PROF_PublishStats(void) {
+    bool bOk = true;
+
+    _FOR(i, 0, PROF_COUNT) {
+        const prof_stage_stats_t& ps = PS[i];
+        if (0 == ps.m_count)
+            continue;
+
+        MSG_Begin(MQTT_T_STATS_PROFILE, i);
+        MSG_AppendChar((char)pgm_read_byte(&PROF_LETTERS[i]));
+        MSG_AppendChar(',');
+        MSG_AppendU32(ps.m_count);
+        MSG_AppendChar(',');
+        MSG_AppendU32(ps.m_min_us);
+        MSG_AppendChar(',');
+        MSG_AppendU32(ps.m_sum_us / ps.m_count);
+        MSG_AppendChar(',');
+        MSG_AppendU32(ps.m_max_us);
+        MSG_AppendChar(',');
+        MSG_AppendU32(prof_getP99(ps));
+        bOk &= MSG_Send();
+    }
+
+    return bOk;
+}
+
+#endif // N32_CFG_PROFILER_ENABLED
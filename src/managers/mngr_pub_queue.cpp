@@ -0,0 +1,240 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "my_common.h"
+#include "mngr_pub_queue.h"
+#include "mqtt_publish.h"
+
+#if 1 == N32_CFG_PUB_QUEUE_ENABLED
+
+// Module name: publish queue
+// Module aim: fast changing sources (BIN_IN toggles, analog readings, ...) could flood the W5500
+// socket. Messages wait here instead, and are published in loop() at PQUEUE_RATE_PER_S, alarms
+// first. Only the latest telemetry message per topic is kept, while acks, results and errors
+// are all published, each one carries its own information. Retained state is queued the same
+// way, latest per topic, but never evicted for a newer message, as it might not come. Messages
+// queued while the broker is unreachable are published after reconnecting.
+
+static debug_level_t uDebugLevel = DEBUG_WARN;
+
+#define PQUEUE_PERIOD_MS (1000 / PQUEUE_RATE_PER_S)
+
+typedef struct {
+    char m_topic[PQUEUE_MAX_TOPIC_LENGTH + 1]; // empty for a free entry
+    char m_payload[PQUEUE_MAX_PAYLOAD_LENGTH + 1];
+    u8 m_prio;
+    bool m_coalesce; // only the latest value of the topic matters
+    bool m_retained;
+    u16 m_seq; // push order, older goes first within the same priority
+} pqueue_entry_t;
+
+static pqueue_entry_t Q[PQUEUE_SIZE];
+static u8 Count = 0;
+static u16 NextSeq = 0;
+
+// token bucket, one token per message
+static u8 Tokens = PQUEUE_BURST;
+static u32 LastRefillMs = 0;
+
+// statistics
+static u16 Drops = 0;
+static u16 Failures = 0;
+
+/// @brief Tells whether entry a should be published before entry b
+static inline bool pqueue_isBefore(const pqueue_entry_t& a, const pqueue_entry_t& b) {
+    if (a.m_prio != b.m_prio)
+        return a.m_prio < b.m_prio;
+
+    return (int16_t)(a.m_seq - b.m_seq) < 0; // wrap-around safe
+}
+
+/// @brief Finds the entry to be published first
+/// @return entry index, PQUEUE_SIZE if the queue is empty
+static u8 pqueue_findFirst(void) {
+    u8 found = PQUEUE_SIZE;
+
+    _FOR(i, 0, PQUEUE_SIZE) {
+        if (0 == Q[i].m_topic[0])
+            continue;
+
+        if (PQUEUE_SIZE == found || true == pqueue_isBefore(Q[i], Q[found]))
+            found = i;
+    }
+
+    return found;
+}
+
+/// @brief Tells whether the entry may be evicted first, as a newer value of its topic will come
+/// anyway. Not so for retained state, it only changes on commands
+static inline bool pqueue_isMergeable(const pqueue_entry_t& e) {
+    return true == e.m_coalesce && false == e.m_retained;
+}
+
+/// @brief Tells whether entry a should be evicted before entry b: mergeable first, then less
+/// important, then older
+static inline bool pqueue_isEvictedBefore(const pqueue_entry_t& a, const pqueue_entry_t& b) {
+    if (pqueue_isMergeable(a) != pqueue_isMergeable(b))
+        return pqueue_isMergeable(a);
+
+    if (a.m_prio != b.m_prio)
+        return a.m_prio > b.m_prio;
+
+    return (int16_t)(a.m_seq - b.m_seq) < 0;
+}
+
+/// @brief Finds the entry to make room for a new message
+/// @param i_uPrio priority of the new message
+/// @return index of an entry of equal or lower priority, PQUEUE_SIZE if all are more important
+static u8 pqueue_findVictim(u8 i_uPrio) {
+    u8 found = PQUEUE_SIZE;
+
+    _FOR(i, 0, PQUEUE_SIZE) {
+        if (0 == Q[i].m_topic[0] || Q[i].m_prio < i_uPrio)
+            continue;
+
+        if (PQUEUE_SIZE == found || true == pqueue_isEvictedBefore(Q[i], Q[found]))
+            found = i;
+    }
+
+    return found;
+}
+
+/// @brief Queues the message. When coalescing, a message waiting for the same topic is replaced,
+/// but keeps its place in the queue
+/// @param topic message topic
+/// @param payload message payload
+/// @param i_uPrio pqueue_prio_t
+/// @param i_bCoalesce true if only the latest value of the topic matters
+/// @param i_bRetained true if the broker should keep it for new subscribers
+/// @return false if the message is too long, or dropped as the queue is full of more important ones.
+/// When full otherwise, an entry of equal or lower priority makes room for it
+bool PQUEUE_Push(const char* topic, const char* payload, u8 i_uPrio, bool i_bCoalesce, bool i_bRetained) {
+    if (strlen(topic) > PQUEUE_MAX_TOPIC_LENGTH || strlen(payload) > PQUEUE_MAX_PAYLOAD_LENGTH)
+        return false;
+
+    pqueue_entry_t* e = NULL;
+
+    // latest value wins, the message keeps its place in the queue
+    _FOR(i, 0, PQUEUE_SIZE)
+        if (true == i_bCoalesce && 0 == strcmp(Q[i].m_topic, topic)) {
+            e = &Q[i];
+            strcpy(e->m_payload, payload);
+            e->m_retained = i_bRetained;
+            if (i_uPrio < e->m_prio)
+                e->m_prio = i_uPrio;
+            return true;
+        }
+
+    if (Count < PQUEUE_SIZE) {
+        _FOR(i, 0, PQUEUE_SIZE)
+            if (0 == Q[i].m_topic[0]) {
+                e = &Q[i];
+                break;
+            }
+        Count++;
+    }
+    else {
+        // full, so an older message goes, unless all of them are more important than this one
+        const u8 victim = pqueue_findVictim(i_uPrio);
+
+        if (Drops < 0xFFFF)
+            Drops++;
+
+        IF_DEB_W() {
+            String str(F("PQUEUE: full, dropped: "));
+            str += (PQUEUE_SIZE == victim) ? topic : Q[victim].m_topic;
+            DEB_W(str);
+        }
+
+        if (PQUEUE_SIZE == victim)
+            return false;
+
+        e = &Q[victim];
+    }
+
+    strcpy(e->m_topic, topic);
+    strcpy(e->m_payload, payload);
+    e->m_prio = i_uPrio;
+    e->m_coalesce = i_bCoalesce;
+    e->m_retained = i_bRetained;
+    e->m_seq = NextSeq++;
+
+    return true;
+}
+
+/// @brief Publishes queued messages, as many as the drain rate allows.
+/// Nothing is lost while the broker is unreachable, messages just wait
+void PQUEUE_ProcessPending(void) {
+    const u32 nowMs = millis();
+
+    while (Tokens < PQUEUE_BURST && nowMs - LastRefillMs >= PQUEUE_PERIOD_MS) {
+        Tokens++;
+        LastRefillMs += PQUEUE_PERIOD_MS;
+    }
+    if (PQUEUE_BURST == Tokens)
+        LastRefillMs = nowMs; // tokens don't pile up over the burst
+
+    while (Count > 0 && Tokens > 0) {
+        if (!gClient_Mosq.connected())
+            return;
+
+        pqueue_entry_t& e = Q[pqueue_findFirst()];
+
+        if (false == gClient_Mosq.publish(e.m_topic, e.m_payload, e.m_retained)) {
+            if (!gClient_Mosq.connected())
+                return; // it'll be published after reconnecting
+
+            // otherwise, it would block all the others
+            if (Failures < 0xFFFF)
+                Failures++;
+
+            IF_DEB_W() {
+                String str(F("ERR: PQUEUE: publishing failed: "));
+                str += e.m_topic;
+                DEB_W(str);
+            }
+        }
+
+        e.m_topic[0] = 0;
+        Count--;
+        Tokens--;
+    }
+}
+
+/// @brief Returns number of messages waiting
+/// @return queue depth
+u8 PQUEUE_GetDepth(void) {
+    return Count;
+}
+
+/// @brief Works out when the next message can be published
+/// @param i_uMaxMs upper limit
+/// @return time in ms, i_uMaxMs if nothing can be published
+u32 PQUEUE_GetTimeToNextMs(u32 i_uMaxMs) {
+    if (0 == Count || !gClient_Mosq.connected())
+        return i_uMaxMs;
+
+    if (Tokens > 0)
+        return 0;
+
+    const u32 elapsed = millis() - LastRefillMs;
+    const u32 left = (elapsed < PQUEUE_PERIOD_MS) ? PQUEUE_PERIOD_MS - elapsed : 0;
+
+    return min(left, i_uMaxMs);
+}
+
+/// @brief Publishes "depth,drops,failures" on the stats topic
+/// @return result of queueing
+bool PQUEUE_PublishStats(void) {
+    MSG_Begin(MQTT_T_STATS_PUBLISH, MQTT_NO_CHANNEL);
+    MSG_AppendU32(Count);
+    MSG_AppendChar(',');
+    MSG_AppendU32(Drops);
+    MSG_AppendChar(',');
+    MSG_AppendU32(Failures);
+
+    return MSG_Send();
+}
+
+#endif // N32_CFG_PUB_QUEUE_ENABLED
@@ -0,0 +1,65 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "my_common.h"
+#include "mngr_state.h"
+#include "mqtt_publish.h"
+
+#if 1 == N32_CFG_RETAINED_STATE_ENABLED
+
+// Module name: retained state
+// Module aim: the broker keeps the last state of each node, so a new subscriber learns it at
+// once, instead of waiting for the periodic republishing. Presence is "online" while
+// connected, and the broker sets it to "offline" (Last Will) when the node drops.
+//
+// Presence is retained per node, on MQTT_T_NODE_PRESENCE (devices/state/presence/<node>), as
+// nodes sharing a retained topic would overwrite each other's Last Will. The former periodic
+// "<node>: Up=..." messages on devices/state/presence/ are only published with this module
+// disabled, so subscribers have to use devices/state/presence/+ instead.
+//
+// Everything is published again after each reconnection, as changes made while disconnected
+// were not published.
+
+static debug_level_t uDebugLevel = DEBUG_WARN;
+
+#define STATE_BUILD_INFO APP_VERSION_STR ", BuildTime: " __DATE__ " " __TIME__
+static_assert(sizeof(STATE_BUILD_INFO) - 1 <= MQTT_MAX_PAYLOAD_LENGTH, "Build info longer than MQTT_MAX_PAYLOAD_LENGTH");
+
+/// @brief Publishes presence, build info and states of all outputs, right after connecting
+void STATE_OnConnected(void) {
+    MSG_Begin(MQTT_T_NODE_PRESENCE, MQTT_NO_CHANNEL);
+    MSG_AppendStr_P(PSTR(STATE_PRESENCE_ONLINE));
+    bool bOk = MSG_SendRetained();
+
+    MSG_Begin(MQTT_T_NODE_BUILDTIME, MQTT_NO_CHANNEL);
+    MSG_AppendStr_P(PSTR(STATE_BUILD_INFO));
+    bOk &= MSG_SendRetained();
+
+#if 1 == N32_CFG_BIN_OUT_ENABLED
+    BIN_OUT_PublishStates();
+#endif // N32_CFG_BIN_OUT_ENABLED
+#if 1 == N32_CFG_PWM_ENABLED
+    PWM_PublishStates();
+#endif // N32_CFG_PWM_ENABLED
+
+    if (false == bOk)
+        DEB_W(F("ERR: STATE: publishing failed\n"));
+}
+
+/// @brief Publishes retained state of an output channel
+/// @param i_uTopic mqtt_topic_t of the module
+/// @param i_uChannel channel number
+/// @param i_uValue channel value
+void STATE_PublishOutput(u8 i_uTopic, u8 i_uChannel, u8 i_uValue) {
+    if (!gClient_Mosq.connected())
+        return; // all states are published after reconnecting
+
+    // queued, as it's called while executing commands, maybe from the MQTT callback
+
+    MSG_Begin(i_uTopic, i_uChannel);
+    MSG_AppendU32(i_uValue);
+    MSG_SendRetained();
+}
+
+#endif // N32_CFG_RETAINED_STATE_ENABLED
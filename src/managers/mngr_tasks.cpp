@@ -0,0 +1,159 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "my_common.h"
+#include "mngr_tasks.h"
+#include "mqtt_publish.h"
+
+#if 1 == N32_CFG_TASKS_ENABLED
+
+// Module name: tasks
+// Module aim: loop() used to run its work in a fixed order, so i.e. a slow MQTT pass delayed
+// everything after it. Here, work is split into tasks with priorities, periods and budgets.
+// Periodic tasks keep their phase (no drift), unless late by more than a period.
+
+static debug_level_t uDebugLevel = DEBUG_WARN;
+
+typedef struct {
+    task_f m_fun;
+    u32 m_period_ms;
+    u32 m_next_ms;   // deadline of periodic ones
+    u16 m_budget_us;
+    u8 m_prio;
+    char m_owner;
+    bool m_pending;  // poll ones: not run in this pass yet
+    // statistics
+    u32 m_runs;
+    u16 m_overruns;
+    u16 m_max_us;
+} task_t;
+
+static task_t Tasks[TASKS_MAX];
+static u8 Count = 0;
+
+static inline bool task_isDue(const task_t& t, u32 i_uNowMs) {
+    if (TASK_PERIOD_POLL == t.m_period_ms)
+        return t.m_pending;
+
+    return (i32)(i_uNowMs - t.m_next_ms) >= 0;
+}
+
+/// @brief Adds a task, run from the next loop() pass
+/// @param i_fTask task function, must not block
+/// @param i_uPrio task_prio_t
+/// @param i_uPeriodMs period, TASK_PERIOD_POLL to be run on each pass
+/// @param i_uBudgetUs expected max run time, longer runs are counted as overruns
+/// @param i_cOwner letter in statistics
+/// @return task number, TASK_NULL if there is no room
+u8 TASK_Register(task_f i_fTask, u8 i_uPrio, u32 i_uPeriodMs, u16 i_uBudgetUs, char i_cOwner) {
+    if (Count >= TASKS_MAX || 0 == i_fTask) {
+        DEB_E(F("ERR: TASKS: no room, increase TASKS_MAX\n"));
+        THROW_ERROR();
+        return TASK_NULL;
+    }
+
+    task_t& t = Tasks[Count];
+    memset(&t, 0, sizeof(t));
+    t.m_fun = i_fTask;
+    t.m_prio = i_uPrio;
+    t.m_period_ms = i_uPeriodMs;
+    t.m_next_ms = millis();
+    t.m_budget_us = i_uBudgetUs;
+    t.m_owner = i_cOwner;
+
+    return Count++;
+}
+
+/// @brief Runs all tasks due, the most important first. Each one runs at most once per call
+void TASK_RunPending(void) {
+    _FOR(i, 0, Count)
+        Tasks[i].m_pending = true;
+
+    while (true) {
+        const u32 nowMs = millis();
+        u8 found = TASK_NULL;
+
+        // the same priority goes in the registration order
+        _FOR(i, 0, Count)
+            if (true == task_isDue(Tasks[i], nowMs) && (TASK_NULL == found || Tasks[i].m_prio < Tasks[found].m_prio))
+                found = i;
+
+        if (TASK_NULL == found)
+            return;
+
+        task_t& t = Tasks[found];
+
+        const u32 started = micros();
+        t.m_fun();
+        const u32 took = micros() - started;
+
+        t.m_pending = false;
+        if (TASK_PERIOD_POLL != t.m_period_ms) {
+            t.m_next_ms += t.m_period_ms;
+            if ((i32)(millis() - t.m_next_ms) >= 0)
+                t.m_next_ms = millis() + t.m_period_ms; // too late to catch up
+        }
+
+        t.m_runs++;
+        if (took > t.m_max_us)
+            t.m_max_us = min(took, (u32)0xFFFF);
+        if (took > t.m_budget_us && t.m_overruns < 0xFFFF) {
+            t.m_overruns++;
+            IF_DEB_L() {
+                String str(F("TASKS: over budget: "));
+                str += t.m_owner;
+                str += F(", us=");
+                str += took;
+                MSG_Publish_Debug(str.c_str());
+            }
+        }
+    }
+}
+
+/// @brief Works out when the next periodic task is due
+/// @param i_uMaxMs upper limit
+/// @return time in ms
+u32 TASK_GetTimeToNextMs(u32 i_uMaxMs) {
+    const u32 nowMs = millis();
+    u32 left = i_uMaxMs;
+
+    _FOR(i, 0, Count) {
+        const task_t& t = Tasks[i];
+        if (TASK_PERIOD_POLL == t.m_period_ms)
+            continue;
+
+        if (true == task_isDue(t, nowMs))
+            return 0;
+
+        left = min(left, t.m_next_ms - nowMs);
+    }
+
+    return left;
+}
+
+/// @brief Publishes "owner,prio,runs,overruns,max_us" of each task on the stats topic
+/// @return false if any of them failed
+bool TASK_PublishStats(void) {
+    bool bOk = true;
+
+    _FOR(i, 0, Count) {
+        const task_t& t = Tasks[i];
+
+        MSG_Begin(MQTT_T_STATS_TASKS, i);
+        MSG_AppendChar(t.m_owner);
+        MSG_AppendChar(',');
+        MSG_AppendU32(t.m_prio);
+        MSG_AppendChar(',');
+        MSG_AppendU32(t.m_runs);
+        MSG_AppendChar(',');
+        MSG_AppendU32(t.m_overruns);
+        MSG_AppendChar(',');
+        MSG_AppendU32(t.m_max_us);
+        bOk &= MSG_Send();
+    }
+
+    return bOk;
+}
+
+#endif // N32_CFG_TASKS_ENABLED
@@ -0,0 +1,207 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "my_common.h"
+#include "mngr_telemetry.h"
+#include "mqtt_publish.h"
+
+#if 1 == N32_CFG_TELEMETRY_ENABLED
+
+// Module name: telemetry aggregator
+// Module aim: modules report readings here instead of publishing one message per channel.
+// The latest reading of each module/channel is kept, and all readings changed since the last
+// frame are published together, on MQTT_T_TELEMETRY.
+//
+// Values are integers: TEMP in 1/100 C, HYST in 1/10 C, ANALOG raw, BIN_IN 1 - opened.
+//
+// Binary frame, little endian:
+//   u8 version (1), u16 seq, u32 timestamp, u8 count, count * { char module, u8 channel, i16 value }
+
+static debug_level_t uDebugLevel = DEBUG_WARN;
+
+#define TELEM_BIN_VERSION (1)
+#define TELEM_BIN_HEADER_LENGTH (8)
+#define TELEM_BIN_READING_LENGTH (4)
+
+typedef struct {
+    char m_module; // 0 for a free entry
+    u8 m_channel;
+    i16 m_value;
+    bool m_dirty; // not published yet
+} telem_reading_t;
+
+static telem_reading_t Readings[TELEM_MAX_READINGS];
+static u16 Seq = 0;
+
+static char Frame[TELEM_FRAME_MAX_LENGTH + 1];
+static u8 FrameLen = 0;
+
+/// @brief Stores a reading, to be published with the next frame. Latest value wins.
+/// @param i_cModule module letter
+/// @param i_uChannel channel number
+/// @param i_iValue value, scaled as described above
+void TELEM_Put(char i_cModule, u8 i_uChannel, i16 i_iValue) {
+    telem_reading_t* free = NULL;
+
+    _FOR(i, 0, TELEM_MAX_READINGS) {
+        telem_reading_t& r = Readings[i];
+
+        if (r.m_module == i_cModule && r.m_channel == i_uChannel) {
+            r.m_value = i_iValue;
+            r.m_dirty = true;
+            return;
+        }
+
+        if (0 == r.m_module && NULL == free)
+            free = &r;
+    }
+
+    if (NULL == free) {
+        IF_DEB_W() {
+            String str(F("TELEM: no free entry for: "));
+            str += i_cModule;
+            str += i_uChannel;
+            MSG_Publish_Debug(str.c_str());
+        }
+        return;
+    }
+
+    free->m_module = i_cModule;
+    free->m_channel = i_uChannel;
+    free->m_value = i_iValue;
+    free->m_dirty = true;
+}
+
+static void telem_Publish(void) {
+    char topic[MQTT_MAX_TOPIC_LENGTH + 1];
+
+    if (false == gClient_Mosq.publish(MQTT_TopicStr(MQTT_T_TELEMETRY, topic), (const uint8_t*)Frame, FrameLen)) {
+        IF_DEB_W() {
+            String str(F("ERR: TELEM: publishing failed, seq: "));
+            str += Seq;
+            MSG_Publish_Debug(str.c_str());
+        }
+    }
+
+    Seq++;
+    FrameLen = 0;
+}
+
+#if TELEM_FORMAT_BINARY == TELEM_FORMAT
+static void telem_AppendByte(u8 b) {
+    Frame[FrameLen++] = b;
+}
+
+static void telem_Begin(u32 i_uTimestamp) {
+    FrameLen = 0;
+    telem_AppendByte(TELEM_BIN_VERSION);
+    telem_AppendByte(Seq & 0xFF);
+    telem_AppendByte(Seq >> 8);
+    _FOR(i, 0, 4)
+        telem_AppendByte((i_uTimestamp >> (8 * i)) & 0xFF);
+    telem_AppendByte(0); // count
+}
+
+static bool telem_AppendReading(const telem_reading_t& r) {
+    if (FrameLen + TELEM_BIN_READING_LENGTH > TELEM_FRAME_MAX_LENGTH)
+        return false;
+
+    telem_AppendByte(r.m_module);
+    telem_AppendByte(r.m_channel);
+    telem_AppendByte((u16)r.m_value & 0xFF);
+    telem_AppendByte((u16)r.m_value >> 8);
+    Frame[TELEM_BIN_HEADER_LENGTH - 1]++;
+
+    return true;
+}
+
+static void telem_End(void) {
+}
+#else
+static void telem_Append(const char* str) {
+    while (*str && FrameLen < TELEM_FRAME_MAX_LENGTH)
+        Frame[FrameLen++] = *str++;
+}
+
+static void telem_Append_P(PGM_P str) {
+    char c;
+    while (0 != (c = pgm_read_byte(str++)) && FrameLen < TELEM_FRAME_MAX_LENGTH)
+        Frame[FrameLen++] = c;
+}
+
+static void telem_Begin(u32 i_uTimestamp) {
+    char buf[sizeof("4294967295")];
+
+    FrameLen = 0;
+    telem_Append_P(PSTR("{\"seq\":"));
+    telem_Append(utoa(Seq, buf, 10));
+    telem_Append_P(PSTR(",\"ts\":"));
+    telem_Append(ultoa(i_uTimestamp, buf, 10));
+    telem_Append_P(PSTR(",\"v\":{"));
+}
+
+static bool telem_AppendReading(const telem_reading_t& r) {
+    // ,"X255":-32768 and the closing "}}"
+    char buf[sizeof(",\"X255\":-32768}}")];
+    char* p = buf;
+
+    if ('{' != Frame[FrameLen - 1])
+        *p++ = ',';
+    *p++ = '"';
+    *p++ = r.m_module;
+    p = utoa(r.m_channel, p, 10);
+    p += strlen(p);
+    *p++ = '"';
+    *p++ = ':';
+    itoa(r.m_value, p, 10);
+
+    if (FrameLen + strlen(buf) + 2 > TELEM_FRAME_MAX_LENGTH)
+        return false;
+
+    telem_Append(buf);
+    return true;
+}
+
+static void telem_End(void) {
+    telem_Append_P(PSTR("}}"));
+}
+#endif // TELEM_FORMAT
+
+/// @brief Publishes all readings changed since the last frame, in as many frames as needed
+void TELEM_Flush(void) {
+    if (!gClient_Mosq.connected())
+        return; // readings wait for the next window
+
+    const u32 timestamp = now();
+    bool bPending = false;
+
+    _FOR(i, 0, TELEM_MAX_READINGS) {
+        telem_reading_t& r = Readings[i];
+
+        if (0 == r.m_module || false == r.m_dirty)
+            continue;
+
+        if (false == bPending) {
+            telem_Begin(timestamp);
+            bPending = true;
+        }
+
+        if (false == telem_AppendReading(r)) {
+            // frame full, the reading goes to the next one
+            telem_End();
+            telem_Publish();
+            telem_Begin(timestamp);
+            telem_AppendReading(r);
+        }
+
+        r.m_dirty = false;
+    }
+
+    if (true == bPending) {
+        telem_End();
+        telem_Publish();
+    }
+}
+
+#endif // N32_CFG_TELEMETRY_ENABLED
@@ -0,0 +1,144 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "my_common.h"
+#include "mngr_timer_stats.h"
+#include "mqtt_publish.h"
+
+#if 1 == N32_CFG_TIMER_STATS_ENABLED
+
+// Module name: timer statistics
+// Module aim: to know how late timers fire and how long their callbacks run, per module letter.
+//
+// Buckets are powers of two (lateness, in seconds) or powers of four (duration, in us):
+//   lateness: <=1, 2-3, 4-7, 8-15, 16-31, 32-63, 64-127, >=128 s
+//   duration: <64us, <256us, <1ms, <4ms, <16ms, <64ms, <256ms, >=256ms
+
+// letters of modules that own timers, the last row collects all the others
+static const char TSTATS_OWNERS[] PROGMEM = "BIPLTHZ";
+#define TSTATS_OWNERS_COUNT (sizeof(TSTATS_OWNERS)) // +1 row for unknown owners, in place of '\0'
+
+typedef struct {
+    u16 late[TSTATS_BUCKETS];
+    u16 duration[TSTATS_BUCKETS];
+} tstats_row_t;
+static tstats_row_t TS[TSTATS_OWNERS_COUNT];
+
+static u8 tstats_getRow(char i_cOwner) {
+    u8 i = 0;
+    for (; i < TSTATS_OWNERS_COUNT - 1; i++)
+        if (i_cOwner == (char)pgm_read_byte(&TSTATS_OWNERS[i]))
+            break;
+
+    return i;
+}
+
+static char tstats_getOwner(u8 i_Row) {
+    if (i_Row < TSTATS_OWNERS_COUNT - 1)
+        return (char)pgm_read_byte(&TSTATS_OWNERS[i_Row]);
+
+    return '?';
+}
+
+/// @brief Returns a bucket number for given value
+/// @param i_uValue value to be classified
+/// @param i_uFirstBits number of bits covered by the first bucket
+/// @param i_uStepBits how many bits wider each next bucket is
+static u8 tstats_getBucket(u32 i_uValue, u8 i_uFirstBits, u8 i_uStepBits) {
+    u8 bucket = 0;
+
+    i_uValue >>= i_uFirstBits;
+    while (0 != i_uValue && bucket < TSTATS_BUCKETS - 1) {
+        i_uValue >>= i_uStepBits;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+static void tstats_inc(u16& io_rCounter) {
+    if (0xFFFF != io_rCounter)
+        io_rCounter++;
+}
+
+void TSTATS_RecordLateness(char i_cOwner, u32 i_uLateSecs) {
+    tstats_inc(TS[tstats_getRow(i_cOwner)].late[tstats_getBucket(i_uLateSecs, 1, 1)]);
+}
+
+void TSTATS_RecordCallback(char i_cOwner, u32 i_uDurationUs) {
+    tstats_inc(TS[tstats_getRow(i_cOwner)].duration[tstats_getBucket(i_uDurationUs, 6, 2)]);
+}
+
+void TSTATS_Reset(void) {
+    memset(TS, 0, sizeof(TS));
+}
+
+static bool tstats_isRowEmpty(u8 i_Row) {
+    _FOR(b, 0, TSTATS_BUCKETS)
+        if (0 != TS[i_Row].late[b] || 0 != TS[i_Row].duration[b])
+            return false;
+
+    return true;
+}
+
+static void tstats_appendBuckets(String& io_rStr, const u16* i_pBuckets) {
+    _FOR(b, 0, TSTATS_BUCKETS) {
+        if (b > 0)
+            io_rStr += F(",");
+        io_rStr += i_pBuckets[b];
+    }
+}
+
+void TSTATS_DisplayHistograms(void) {
+    {
+        String str(F("\nTimer stats (late: <=1,2,4,8,16,32,64,128+ s; dur: <64us,256us,1,4,16,64,256ms,256ms+):\n-=-=-=-=-="));
+        MSG_Publish_Debug(str.c_str());
+    }
+
+    _FOR(i, 0, TSTATS_OWNERS_COUNT) {
+        if (true == tstats_isRowEmpty(i))
+            continue;
+
+        String str(F(" "));
+        str += tstats_getOwner(i);
+        str += F(": late=[");
+        tstats_appendBuckets(str, TS[i].late);
+        str += F("], dur=[");
+        tstats_appendBuckets(str, TS[i].duration);
+        str += F("]");
+        MSG_Publish_Debug(str.c_str());
+    }
+}
+
+static void tstats_msgAppendBuckets(const u16* i_pBuckets) {
+    _FOR(b, 0, TSTATS_BUCKETS) {
+        if (b > 0)
+            MSG_AppendChar(',');
+        MSG_AppendU32(i_pBuckets[b]);
+    }
+}
+
+/// @brief Publishes each non empty row as a message, i.e. "B:1,0,0,0,0,0,0,0/3,1,0,0,0,0,0,0",
+/// the longest row takes 97 chars
+/// @return false if any of them failed
+bool TSTATS_PublishCompact(void) {
+    bool bOk = true;
+
+    _FOR(i, 0, TSTATS_OWNERS_COUNT) {
+        if (true == tstats_isRowEmpty(i))
+            continue;
+
+        MSG_Begin(MQTT_T_STATS_TIMERS, MQTT_NO_CHANNEL);
+        MSG_AppendChar(tstats_getOwner(i));
+        MSG_AppendChar(':');
+        tstats_msgAppendBuckets(TS[i].late);
+        MSG_AppendChar('/');
+        tstats_msgAppendBuckets(TS[i].duration);
+        bOk &= MSG_Send();
+    }
+
+    return bOk;
+}
+
+#endif // N32_CFG_TIMER_STATS_ENABLED
@@ -3,51 +3,252 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "my_common.h"
+#include "mngr_timers.h"
+#include "mngr_timer_stats.h"
+#include "mngr_trace.h"
 
 // debug facility
 static debug_level_t uDebugLevel = DEBUG_WARN;
 
+// timer_id = generation tag (high bits) | index into T[] (low bits). The generation is bumped
+// each time a timer is released, so a stale timer_id kept by a module can't touch a timer
+// that has been reallocated in the meantime. An all-ones index is never used, so TIMER_NULL
+// is never a valid timer_id.
+#if MAX_TIMERS < 16
+#define TIMER_ID_INDEX_BITS (4)
+#elif MAX_TIMERS < 32
+#define TIMER_ID_INDEX_BITS (5)
+#elif MAX_TIMERS < 64
+#define TIMER_ID_INDEX_BITS (6)
+#elif MAX_TIMERS < 128
+#define TIMER_ID_INDEX_BITS (7)
+#elif MAX_TIMERS < 255
+#define TIMER_ID_INDEX_BITS (8) // no room left for a generation tag
+#else
+#error MAX_TIMERS must be lower than TIMER_NULL, since timer ids are u8
+#endif
+#define TIMER_ID_INDEX_MASK ((u8)((1 << TIMER_ID_INDEX_BITS) - 1))
+#define TIMER_ID_GEN_MASK ((u8)(0xFF >> TIMER_ID_INDEX_BITS))
+
 // timers data structures
-static my_timer_t T[MAX_TIMERS];
+typedef struct timer_entry_s : my_timer_t {
+    time_t m_due;    // heap key: time_stop, or the second before the next periodic tick
+    time_t m_next_tick; // next periodic fun_start call, valid when m_period != 0
+    u16 m_period;    // periodic call interval in seconds, 0 for TIMER_SHOT_ONCE
+    u16 m_missed;    // periodic ticks skipped, because the timer was processed too late
+    u8 m_heap_pos;   // position in the deadline heap, TIMER_NULL when not queued
+    u8 m_next_free;  // free list link, valid only when the timer is not allocated
+    u8 m_gen;        // generation tag, see above
+    bool m_allocated;
+    bool m_stopping; // inside of fun_stop, so release is left to TIMER_Stop
+    char m_owner;    // letter of the module owning the timer, used by stats
+} timer_entry_t;
+static timer_entry_t T[MAX_TIMERS];
+
+// intrusive free list of not allocated timers
+static u8 FreeHead = TIMER_NULL;
+static u8 FreeCount = 0;
+
+// binary min-heap of active timers, ordered by m_due. Only active timers are kept here,
+// so a tick touches the expired ones only
+static u8 H[MAX_TIMERS];
+static u8 HeapCount = 0;
+
+static time_t LastProcessedNow = 0; // to detect the clock stepping back
 
 /// @brief Initializes the TIMER module
 void TIMER_ModInit() {
     _FOR(u, 0, MAX_TIMERS) {
         T[u].active = false;
         T[u].type = TIMER_SHOT_ONCE;
+        T[u].m_due = 0;
+        T[u].m_heap_pos = TIMER_NULL;
+        T[u].m_next_free = (u + 1 < MAX_TIMERS) ? u + 1 : TIMER_NULL;
+        T[u].m_gen = 0;
+        T[u].m_allocated = false;
+        T[u].m_stopping = false;
     }
+
+    HeapCount = 0;
+    FreeHead = (MAX_TIMERS > 0) ? 0 : TIMER_NULL;
+    FreeCount = MAX_TIMERS;
+
+    TIMER_MS_ModInit();
 }
 
-/// @brief Returns first free timer
-/// @return returns timer id of the first free timer
-static u8 timer_getFirstFreeTimer() {
-    _FOR(u, 0, MAX_TIMERS)
-        if (false == T[u].active)
-            return u;
+static void timer_heapSwap(u8 i_PosA, u8 i_PosB) {
+    u8 tmp = H[i_PosA];
+    H[i_PosA] = H[i_PosB];
+    H[i_PosB] = tmp;
 
-    return TIMER_NULL;
+    T[H[i_PosA]].m_heap_pos = i_PosA;
+    T[H[i_PosB]].m_heap_pos = i_PosB;
+}
+
+static void timer_heapSiftUp(u8 i_Pos) {
+    while (i_Pos > 0) {
+        u8 parent = (i_Pos - 1) >> 1;
+        if (T[H[parent]].m_due <= T[H[i_Pos]].m_due)
+            break;
+        timer_heapSwap(parent, i_Pos);
+        i_Pos = parent;
+    }
+}
+
+static void timer_heapSiftDown(u8 i_Pos) {
+    for (;;) {
+        u16 smallest = i_Pos;
+        u16 left = 2 * (u16)i_Pos + 1;
+        u16 right = left + 1;
+
+        if (left < HeapCount && T[H[left]].m_due < T[H[smallest]].m_due)
+            smallest = left;
+        if (right < HeapCount && T[H[right]].m_due < T[H[smallest]].m_due)
+            smallest = right;
+        if (smallest == i_Pos)
+            break;
+
+        timer_heapSwap(i_Pos, smallest);
+        i_Pos = smallest;
+    }
+}
+
+/// @brief Puts a timer into the deadline heap or, if already there, fixes its position after m_due change
+/// @param i_Index timer to be (re)queued
+static void timer_heapSchedule(u8 i_Index) {
+    u8 pos = T[i_Index].m_heap_pos;
+
+    if (TIMER_NULL == pos) {
+        pos = HeapCount++;
+        H[pos] = i_Index;
+        T[i_Index].m_heap_pos = pos;
+        timer_heapSiftUp(pos);
+        return;
+    }
+
+    timer_heapSiftUp(pos);
+    timer_heapSiftDown(T[i_Index].m_heap_pos);
+}
+
+/// @brief Removes a timer from the deadline heap. Does nothing if the timer is not queued
+/// @param i_Index timer to be removed
+static void timer_heapRemove(u8 i_Index) {
+    u8 pos = T[i_Index].m_heap_pos;
+    if (TIMER_NULL == pos)
+        return;
+
+    T[i_Index].m_heap_pos = TIMER_NULL;
+    if (pos == --HeapCount)
+        return;
+
+    // the last one fills the gap and is moved to its right place
+    H[pos] = H[HeapCount];
+    T[H[pos]].m_heap_pos = pos;
+    timer_heapSiftUp(pos);
+    timer_heapSiftDown(T[H[pos]].m_heap_pos);
+}
+
+/// @brief Sets the heap key of an active timer
+/// @param i_Index index of the timer
+static void timer_setDue(u8 i_Index) {
+    // a timer fires on the first tick after m_due, so a periodic one is due a second before its tick
+    if (0 != T[i_Index].m_period && T[i_Index].m_next_tick <= T[i_Index].time_stop)
+        T[i_Index].m_due = T[i_Index].m_next_tick - 1;
+    else
+        T[i_Index].m_due = T[i_Index].time_stop;
+
+    timer_heapSchedule(i_Index);
+}
+
+/// @brief Calls given timer's start or stop function, measuring its duration
+/// @param i_Index index of the timer
+/// @param i_bStart true for fun_start, false for fun_stop
+static void timer_callAction(u8 i_Index, bool i_bStart) {
+    actions_t& a = T[i_Index].m_actions;
+    if (NULL == (i_bStart ? a.fun_start : a.fun_stop))
+        return;
+
+#if 1 == N32_CFG_TIMER_STATS_ENABLED
+    u32 started = micros();
+#endif // N32_CFG_TIMER_STATS_ENABLED
+
+    if (true == i_bStart)
+        (a.fun_start)(T[i_Index].m_actions_context);
+    else
+        (a.fun_stop)(T[i_Index].m_actions_context);
+
+    TSTATS_RecordCallback(T[i_Index].m_owner, micros() - started);
+}
+
+static inline u8 timer_makeId(u8 i_Index) {
+    return (u8)(((T[i_Index].m_gen & TIMER_ID_GEN_MASK) << TIMER_ID_INDEX_BITS) | i_Index);
+}
+
+/// @brief Translates timer_id into T[] index, checking the generation tag
+/// @param timer_id timer id as returned by TIMER_Start
+/// @param o_Index index into T[]
+/// @return false for TIMER_NULL, out of range, not allocated or stale ids
+static bool timer_getIndex(u8 timer_id, u8& o_Index) {
+    if (TIMER_NULL == timer_id)
+        return false;
+
+    o_Index = timer_id & TIMER_ID_INDEX_MASK;
+    if (o_Index >= MAX_TIMERS || false == T[o_Index].m_allocated)
+        return false;
+
+    return timer_id == timer_makeId(o_Index);
+}
+
+/// @brief Takes a timer from the free list
+/// @return index of the allocated timer, TIMER_NULL if none left
+static u8 timer_alloc() {
+    u8 i = FreeHead;
+    if (TIMER_NULL == i)
+        return TIMER_NULL;
+
+    FreeHead = T[i].m_next_free;
+    FreeCount--;
+    T[i].m_allocated = true;
+    T[i].m_stopping = false;
+
+    return i;
+}
+
+/// @brief Gives a timer back to the free list, invalidating all its outstanding ids
+/// @param i_Index index of the timer
+static void timer_release(u8 i_Index) {
+    if (false == T[i_Index].m_allocated)
+        return;
+
+    T[i_Index].active = false;
+    T[i_Index].m_allocated = false;
+    T[i_Index].m_gen++;
+    T[i_Index].m_next_free = FreeHead;
+    FreeHead = i_Index;
+    FreeCount++;
 }
 
 /// @brief Returns numer of free timers
 /// @return number of free timers
 u8 TIMER_GetNumberOfFreeTimers() {
-    u8 TimersAvail = 0;
-
-    _FOR(u, 0, MAX_TIMERS)
-        if (false == T[u].active)
-            TimersAvail++;
+    return FreeCount;
+}
 
-    return TimersAvail;
+/// @brief Returns numer of active (running) timers
+/// @return number of active timers
+u8 TIMER_GetNumberOfActiveTimers() {
+    return HeapCount; // active timers are exactly the ones in the heap
 }
 
 /// @brief Checks whether a timer is active
 /// @param timer_id timer_id of timer to be checked
 /// @return boolean value being true if timer is active
 bool TIMER_IsActive(u8 timer_id) {
-    if (timer_id >= MAX_TIMERS)
+    u8 i;
+    if (false == timer_getIndex(timer_id, i))
         return false;
 
-    return T[timer_id].active;
+    return T[i].active;
 }
 
 /// @brief Starts a timer
@@ -58,10 +259,24 @@ bool TIMER_IsActive(u8 timer_id) {
 /// @return timer_id of timer being allocated and launched. TIMER_NULL otherwise
 u8 TIMER_Start(const actions_t& i_rActions, actions_context_t& i_rActionContext,
     unsigned long time_seconds, timer_type_t i_eTimerType) {
+    return TIMER_StartOwned(TIMER_OWNER_NONE, i_rActions, i_rActionContext, time_seconds, i_eTimerType);
+}
+
+/// @brief Allocates and launches a timer
+/// @param i_cOwner letter of the module owning the timer
+/// @param i_rActions actions that should be triggered when timer starts and stops
+/// @param i_rActionContext actions context (functions context)
+/// @param time_seconds timer time span
+/// @param i_eTimerType timer type (once vs multiple call)
+/// @param i_uPeriod periodic fun_start interval in seconds, 0 for none
+/// @param i_uPhase delay of the first periodic call, 0 means one period
+/// @return timer_id of timer being allocated and launched. TIMER_NULL otherwise
+static u8 timer_start(char i_cOwner, const actions_t& i_rActions, actions_context_t& i_rActionContext,
+    unsigned long time_seconds, timer_type_t i_eTimerType, u16 i_uPeriod, u16 i_uPhase) {
     u8 iFreeTimer;
 
     // if free timer slot found, and not already ongoing ...
-    if (TIMER_NULL != (iFreeTimer = timer_getFirstFreeTimer())) {
+    if (TIMER_NULL != (iFreeTimer = timer_alloc())) {
         time_t _now= now();
         T[iFreeTimer].m_actions = i_rActions;
         T[iFreeTimer].m_actions_context = i_rActionContext;
@@ -69,57 +284,105 @@ u8 TIMER_Start(const actions_t& i_rActions, actions_context_t& i_rActionContext,
         T[iFreeTimer].time_stop = _now + time_seconds;
         T[iFreeTimer].active = true;
         T[iFreeTimer].type = i_eTimerType;
+        T[iFreeTimer].m_owner = i_cOwner;
+        T[iFreeTimer].m_period = i_uPeriod;
+        T[iFreeTimer].m_missed = 0;
+        T[iFreeTimer].m_next_tick = _now + (0 != i_uPhase ? i_uPhase : i_uPeriod);
+        timer_setDue(iFreeTimer);
 
         // timer_id must be set here, since in "fun_start" there might be
         // already a reference to this field! Also, it's the only one
         // piece of information unknown till then ...
-        T[iFreeTimer].m_actions_context.timer_id = iFreeTimer;
+        T[iFreeTimer].m_actions_context.timer_id = timer_makeId(iFreeTimer);
 
-        IF_DEB_L() {
-            String str(F("TIMER start: stop-start="));
-            str += T[iFreeTimer].time_stop - T[iFreeTimer].time_start;
-            str += F(", timer_id=");
-            str += T[iFreeTimer].m_actions_context.timer_id;
-            str += F(", slot=");
-            str += T[iFreeTimer].m_actions_context.slot;
-            str += F(", active=");
-            str += T[iFreeTimer].active;
-            str += F(", type=");
-            str += T[iFreeTimer].type;
-            DEB_L(str);
-        }
+        TRACE_L(TRC_TIMER_START, T[iFreeTimer].time_stop - T[iFreeTimer].time_start,
+            T[iFreeTimer].m_actions_context.timer_id, T[iFreeTimer].m_actions_context.slot,
+            T[iFreeTimer].active, T[iFreeTimer].type, T[iFreeTimer].m_period);
 
         // actual starting timer
-        if (NULL != T[iFreeTimer].m_actions.fun_start)
-            (T[iFreeTimer].m_actions.fun_start)(T[iFreeTimer].m_actions_context);
+        timer_callAction(iFreeTimer, true);
+
+        return timer_makeId(iFreeTimer);
     };
 
-    return iFreeTimer;
+    return TIMER_NULL;
+}
+
+/// @brief Starts a timer on behalf of given module
+/// @param i_cOwner letter of the module owning the timer
+/// @param i_rActions actions that should be triggered when timer starts and stops
+/// @param i_rActionContext actions context (functions context)
+/// @param time_seconds timer time span
+/// @param i_eTimerType timer type (once vs multiple call)
+/// @return timer_id of timer being allocated and launched. TIMER_NULL otherwise
+u8 TIMER_StartOwned(char i_cOwner, const actions_t& i_rActions, actions_context_t& i_rActionContext,
+    unsigned long time_seconds, timer_type_t i_eTimerType) {
+    // multiple shot timer is just a periodic one, recalled every second
+    u16 period = (TIMER_SHOT_MULTIPLE == i_eTimerType) ? 1 : 0;
+
+    return timer_start(i_cOwner, i_rActions, i_rActionContext, time_seconds, i_eTimerType, period, 0);
+}
+
+/// @brief Starts a periodic timer. fun_start is called on start and then on every tick, which
+/// are kept at fixed multiples of the period, regardless of callbacks runtime. fun_stop is
+/// called after time_seconds
+/// @param i_cOwner letter of the module owning the timer
+/// @param i_rActions actions that should be triggered when timer starts, ticks and stops
+/// @param i_rActionContext actions context (functions context)
+/// @param time_seconds timer time span
+/// @param i_uPeriod ticks interval in seconds, must not be 0
+/// @param i_uPhase delay of the first tick, 0 means one period
+/// @return timer_id of timer being allocated and launched. TIMER_NULL otherwise
+u8 TIMER_StartPeriodic(char i_cOwner, const actions_t& i_rActions, actions_context_t& i_rActionContext,
+    unsigned long time_seconds, u16 i_uPeriod, u16 i_uPhase) {
+    if (0 == i_uPeriod) {
+        DEB_E(F("ERR: TIMER_StartPeriodic: zero period!\n"));
+        THROW_ERROR();
+        return TIMER_NULL;
+    }
+
+    return timer_start(i_cOwner, i_rActions, i_rActionContext, time_seconds, TIMER_SHOT_MULTIPLE, i_uPeriod, i_uPhase);
+}
+
+/// @brief Returns the number of periodic ticks skipped so far by given timer
+/// @param timer_id timer_id of timer to be checked
+/// @return number of skipped ticks, 0 for bad timers
+u16 TIMER_GetMissedPeriods(u8 timer_id) {
+    u8 i;
+    if (false == timer_getIndex(timer_id, i))
+        return 0;
+
+    return T[i].m_missed;
 }
 
 /// @brief Retrieves function context of given timer
 /// @param timer_id timer_id of which functions contenxt is being retrieved
 /// @return pointer to the structure
 actions_context_t* TIMER_getActionContext(u8 timer_id) {
-    if (TIMER_NULL == timer_id || timer_id >= MAX_TIMERS)
+    u8 i;
+    if (false == timer_getIndex(timer_id, i))
         return NULL;
 
-    return &T[timer_id].m_actions_context;
+    return &T[i].m_actions_context;
 }
 
-/// @brief Restarts given timer
+/// @brief Restarts given timer. Running periodic timer keeps its ticks phase
 /// @param timer_id timer_id which is going to be restarted
 /// @param time_seconds next timer call period
 /// @return result of the operation
 bool TIMER_ReStart(u8 timer_id, unsigned long time_seconds) {
 
     do {
-        if (TIMER_NULL == timer_id || timer_id >= MAX_TIMERS)
+        u8 i;
+        if (false == timer_getIndex(timer_id, i))
             break;
 
-        T[timer_id].time_start = now();
-        T[timer_id].time_stop = T[timer_id].time_start + time_seconds;
-        T[timer_id].active = true;
+        T[i].time_start = now();
+        T[i].time_stop = T[i].time_start + time_seconds;
+        if (false == T[i].active) // restarted from fun_stop, so ticks start over
+            T[i].m_next_tick = T[i].time_start + T[i].m_period;
+        T[i].active = true;
+        timer_setDue(i);
 
         return true;
     } while (0);
@@ -135,47 +398,34 @@ bool TIMER_ReStart(u8 timer_id, unsigned long time_seconds) {
 /// @return result of the operation
 bool TIMER_Stop(u8 timer_id) {
     do {
-        if (TIMER_NULL == timer_id || timer_id >= MAX_TIMERS)
+        u8 i;
+        if (false == timer_getIndex(timer_id, i))
             break;
 
-        IF_DEB_L() {
-            String str(F("TIMER: stop: timer_id="));
-            str += timer_id;
-            str += F(", var1=");
-            str += T[timer_id].m_actions_context.var1;
-            str += F(", var2=");
-            str += T[timer_id].m_actions_context.var2;
-            str += F(", slot=");
-            str += T[timer_id].m_actions_context.slot;
-            str += F(", timer_id=");
-            str += T[timer_id].m_actions_context.timer_id;
-            str += F(", active=");
-            str += T[timer_id].active;
-            str += F(", type=");
-            str += T[timer_id].type;
-            DEB_L(str);
-        }
+        TRACE_L(TRC_TIMER_STOP, timer_id, T[i].m_actions_context.var1, T[i].m_actions_context.var2,
+            T[i].m_actions_context.slot, T[i].active, T[i].type);
 
-        if (false == T[timer_id].active)
+        if (false == T[i].active)
             DEB_E(F("ERR: stopping already stopped timer!\n"));
 
         // first, internal structures clearing
         // that flag will change its state when user calls timer restart
-        T[timer_id].active = false;
+        T[i].active = false;
+        timer_heapRemove(i);
 
         // next, calling STOP function. This function can restart this timer!
-        if (NULL != T[timer_id].m_actions.fun_stop) {
-            (T[timer_id].m_actions.fun_stop)(T[timer_id].m_actions_context);
+        if (NULL != T[i].m_actions.fun_stop) {
+            T[i].m_stopping = true;
+            timer_callAction(i, false);
+            T[i].m_stopping = false;
 
             // we called client's stop, but did he retriggered the timer?
-            if (true == T[timer_id].active) { // we can expect deadline was set
+            if (true == T[i].active) { // we can expect deadline was set
                 // by a client, so this is all
-                IF_DEB_L() {
-                    String str(F("TIMERS: client retriggered the timer"));
-                    DEB_L(str);
-                    MSG_Publish_Debug(str.c_str());
-                }
+                TRACE_L(TRC_TIMER_RETRIGGERED, T[i].m_actions_context.timer_id);
             }
+            else
+                timer_release(i);
         }
         else {
             IF_DEB_W() {
@@ -184,6 +434,7 @@ bool TIMER_Stop(u8 timer_id) {
                 DEB_W(str);
                 MSG_Publish_Debug(str.c_str());
             }
+            timer_release(i);
             THROW_ERROR();
             return false;
         }
@@ -197,11 +448,30 @@ bool TIMER_Stop(u8 timer_id) {
     return false;
 }
 
-/// @brief helper local function to "start" given timer. Can be called multiple times for TIMER_SHOT_MULTIPLE timer type
-/// @param timer_id timer_id which is going to be stopped
-static void timer_TimerFunRecallStart(u8 i_TimerId) {
-    if (NULL != T[i_TimerId].m_actions.fun_start)
-        (T[i_TimerId].m_actions.fun_start)(T[i_TimerId].m_actions_context);
+/// @brief helper local function to "start" given timer. Called on every tick of periodic timers.
+/// Next tick is the previous one plus the period, so the callbacks runtime doesn't accumulate.
+/// Ticks already in the past are skipped and counted
+/// @param i_Index index of the timer to be recalled
+/// @param i_tNow current time
+static void timer_TimerFunRecallStart(u8 i_Index, time_t i_tNow) {
+    timer_entry_t& t = T[i_Index];
+    u16 missed = (u16)((i_tNow - t.m_next_tick) / t.m_period);
+
+    t.m_missed += missed;
+    t.m_next_tick += (time_t)(missed + 1) * t.m_period;
+    timer_setDue(i_Index);
+
+    IF_DEB_W() {
+        if (0 != missed) {
+            String str(F("TIMER: skipped periods="));
+            str += missed;
+            str += F(", timer_id=");
+            str += timer_makeId(i_Index);
+            DEB_W(str);
+        }
+    }
+
+    timer_callAction(i_Index, true);
 }
 
 /// @brief Reset the timer of given id
@@ -209,28 +479,20 @@ static void timer_TimerFunRecallStart(u8 i_TimerId) {
 /// @return result of the operation being true if successfully initialized
 bool TIMER_ResetTimer(u8 i_TimerId) {
     do {
-        if (TIMER_NULL == i_TimerId || i_TimerId >= MAX_TIMERS)
+        u8 i;
+        if (false == timer_getIndex(i_TimerId, i))
             break;
 
-        IF_DEB_L() {
-            String str(F(" timer: shutting down: i_TimerId="));
-            str += i_TimerId;
-            str += F(", var1=");
-            str += T[i_TimerId].m_actions_context.var1;
-            str += F(", var2=");
-            str += T[i_TimerId].m_actions_context.var2;
-            str += F(", slot=");
-            str += T[i_TimerId].m_actions_context.slot;
-            str += F(", i_TimerId=");
-            str += T[i_TimerId].m_actions_context.timer_id;
-            str += F(", active=");
-            str += T[i_TimerId].active;
-            str += F(", type=");
-            str += T[i_TimerId].type;
-            DEB_L(str);
-        }
+        TRACE_L(TRC_TIMER_SHUTDOWN, i_TimerId, T[i].m_actions_context.var1, T[i].m_actions_context.var2,
+            T[i].m_actions_context.slot, T[i].active, T[i].type);
+
+        T[i].active = false;
+        timer_heapRemove(i);
 
-        T[i_TimerId].active = false;
+        // when called from within fun_stop, TIMER_Stop decides about the release,
+        // since the client may still restart the timer
+        if (false == T[i].m_stopping)
+            timer_release(i);
 
         return true;
     } while (0);
@@ -241,26 +503,73 @@ bool TIMER_ResetTimer(u8 i_TimerId) {
     return false;
 }
 
-/// @brief Processes all timer, called once a second
+/// @brief Moves all active timers back with the clock (i.e. NTP sync), so they keep the time left.
+/// Otherwise the heap, keyed on absolute times, would stall for the size of the step
+/// @param i_tNow current time
+static void timer_followClockStep(time_t i_tNow) {
+    if (0 != LastProcessedNow && i_tNow < LastProcessedNow) {
+        const time_t step = i_tNow - LastProcessedNow;
+
+        // all keys move by the same step, so the heap order holds
+        _FOR(h, 0, HeapCount) {
+            timer_entry_t& t = T[H[h]];
+            t.time_start += step;
+            t.time_stop += step;
+            t.m_next_tick += step;
+            t.m_due += step;
+        }
+
+        IF_DEB_W() {
+            String str(F("TIMER: clock stepped back, secs="));
+            str += (u32)(LastProcessedNow - i_tNow);
+            DEB_W(str);
+        }
+    }
+
+    LastProcessedNow = i_tNow;
+}
+
+/// @brief Processes all timer, called once a second. Only expired timers and due periodic ticks are touched
 /// @param  
 void TIMER_ProcessAllTimers(void) {
-    _FOR(i, 0, MAX_TIMERS)
-        if (true == T[i].active) {
+    const time_t _now = now();
 
-            // if a timer is expired, try to shut it down
-            if (T[i].time_stop < now())
-                TIMER_Stop(i);
+    timer_followClockStep(_now);
 
-            // else if timer is multi, just call it each sec
-            else if (TIMER_SHOT_MULTIPLE == T[i].type)
-                timer_TimerFunRecallStart(i);
+    // every pass either removes the top timer or pushes its key to _now, so this loop ends
+    while (HeapCount > 0) {
+        u8 i = H[0];
+        if (T[i].m_due >= _now)
+            break;
+
+        // if a timer is expired, try to shut it down
+        if (T[i].time_stop < _now) {
+            TSTATS_RecordLateness(T[i].m_owner, _now - T[i].time_stop);
+            TIMER_Stop(timer_makeId(i));
         }
+
+        // else it's a periodic timer tick
+        else
+            timer_TimerFunRecallStart(i, _now);
+    }
+}
+
+/// @brief Returns the closest time a timer needs processing at
+/// @param o_tDeadline the timer is due on the first tick after that time
+/// @return false if no timer is active
+bool TIMER_GetNextDeadline(time_t& o_tDeadline) {
+    if (0 == HeapCount)
+        return false;
+
+    o_tDeadline = T[H[0]].m_due;
+    return true;
 }
 
 /// @brief Pritins all active timers
 /// @param  
 void TIMER_PrintActiveTimers(void) {
     bool bFirst = true;
+    const time_t _now = now();
 
     _FOR(i, 0, MAX_TIMERS)
         if (true == T[i].active) {
@@ -269,7 +578,7 @@ void TIMER_PrintActiveTimers(void) {
                 MSG_Publish_Debug(str1.c_str());
                 bFirst = false;
             }
-            time_t diff= T[i].time_stop - now();
+            time_t diff= T[i].time_stop - _now;
             String str(F(" "));
             str += i;
             str += F(": var1=");
@@ -279,7 +588,7 @@ void TIMER_PrintActiveTimers(void) {
             str += F(", slot=");
             str += T[i].m_actions_context.slot;
             str += F(", now=");
-            str += now();
+            str += _now;
             str += F(", Stop=");
             str += T[i].time_stop;
             str += F(" (sec=");
@@ -287,6 +596,12 @@ void TIMER_PrintActiveTimers(void) {
             str += F(")");
             str += F(", type=");
             str += T[i].type;
+            if (0 != T[i].m_period) {
+                str += F(", period=");
+                str += T[i].m_period;
+                str += F(", missed=");
+                str += T[i].m_missed;
+            }
             str += F(", remaining=");
             time_t v= diff/SECS_IN_DAY;
             str += v; diff -= SECS_IN_DAY * v;
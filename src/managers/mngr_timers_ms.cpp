@@ -0,0 +1,233 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "my_common.h"
+#include "mngr_timers.h"
+
+// Module name: millisecond timers
+// Module aim: sub-second scheduling (fades, sequencing, debounce) without blocking the loop.
+// Uses the same actions_t/actions_context_t callbacks as the 1s timers.
+
+// debug facility
+static debug_level_t uDebugLevel = DEBUG_WARN;
+
+// timer_id = generation tag (high bits) | index into TM[] (low bits), as for the 1s timers. So a
+// stale timer_id (i.e. of a finished fade) can't touch a timer reallocated in the meantime
+#if MAX_MS_TIMERS < 8
+#define TIMER_MS_ID_INDEX_BITS (3)
+#elif MAX_MS_TIMERS < 16
+#define TIMER_MS_ID_INDEX_BITS (4)
+#elif MAX_MS_TIMERS < 32
+#define TIMER_MS_ID_INDEX_BITS (5)
+#else
+#error MAX_MS_TIMERS must be lower than 32, to leave room for a generation tag
+#endif
+#define TIMER_MS_ID_INDEX_MASK ((u8)((1 << TIMER_MS_ID_INDEX_BITS) - 1))
+#define TIMER_MS_ID_GEN_MASK ((u8)(0xFF >> TIMER_MS_ID_INDEX_BITS))
+
+typedef struct {
+    bool active;
+    bool m_allocated;
+    bool m_stopping; // inside of fun_stop, so it can be restarted
+    u8 m_gen;        // generation tag, see above
+    timer_type_t type;
+    u16 period_ms;
+    u32 deadline_ms;
+    actions_t m_actions;
+    actions_context_t m_actions_context;
+} ms_timer_t;
+static ms_timer_t TM[MAX_MS_TIMERS];
+
+/// @brief Wrap-safe check whether given deadline has passed
+static inline bool timer_ms_isDue(u32 i_uNow, u32 i_uDeadline) {
+    return (i32)(i_uNow - i_uDeadline) >= 0;
+}
+
+/// @brief Initializes the ms TIMER module
+void TIMER_MS_ModInit(void) {
+    _FOR(u, 0, MAX_MS_TIMERS) {
+        TM[u].active = false;
+        TM[u].m_allocated = false;
+        TM[u].m_stopping = false;
+        TM[u].m_gen = 0;
+        TM[u].type = TIMER_SHOT_ONCE;
+    }
+}
+
+static inline u8 timer_ms_makeId(u8 i_Index) {
+    return (u8)(((TM[i_Index].m_gen & TIMER_MS_ID_GEN_MASK) << TIMER_MS_ID_INDEX_BITS) | i_Index);
+}
+
+/// @brief Translates timer_id into TM[] index, checking the generation tag
+/// @param timer_id timer id as returned by TIMER_MS_Start
+/// @param o_Index index into TM[]
+/// @return false for TIMER_NULL, out of range, not allocated or stale ids
+static bool timer_ms_getIndex(u8 timer_id, u8& o_Index) {
+    if (TIMER_NULL == timer_id)
+        return false;
+
+    o_Index = timer_id & TIMER_MS_ID_INDEX_MASK;
+    if (o_Index >= MAX_MS_TIMERS || false == TM[o_Index].m_allocated)
+        return false;
+
+    return timer_id == timer_ms_makeId(o_Index);
+}
+
+/// @brief Frees the timer, invalidating all its outstanding ids
+static void timer_ms_release(u8 i_Index) {
+    TM[i_Index].active = false;
+    TM[i_Index].m_allocated = false;
+    TM[i_Index].m_gen++;
+}
+
+/// @brief Starts a millisecond timer
+/// @param i_rActions actions that should be triggered when timer starts and stops
+/// @param i_rActionContext actions context (functions context)
+/// @param time_ms timer time span (or period for TIMER_SHOT_MULTIPLE)
+/// @param i_eTimerType timer type (once vs multiple call)
+/// @return timer_id of timer being allocated and launched. TIMER_NULL otherwise
+u8 TIMER_MS_Start(const actions_t& i_rActions, actions_context_t& i_rActionContext,
+    u16 time_ms, timer_type_t i_eTimerType) {
+
+    _FOR(i, 0, MAX_MS_TIMERS)
+        if (false == TM[i].m_allocated) {
+            const u8 timer_id = timer_ms_makeId(i);
+
+            TM[i].m_actions = i_rActions;
+            TM[i].m_actions_context = i_rActionContext;
+            TM[i].m_actions_context.timer_id = timer_id;
+            TM[i].period_ms = time_ms;
+            TM[i].deadline_ms = millis() + time_ms;
+            TM[i].type = i_eTimerType;
+            TM[i].m_allocated = true;
+            TM[i].m_stopping = false;
+            TM[i].active = true;
+
+            // it may stop the timer already, the id is stale then
+            if (NULL != TM[i].m_actions.fun_start)
+                (TM[i].m_actions.fun_start)(TM[i].m_actions_context);
+
+            return timer_id;
+        }
+
+    IF_DEB_W() {
+        String str(F("TIMER_MS: no free timers!"));
+        MSG_Publish_Debug(str.c_str());
+    }
+    THROW_ERROR();
+
+    return TIMER_NULL;
+}
+
+/// @brief Checks whether a ms timer is active
+/// @param timer_id timer_id of timer to be checked
+/// @return boolean value being true if timer is active
+bool TIMER_MS_IsActive(u8 timer_id) {
+    u8 i;
+    if (false == timer_ms_getIndex(timer_id, i))
+        return false;
+
+    return TM[i].active;
+}
+
+/// @brief Retrieves function context of given ms timer
+/// @param timer_id timer_id of which functions contenxt is being retrieved
+/// @return pointer to the structure
+actions_context_t* TIMER_MS_getActionContext(u8 timer_id) {
+    u8 i;
+    if (false == timer_ms_getIndex(timer_id, i))
+        return NULL;
+
+    return &TM[i].m_actions_context;
+}
+
+/// @brief Restarts given ms timer, counting from now. Only running timers, or ones inside of
+/// their stop function, can be restarted
+/// @param timer_id timer_id which is going to be restarted
+/// @param time_ms new time span (or period)
+/// @return result of the operation
+bool TIMER_MS_ReStart(u8 timer_id, u16 time_ms) {
+    u8 i;
+    if (false == timer_ms_getIndex(timer_id, i) || (false == TM[i].active && false == TM[i].m_stopping)) {
+        DEB_E(F("ERR: TIMER_MS_ReStart: bad timer!\n"));
+        THROW_ERROR();
+        return false;
+    }
+
+    TM[i].period_ms = time_ms;
+    TM[i].deadline_ms = millis() + time_ms;
+    TM[i].active = true;
+
+    return true;
+}
+
+/// @brief Stops given ms timer and calls its stop function
+/// @param timer_id timer_id which is going to be stopped
+/// @return result of the operation
+bool TIMER_MS_Stop(u8 timer_id) {
+    u8 i;
+    if (false == timer_ms_getIndex(timer_id, i) || false == TM[i].active) {
+        DEB_E(F("ERR: TIMER_MS_Stop: bad timer!\n"));
+        THROW_ERROR();
+        return false;
+    }
+
+    // cleared first, so the stop function can restart it
+    TM[i].active = false;
+
+    if (NULL != TM[i].m_actions.fun_stop) {
+        TM[i].m_stopping = true;
+        (TM[i].m_actions.fun_stop)(TM[i].m_actions_context);
+        TM[i].m_stopping = false;
+    }
+
+    if (false == TM[i].active)
+        timer_ms_release(i);
+
+    return true;
+}
+
+/// @brief Processes all ms timers, called on every loop iteration
+/// @param  
+void TIMER_MS_ProcessAllTimers(void) {
+    const u32 _now = millis();
+
+    _FOR(i, 0, MAX_MS_TIMERS) {
+        if (false == TM[i].active || false == timer_ms_isDue(_now, TM[i].deadline_ms))
+            continue;
+
+        if (TIMER_SHOT_MULTIPLE != TM[i].type) {
+            TIMER_MS_Stop(timer_ms_makeId(i));
+            continue;
+        }
+
+        // next step is counted from the previous deadline; if we're already late
+        // for it, the missed steps are skipped
+        TM[i].deadline_ms += TM[i].period_ms;
+        if (timer_ms_isDue(_now, TM[i].deadline_ms))
+            TM[i].deadline_ms = _now + TM[i].period_ms;
+
+        if (NULL != TM[i].m_actions.fun_start)
+            (TM[i].m_actions.fun_start)(TM[i].m_actions_context);
+    }
+}
+
+/// @brief Returns time left to the closest ms timer deadline
+/// @param i_uMaxMs returned when no ms timer is active
+/// @return number of milliseconds, never more than i_uMaxMs
+u32 TIMER_MS_GetTimeToNextDeadline(u32 i_uMaxMs) {
+    const u32 _now = millis();
+    u32 ret = i_uMaxMs;
+
+    _FOR(i, 0, MAX_MS_TIMERS)
+        if (true == TM[i].active) {
+            if (timer_ms_isDue(_now, TM[i].deadline_ms))
+                return 0;
+
+            if (TM[i].deadline_ms - _now < ret)
+                ret = TM[i].deadline_ms - _now;
+        }
+
+    return ret;
+}
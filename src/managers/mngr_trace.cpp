@@ -0,0 +1,81 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "my_common.h"
+#include "mngr_trace.h"
+#include "mqtt_publish.h"
+
+#if 1 == N32_CFG_TRACE_ENABLED
+
+// Module name: trace log
+// Module aim: debug messages cost a String formatted at runtime each. Log sites write their
+// ID and raw arguments here instead, frames are published in loop() when half full or old
+// enough, and formatted on the host (tools/trace_decode.cpp).
+//
+// The frame is built in place: header reserved at the beginning, records appended after it.
+// Records coming while the buffer is full are dropped and counted.
+
+static u8 Buf[TRACE_BUFFER_SIZE];
+static u8 Len = TRACE_FRAME_HEADER_LENGTH;
+static u8 Dropped = 0;
+static u16 Seq = 0;
+static u32 FirstMs = 0; // when the oldest record was written
+
+static inline void trace_Put16(u16 v) {
+    Buf[Len++] = v & 0xFF;
+    Buf[Len++] = v >> 8;
+}
+
+/// @brief Stores a record, use TRACE_L() instead
+/// @param i_uId trace_id_t
+/// @param i_pArgs arguments
+/// @param i_uArgc number of arguments
+void TRACE_Log(u8 i_uId, const u32* i_pArgs, u8 i_uArgc) {
+    if (TRACE_RECORD_HEADER_LENGTH + 4 * i_uArgc > TRACE_BUFFER_SIZE - Len) {
+        if (Dropped < 0xFF)
+            Dropped++;
+        return;
+    }
+
+    const u32 nowMs = millis();
+    if (TRACE_FRAME_HEADER_LENGTH == Len)
+        FirstMs = nowMs;
+
+    Buf[Len++] = i_uId;
+    Buf[Len++] = i_uArgc;
+    trace_Put16(nowMs & 0xFFFF);
+
+    _FOR(i, 0, i_uArgc) {
+        trace_Put16(i_pArgs[i] & 0xFFFF);
+        trace_Put16(i_pArgs[i] >> 16);
+    }
+}
+
+/// @brief Publishes the frame when it's half full, or its oldest record waits too long
+void TRACE_ProcessPending(void) {
+    if (TRACE_FRAME_HEADER_LENGTH == Len && 0 == Dropped)
+        return;
+
+    if (Len < TRACE_FLUSH_THRESHOLD && millis() - FirstMs < TRACE_FLUSH_MAX_AGE_MS)
+        return;
+
+    if (!gClient_Mosq.connected())
+        return; // records wait, new ones are dropped when full
+
+    Buf[0] = TRACE_FRAME_VERSION;
+    Buf[1] = Seq & 0xFF;
+    Buf[2] = Seq >> 8;
+    Buf[3] = Dropped;
+
+    char topic[MQTT_MAX_TOPIC_LENGTH + 1];
+
+    // on failure the frame is lost as well, seq tells the host
+    gClient_Mosq.publish(MQTT_TopicStr(MQTT_T_TRACE, topic), Buf, Len);
+
+    Seq++;
+    Len = TRACE_FRAME_HEADER_LENGTH;
+    Dropped = 0;
+}
+
+#endif // N32_CFG_TRACE_ENABLED
@@ -3,10 +3,14 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "my_common.h"
+#include "cmnds_core.h"
+#include "mngr_latency.h"
 
 static debug_level_t uDebugLevel = DEBUG_WARN;
 
 void MQTT_callback(char* topic, byte* payload, unsigned int length) {
+    LAT_MarkReceived();
+
     IF_DEB_L() {
         DEB(F("Msg received ["));
         DEB(topic);
@@ -16,12 +20,27 @@ void MQTT_callback(char* topic, byte* payload, unsigned int length) {
         DEB(F("'\n"));
     }
 
-    // do we have a match?
-    if (0 == strcmp(MQTT_DEVICES_CMNDS, topic))
-        CMNDS_Launch(payload);
-    else {
-        IF_DEB_T() {
-            DEB_T(F(" ignored!"));
+    // do we have a match? Compared in place, with the topic in flash
+    PGM_P cmnds = MQTT_TopicStr_P(MQTT_T_DEVICES_CMNDS);
+    const size_t len = strlen_P(cmnds);
+
+    if (0 == strncmp_P(topic, cmnds, len)) {
+        const char* suffix = topic + len;
+
+        // the common topic, module letter in the payload
+        if (0 == suffix[0]) {
+            CMNDS_Submit(payload, length);
+            return;
         }
+
+        // module topic, ".../<letter>"
+        if ('/' == suffix[0] && suffix[1] >= 'A' && suffix[1] <= 'Z' && 0 == suffix[2]) {
+            CMNDS_SubmitToModule(suffix[1], payload, length);
+            return;
+        }
+    }
+
+    IF_DEB_T() {
+        DEB_T(F(" ignored!"));
     }
 }
@@ -3,9 +3,137 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "my_common.h"
+#include "mngr_pub_queue.h"
+#include "mqtt_publish.h"
 
 //static debug_level_t uDebugLevel = DEBUG_WARN;
 
+// topics table in flash, the prefix with the client name included at compile time
+#define MQTT_TOPIC_DEFINE(ID, STR)                                                          \
+    static const char ID##_str[] PROGMEM = STR;                                             \
+    static_assert(sizeof(STR) + 3 <= MQTT_MAX_TOPIC_LENGTH + 1, "Topic too long: " STR);
+MQTT_TOPICS(MQTT_TOPIC_DEFINE)
+
+#define MQTT_TOPIC_ENTRY(ID, STR) ID##_str,
+static const char* const Topics[MQTT_T_COUNT] PROGMEM = { MQTT_TOPICS(MQTT_TOPIC_ENTRY) };
+
+// topic, '\0', payload, '\0'
+static char MsgBuf[MQTT_MAX_TOPIC_LENGTH + 1 + MQTT_MAX_PAYLOAD_LENGTH + 1];
+static char* MsgPayload = MsgBuf;
+static u8 MsgLen = 0;       // payload length
+static bool MsgOverflow = false;
+
+PGM_P MQTT_TopicStr_P(uint8_t i_uTopic) {
+    if (i_uTopic >= MQTT_T_COUNT)
+        i_uTopic = MQTT_T_DEBUG;
+
+    return (PGM_P)pgm_read_ptr(&Topics[i_uTopic]);
+}
+
+const char* MQTT_TopicStr(uint8_t i_uTopic, char* o_sTopic) {
+    strncpy_P(o_sTopic, MQTT_TopicStr_P(i_uTopic), MQTT_MAX_TOPIC_LENGTH);
+    o_sTopic[MQTT_MAX_TOPIC_LENGTH] = 0;
+
+    return o_sTopic;
+}
+
+/// @brief Starts a new message in the static buffer, previous one is dropped
+/// @param i_uTopic mqtt_topic_t
+/// @param i_uChannel appended to the topic, MQTT_NO_CHANNEL for none
+void MSG_Begin(u8 i_uTopic, u8 i_uChannel) {
+    // fits, as checked at compile time
+    strcpy_P(MsgBuf, MQTT_TopicStr_P(i_uTopic));
+    if (MQTT_NO_CHANNEL != i_uChannel)
+        utoa(i_uChannel, MsgBuf + strlen(MsgBuf), 10);
+
+    MsgPayload = MsgBuf + strlen(MsgBuf) + 1;
+    MsgPayload[0] = 0;
+    MsgLen = 0;
+    MsgOverflow = false;
+}
+
+void MSG_AppendChar(char c) {
+    if (MsgLen >= MQTT_MAX_PAYLOAD_LENGTH) {
+        MsgOverflow = true;
+        return;
+    }
+
+    MsgPayload[MsgLen++] = c;
+    MsgPayload[MsgLen] = 0;
+}
+
+void MSG_AppendStr(const char* str) {
+    while (*str)
+        MSG_AppendChar(*str++);
+}
+
+void MSG_AppendStr_P(PGM_P str) {
+    char c;
+    while (0 != (c = pgm_read_byte(str++)))
+        MSG_AppendChar(c);
+}
+
+void MSG_AppendU32(u32 i_uValue, u8 i_uBase) {
+    char buf[sizeof("4294967295")];
+    MSG_AppendStr(ultoa(i_uValue, buf, i_uBase));
+}
+
+void MSG_AppendI32(i32 i_iValue) {
+    char buf[sizeof("-2147483648")];
+    MSG_AppendStr(ltoa(i_iValue, buf, 10));
+}
+
+void MSG_AppendFloat(float i_fValue, u8 i_uDecimals) {
+    char buf[16];
+    if (i_uDecimals > 6)
+        i_uDecimals = 6;
+    MSG_AppendStr(dtostrf(i_fValue, 1, i_uDecimals, buf));
+}
+
+/// @brief Publishes the message built since MSG_Begin
+/// @return false if the payload didn't fit, or publishing failed
+bool MSG_Send(void) {
+    if (true == MsgOverflow)
+        return false;
+
+    return MSG_Publish(MsgBuf, MsgPayload);
+}
+
+/// @brief Publishes the message built since MSG_Begin as retained. It's queued like command
+/// replies, so it doesn't overwrite the client's buffer, and a newer state of the topic replaces
+/// the waiting one
+/// @return false if the payload didn't fit, or publishing failed
+bool MSG_SendRetained(void) {
+    if (true == MsgOverflow)
+        return false;
+
+#if 1 == N32_CFG_PUB_QUEUE_ENABLED
+    // messages too long for the queue go directly
+    if (strlen(MsgBuf) <= PQUEUE_MAX_TOPIC_LENGTH && MsgLen <= PQUEUE_MAX_PAYLOAD_LENGTH)
+        return PQUEUE_Push(MsgBuf, MsgPayload, PQUEUE_PRIO_CONTROL, true, true);
+#endif // N32_CFG_PUB_QUEUE_ENABLED
+
+    return gClient_Mosq.publish(MsgBuf, MsgPayload, true);
+}
+
+bool MSG_PublishTopic(u8 i_uTopic, u8 i_uChannel, const char* payload) {
+    MSG_Begin(i_uTopic, i_uChannel);
+    MSG_AppendStr(payload);
+    return MSG_Send();
+}
+
+bool MSG_PublishTopic_P(u8 i_uTopic, u8 i_uChannel, PGM_P payload) {
+    MSG_Begin(i_uTopic, i_uChannel);
+    MSG_AppendStr_P(payload);
+    return MSG_Send();
+}
+
+bool MSG_PublishValue(u8 i_uTopic, u8 i_uChannel, i32 i_iValue) {
+    MSG_Begin(i_uTopic, i_uChannel);
+    MSG_AppendI32(i_iValue);
+    return MSG_Send();
+}
+
 bool SERIAL_publish( const char* payload) {
     DEBLN(payload);
     return true;
@@ -15,30 +143,69 @@ bool MQTT_publish(const char* topic, const char* payload) {
     return gClient_Mosq.publish(topic, payload);
 }
 
+#if 1 == N32_CFG_PUB_QUEUE_ENABLED
+/// @brief Works out message priority from its topic
+/// @param topic message topic
+/// @return pqueue_prio_t
+static u8 msg_getPriority(const char* topic) {
+    if (NULL != strstr_P(topic, PSTR("/alarm/")))
+        return PQUEUE_PRIO_ALARM;
+
+    if (NULL != strstr_P(topic, PSTR("/" MQTT_PART_CONTROL "/")))
+        return PQUEUE_PRIO_CONTROL;
+
+    return PQUEUE_PRIO_TELEMETRY;
+}
+
+/// @brief Tells whether a newer message may replace the waiting one. Acks, results, alarms and
+/// errors are never merged, i.e. two acks carry different correlation ids
+static bool msg_isCoalescing(const char* topic, u8 i_uPrio) {
+    return PQUEUE_PRIO_TELEMETRY == i_uPrio && NULL == strstr_P(topic, PSTR("/" MQTT_PART_ERRORS "/"));
+}
+#endif // N32_CFG_PUB_QUEUE_ENABLED
+
 bool MSG_Publish(const char* topic, const char* payload) {
+#if 1 == N32_CFG_PUB_QUEUE_ENABLED
+    // messages too long for the queue go directly
+    if (strlen(topic) <= PQUEUE_MAX_TOPIC_LENGTH && strlen(payload) <= PQUEUE_MAX_PAYLOAD_LENGTH) {
+        const u8 prio = msg_getPriority(topic);
+        return PQUEUE_Push(topic, payload, prio, msg_isCoalescing(topic, prio));
+    }
+#endif // N32_CFG_PUB_QUEUE_ENABLED
+
     return MQTT_publish(topic, payload);
 }
 
+/// @brief Like MSG_Publish, with the topic from the table. Unlike MSG_PublishTopic, payloads
+/// longer than MQTT_MAX_PAYLOAD_LENGTH are published too
+static bool msg_publishTo(u8 i_uTopic, const char* payload) {
+    char topic[MQTT_MAX_TOPIC_LENGTH + 1];
+    return MSG_Publish(MQTT_TopicStr(i_uTopic, topic), payload);
+}
+
 bool MSG_Publish_State(const char* payload) {
-    return MSG_Publish(MQTT_DEV_STATE, payload);
+    return msg_publishTo(MQTT_T_DEV_STATE, payload);
 }
 
 bool MSG_Publish_State_Errors(const char* payload) {
-    return MSG_Publish(MQTT_DEV_STATE_ERRORS, payload);
+    return msg_publishTo(MQTT_T_DEV_STATE_ERRORS, payload);
 }
 
 bool MSG_Publish_State_Buildtime(const char* payload) {
-    return MSG_Publish(MQTT_DEV_STATE_BUILDTIME, payload);
+    return msg_publishTo(MQTT_T_DEV_STATE_BUILDTIME, payload);
 }
 
 bool MSG_Publish_Presence(const char* payload) {
-    return MSG_Publish(MQTT_DEV_PRESENCE, payload);
+    return msg_publishTo(MQTT_T_DEV_PRESENCE, payload);
 }
 
 bool MSG_Publish_Command(const char* payload) {
-    return MSG_Publish(MQTT_DEVICES_CMNDS, payload);
+    return msg_publishTo(MQTT_T_DEVICES_CMNDS, payload);
 }
 
 bool MSG_Publish_Debug(const char* payload) {
-    return MSG_Publish(MQTT_DEBUG, payload);
+    char topic[MQTT_MAX_TOPIC_LENGTH + 1];
+
+    // not queued, so debug messages keep their order
+    return MQTT_publish(MQTT_TopicStr(MQTT_T_DEBUG, topic), payload);
 }
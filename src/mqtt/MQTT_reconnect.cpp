@@ -3,44 +3,122 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "my_common.h"
+#include "mqtt_reconnect.h"
+#include "mngr_state.h"
+#include "mqtt_publish.h"
 
 static debug_level_t uDebugLevel = DEBUG_LOG;
 
+static u32 BackoffMs = MQTT_BACKOFF_MIN_MS; // the base of the next wait
+static u32 WaitMs = 0; // till the next attempt, counted from LastAttemptMs
+static u32 LastAttemptMs = 0;
+static bool bLinkUp = true; // false since DHCP lease lost, till it's bound again
+
+static void mqtt_ResetBackoff(void) {
+    BackoffMs = MQTT_BACKOFF_MIN_MS;
+    WaitMs = 0;
+}
+
+/// @brief Seeds random(), so the backoff jitter differs between nodes. Client name is unique
+/// per node, the address comes from DHCP, and the time taken to get here varies
+static void mqtt_SeedJitter(void) {
+    u32 seed = (u32)Ethernet.localIP() ^ micros();
+
+    for (const char* p = MQTT_CLIENT_NAME; 0 != *p; p++)
+        seed = 31 * seed + *p;
+
+    randomSeed(seed);
+}
+
+void MQTT_OnEthernetMaintain(int i_iDhcpResult) {
+    switch (i_iDhcpResult) {
+    case DHCP_CHECK_REBIND_FAIL:
+        if (true == bLinkUp)
+            DEB_W(F("ERR: MQTT: DHCP lease lost, waiting for the link\n"));
+        bLinkUp = false;
+        break;
+
+    case DHCP_CHECK_RENEW_OK:
+    case DHCP_CHECK_REBIND_OK:
+        // the address could have changed, so no point in waiting
+        bLinkUp = true;
+        mqtt_ResetBackoff();
+        break;
+
+    default: // renew failures are retried by DHCP, the lease is still valid
+        break;
+    }
+}
+
 void MQTT_reconnect() {
+    static bool bSeeded = false;
+
+    if (false == bLinkUp)
+        return;
+
+    if (false == bSeeded) {
+        mqtt_SeedJitter(); // the link is up, so the address is known
+        bSeeded = true;
+    }
+
+    const u32 nowMs = millis();
+    if (nowMs - LastAttemptMs < WaitMs)
+        return; // not yet
+
+    LastAttemptMs = nowMs;
 
     DEB(F("Connecting to MQTT broker\n"));
 
-    // looping until we're connected
-    while (!gClient_Mosq.connected()) {
+    char topic[MQTT_MAX_TOPIC_LENGTH + 1];
 
-        // Attempt to connect
+    // Attempt to connect, just once per call
 #if 1 == N32_CFG_MQTT_SECURE
-        char l_user[MQTT_MAX_USER_LENGTH + 1];
-        char l_passwd[MQTT_MAX_PASSWD_LENGTH + 1];
-        strcpy_P(l_user, (char*)pgm_read_word(&g_mqtt_user));
-        strcpy_P(l_passwd, (char*)pgm_read_word(&g_mqtt_passwd));
+    char l_user[MQTT_MAX_USER_LENGTH + 1];
+    char l_passwd[MQTT_MAX_PASSWD_LENGTH + 1];
+    strcpy_P(l_user, (char*)pgm_read_word(&g_mqtt_user));
+    strcpy_P(l_passwd, (char*)pgm_read_word(&g_mqtt_passwd));
 
-        if (gClient_Mosq.connect(MQTT_CLIENT_NAME, l_user, l_passwd)) {
+#if 1 == N32_CFG_RETAINED_STATE_ENABLED
+    // the broker sets presence to "offline" when the connection drops
+    if (gClient_Mosq.connect(MQTT_CLIENT_NAME, l_user, l_passwd, MQTT_TopicStr(MQTT_T_NODE_PRESENCE, topic),
+            STATE_WILL_QOS, true, STATE_PRESENCE_OFFLINE)) {
+#else
+    if (gClient_Mosq.connect(MQTT_CLIENT_NAME, l_user, l_passwd)) {
+#endif // N32_CFG_RETAINED_STATE_ENABLED
+#else
+#if 1 == N32_CFG_RETAINED_STATE_ENABLED
+    if (gClient_Mosq.connect(MQTT_CLIENT_NAME, MQTT_TopicStr(MQTT_T_NODE_PRESENCE, topic),
+            STATE_WILL_QOS, true, STATE_PRESENCE_OFFLINE)) {
 #else
-        if (gClient_Mosq.connect(MQTT_CLIENT_NAME)) {
+    if (gClient_Mosq.connect(MQTT_CLIENT_NAME)) {
+#endif // N32_CFG_RETAINED_STATE_ENABLED
 #endif
-            // Once connected, publish an announcement...
-            IF_DEB_L() {
-                String str(MQTT_CLIENT_NAME);
-                str += F(" - connected!");
-                MSG_Publish_State( str.c_str());
-                DEB_L(str);
-            }
-
-            // ... and resubscribe
-            gClient_Mosq.subscribe(MQTT_DEVICES_CMNDS);
-        }
-        else {
-            DEB_W(F("ERR: MQTT: failed, rc="));
-            DEB_W(gClient_Mosq.state());
-            DEB_W(F(", trying again soon\n"));
-            // Wait 5 seconds before retrying
-            delay(5000);
+        mqtt_ResetBackoff();
+
+        // Once connected, publish an announcement...
+        IF_DEB_L() {
+            String str(MQTT_CLIENT_NAME);
+            str += F(" - connected!");
+            MSG_Publish_State( str.c_str());
+            DEB_L(str);
         }
+
+        // ... and resubscribe
+        gClient_Mosq.subscribe(MQTT_TopicStr(MQTT_T_DEVICES_CMNDS, topic));
+        gClient_Mosq.subscribe(MQTT_TopicStr(MQTT_T_DEVICES_CMNDS_MODULES, topic));
+
+        // retained ones, the Last Will is replaced with "online"
+        STATE_OnConnected();
+    }
+    else {
+        // jittered, so many nodes don't hit the broker at once after its restart
+        WaitMs = BackoffMs / 2 + random(BackoffMs / 2 + 1);
+        BackoffMs = min(2 * BackoffMs, MQTT_BACKOFF_MAX_MS);
+
+        DEB_W(F("ERR: MQTT: failed, rc="));
+        DEB_W(gClient_Mosq.state());
+        DEB_W(F(", trying again in ms="));
+        DEB_W(WaitMs);
+        DEB_W(F("\n"));
     }
 }
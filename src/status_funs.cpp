@@ -3,6 +3,12 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "my_common.h"
+#include "mngr_timers.h"
+#include "mngr_timer_stats.h"
+#include "cmnds_schedule.h"
+#include "mqtt_publish.h"
+#include "mngr_telemetry.h"
+#include "mngr_state.h"
 
 static debug_level_t uDebugLevel = DEBUG_WARN;
 
@@ -13,11 +19,13 @@ void alarm_30s() {
 
 #if 1==N32_CFG_ANALOG_IN_ENABLED
     _FOR(i, 0, ANALOG_NUM_OF_AVAIL_CHANNELS) {
-        String tim_str(ANALOG_ReadChannel(i));
-        String path_str(MQTT_SENSORS_ANALOG);
-        path_str += i;
-        MSG_Publish(path_str.c_str(), tim_str.c_str());
-        DEB_L(tim_str);
+        const int value = ANALOG_ReadChannel(i);
+#if 1 == N32_CFG_TELEMETRY_ENABLED
+        TELEM_Put('A', i, value);
+#else
+        MSG_PublishValue(MQTT_T_SENSORS_ANALOG, i, value);
+#endif // N32_CFG_TELEMETRY_ENABLED
+        DEB_L(value);
     }
 #endif // 1==N32_CFG_ANALOG_IN_ENABLED
 
@@ -35,20 +43,28 @@ void alarm_30s() {
         MSG_Publish_Debug(str.c_str());
         //DEB_L(str);
     }
-    String str(tempScaled >> 12);
-    str += F(".");
-    str += remainder >> 12;
-    String str1(MQTT_SENSORS_T);
-    str1 += MQTT_SENSORS_T_MATA;
-    MSG_Publish(str1.c_str(), str.c_str());
+#if 1 == N32_CFG_TELEMETRY_ENABLED
+    TELEM_Put('H', 0, (tempScaled * 10) >> 12);
+#else
+    MSG_Begin(MQTT_T_SENSORS_T_MATA, MQTT_NO_CHANNEL);
+    MSG_AppendU32(tempScaled >> 12);
+    MSG_AppendChar('.');
+    MSG_AppendU32(remainder >> 12);
+    MSG_Send();
+#endif // N32_CFG_TELEMETRY_ENABLED
 #endif
+
+#if 1 == N32_CFG_TELEMETRY_ENABLED
+    // end of the reporting window, one frame with everything read since the previous one
+    TELEM_Flush();
+#endif // N32_CFG_TELEMETRY_ENABLED
 }
 
 #define _SEC (1)
 #define _MIN ((u32)60 * _SEC)
 #define _HOUR ((u32)60 * _MIN)
 #define _DAY ((u32)24 * _HOUR)
-static String retUpTime(void) {
+static void status_AppendUpTime(void) {
     time_t diff = now() - gUpTime;
     u32 days = diff / _DAY;
     diff -= days * _DAY;
@@ -57,46 +73,51 @@ static String retUpTime(void) {
     u32 mins = diff / _MIN;
     diff -= mins * _MIN;
 
-    String str;
-    str += days;
-    str += F(" days, ");
-    str += hours;
-    str += F(" hours, ");
-    str += mins;
-    str += F(" mins");
-    return str;
+    MSG_AppendU32(days);
+    MSG_AppendStr_P(PSTR(" days, "));
+    MSG_AppendU32(hours);
+    MSG_AppendStr_P(PSTR(" hours, "));
+    MSG_AppendU32(mins);
+    MSG_AppendStr_P(PSTR(" mins"));
 }
 
 static void timers_ShowErrors(void) {
-    String str(MQTT_CLIENT_NAME);
-    str += F(": ");
-    str += ERR_GetNumberOfGlobalErrors();
-    if (false == MSG_Publish_State_Errors( str.c_str())) {
+    MSG_Begin(MQTT_T_DEV_STATE_ERRORS, MQTT_NO_CHANNEL);
+    MSG_AppendStr(MQTT_CLIENT_NAME);
+    MSG_AppendStr_P(PSTR(": "));
+    MSG_AppendU32(ERR_GetNumberOfGlobalErrors());
+    if (false == MSG_Send()) {
+        DEBLN(F("Failed with publishing! (probably to long)"));
+    }
+}
+
+static void status_PublishState(void) {
+    MSG_Begin(MQTT_T_DEV_STATE, MQTT_NO_CHANNEL);
+    MSG_AppendStr_P(PSTR("Active timers: "));
+    MSG_AppendU32(TIMER_GetNumberOfActiveTimers());
+    MSG_AppendStr_P(PSTR(", Errs: "));
+    MSG_AppendU32(ERR_GetNumberOfGlobalErrors());
+    MSG_AppendStr_P(PSTR(", Up="));
+    status_AppendUpTime();
+    if (false == MSG_Send()) {
         DEBLN(F("Failed with publishing! (probably to long)"));
     }
 }
 
-// once a minute, we want to read all avail nodes addresses and publish it to
-// the broker
 void alarm_1m() {
-    {
-        String str(MQTT_CLIENT_NAME);
-        str += F(": Up=");
-        str += retUpTime();
+#if 0 == N32_CFG_RETAINED_STATE_ENABLED
+    MSG_Begin(MQTT_T_DEV_PRESENCE, MQTT_NO_CHANNEL);
+    MSG_AppendStr(MQTT_CLIENT_NAME);
+    MSG_AppendStr_P(PSTR(": Up="));
+    status_AppendUpTime();
+    if (false == MSG_Send())
+        DEBLN(F("Failed with publishing! (probably to long)"));
 
-        if (false == MSG_Publish_Presence(str.c_str()))
-            DEBLN(F("Failed with publishing! (probably to long)"));
-    }
+    status_PublishState();
+#endif // N32_CFG_RETAINED_STATE_ENABLED
 
-    {
-        String str1(F("Active timers: "));
-        str1 += MAX_TIMERS - TIMER_GetNumberOfFreeTimers();
-        str1 += F(", Errs: ");
-        str1 += ERR_GetNumberOfGlobalErrors();
-        if (false == MSG_Publish_State(str1.c_str())) {
-            DEBLN(F("Failed with publishing! (probably to long)"));
-        }
-    }
+    if (false == TSTATS_PublishCompact())
+        DEBLN(F("Failed with publishing! (probably to long)"));
 }
 
 void alarm_2m() {
@@ -115,11 +136,16 @@ void alarm_2m() {
 #if 1==N32_CFG_QUICK_ACTIONS_ENABLED
     QA_DisplayAssignments();
 #endif // 1 == N32_CFG_QUICK_ACTIONS_ENABLED
+#if 1==N32_CFG_SCHEDULE_ENABLED
+    SCHED_DisplayAssignments();
+#endif // 1==N32_CFG_SCHEDULE_ENABLED
 }
 
-// once a minute, we want to read all avail nodes addresses and publish it to
-// the broker
+// presence and build info are retained, published on connecting. Here, just the summary
 void alarm_15m() {
+#if 1 == N32_CFG_RETAINED_STATE_ENABLED
+    status_PublishState();
+#else
     String str(MQTT_CLIENT_NAME);
     str += F(": ");
     str += APP_VERSION;
@@ -132,6 +158,7 @@ void alarm_15m() {
     }
 
     DEB_L(str);
+#endif // N32_CFG_RETAINED_STATE_ENABLED
 }
 
 void alarm_1h() {
@@ -0,0 +1,28 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Host stand-in for the FastCRC library, bit by bit instead of table driven.
+
+#ifndef HOST_FASTCRC_H
+#define HOST_FASTCRC_H
+
+class FastCRC16 {
+public:
+    // CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, as FastCRC16::ccitt()
+    u16 ccitt(const u8* data, u16 len) { return crc(data, len, 0xFFFF); }
+    // CRC-16/XMODEM: poly 0x1021, init 0
+    u16 xmodem(const u8* data, u16 len) { return crc(data, len, 0); }
+
+private:
+    static u16 crc(const u8* data, u16 len, u16 crc) {
+        while (len--) {
+            crc ^= (u16)(*data++) << 8;
+            _FOR(b, 0, 8)
+                crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+        return crc;
+    }
+};
+
+#endif // HOST_FASTCRC_H
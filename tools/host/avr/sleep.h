@@ -0,0 +1,18 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Host stand-in for <avr/sleep.h>, sleep_cpu() skips the host clock forward, see host_arduino.cpp.
+
+#ifndef HOST_AVR_SLEEP_H
+#define HOST_AVR_SLEEP_H
+
+#define SLEEP_MODE_IDLE 0
+
+void set_sleep_mode(u8 mode);
+void sleep_enable(void);
+void sleep_disable(void);
+void sleep_cpu(void);
+void sleep_mode(void);
+
+#endif // HOST_AVR_SLEEP_H
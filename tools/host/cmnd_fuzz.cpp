@@ -0,0 +1,309 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Command decoders fuzzer & throughput check. Feeds every module decoder with:
+//   - every truncation of a valid command of the module (seeds below), which has to fail
+//     with CMND_ERR_TRUNCATED,
+//   - mutated seeds and random bytes,
+//   - random binary commands, to the binary decoders,
+// and whole frames (prefixes, batches, binary frames, truncated and mutated) to CMNDS_Submit(),
+// executing what gets queued. Each input sits in a heap block of its exact length, so reads
+// past its end are caught when built with AddressSanitizer (see Build). After each decoding the
+// reader has to stay within the frame, and the result has to agree with its error code.
+// Then decodes per second of each seed are reported.
+//
+// Build: make -C tools/host clean cmnd_fuzz SAN="-fsanitize=address,undefined"
+// Usage: tools/host/cmnd_fuzz [-n iterations] [-s seed]
+
+#include "my_common.h"
+#include "cmnds_core.h"
+#include "mngr_modules.h"
+#include "mngr_cmnd_queue.h"
+#include "host.h"
+
+#include <FastCRC.h>
+#include <unistd.h>
+
+#define FUZZ_MAX_REPORTED (20) // failures printed
+#define FUZZ_BENCH_US (200000UL) // per seed
+
+// a valid command of each module accepting text commands, module letter included
+static const char* const Seeds[] = {
+    "I01",
+    "B015S1",
+    "P400501S1",
+    "T101",
+    "Q0I011B015S11",
+    "H1020251S1",
+    "S71",
+    "C006307FB015S11",
+};
+
+static u32 Failures = 0;
+static u32 Decoded = 0; // inputs decoded fine
+static u32 Inputs = 0;
+
+static void fuzz_fail(const char* i_sWhat, const u8* i_pData, size_t i_uLen) {
+    if (++Failures > FUZZ_MAX_REPORTED)
+        return;
+
+    printf("FAIL: %s: '", i_sWhat);
+    _FOR(i, 0, (int)i_uLen)
+        printf((i_pData[i] >= ' ' && i_pData[i] < 0x7F) ? "%c" : "\\x%02X", i_pData[i]);
+    printf("' (%zu bytes)\n", i_uLen);
+}
+
+/// @brief Copies the input to a heap block of its exact length, so overreads hit the redzone
+static u8* fuzz_exact(const u8* i_pData, size_t i_uLen) {
+    u8* p = (u8*)malloc(i_uLen + (0 == i_uLen)); // malloc(0) may return NULL
+    memcpy(p, i_pData, i_uLen);
+    return p;
+}
+
+/// @brief Decodes one text command, checks the reader and the result
+/// @return the error code
+static u8 fuzz_decode(const u8* i_pData, size_t i_uLen) {
+    u8* frame = fuzz_exact(i_pData, i_uLen);
+    cmnd_reader_t r;
+    state_t s;
+
+    CR_Init(r, frame, i_uLen);
+    const bool bOk = CMNDS_decodeCmnd(r, s);
+    Inputs++;
+
+    if (r.m_pos < frame || r.m_pos > frame + i_uLen || (size_t)(r.m_pos - frame) + r.m_left != i_uLen)
+        fuzz_fail("reader out of the frame", i_pData, i_uLen);
+    if (bOk != CR_IsOk(r))
+        fuzz_fail((true == bOk) ? "decoded with an error set" : "failed without an error", i_pData, i_uLen);
+    if (true == bOk)
+        Decoded++;
+
+    free(frame);
+    return r.m_err;
+}
+
+static void fuzz_submit(const u8* i_pData, size_t i_uLen) {
+    u8* frame = fuzz_exact(i_pData, i_uLen);
+    CMNDS_Submit(frame, i_uLen);
+    Inputs++;
+    free(frame);
+
+    // queued commands, executed the way loop() does
+    CQUEUE_ProcessPending(CQUEUE_BUDGET_IN_MS);
+}
+
+static u8 fuzz_randomByte(void) {
+    switch (rand() % 4) {
+    case 0: return '0' + rand() % 10;
+    case 1: return 'A' + rand() % 26;
+    case 2: return ";#@:*"[rand() % 5];
+    default: return rand() % 256;
+    }
+}
+
+/// @brief Flips, inserts or removes a few bytes, or cuts the frame
+static std::string fuzz_mutate(std::string i_sFrame) {
+    const int n = 1 + rand() % 3;
+    _FOR(i, 0, n) {
+        const size_t at = (true == i_sFrame.empty()) ? 0 : rand() % i_sFrame.size();
+        switch (rand() % 4) {
+        case 0:
+            if (false == i_sFrame.empty())
+                i_sFrame[at] = fuzz_randomByte();
+            break;
+        case 1:
+            i_sFrame.insert(at, 1, (char)fuzz_randomByte());
+            break;
+        case 2:
+            if (false == i_sFrame.empty())
+                i_sFrame.erase(at, 1);
+            break;
+        default:
+            i_sFrame.resize(at);
+            break;
+        }
+    }
+    return i_sFrame;
+}
+
+static std::string fuzz_randomCmnd(void) {
+    std::string s(1, "IBPLTQAHSCXZ"[rand() % 12]);
+    const int len = rand() % 24;
+    _FOR(i, 0, len)
+        s += (char)fuzz_randomByte();
+    return s;
+}
+
+static std::string fuzz_binaryFrame(char i_cModule, u8 i_uCommand, u8 i_uChannel, u32 i_uCount,
+    const std::string& i_sArgs) {
+    static FastCRC16 CRC16;
+    std::string f;
+
+    f += (char)CMNDS_BIN_MARKER;
+    f += i_cModule;
+    f += (char)i_uCommand;
+    f += (char)i_uChannel;
+    do { // LEB128
+        f += (char)((i_uCount & 0x7F) | ((i_uCount > 0x7F) ? 0x80 : 0));
+        i_uCount >>= 7;
+    } while (0 != i_uCount);
+    f += i_sArgs;
+
+    const u16 crc = CRC16.ccitt((const u8*)f.data(), f.size());
+    f += (char)(crc >> 8);
+    f += (char)(crc & 0xFF);
+    return f;
+}
+
+static std::string fuzz_randomBinaryFrame(void) {
+    std::string args;
+    const int len = rand() % 4;
+    _FOR(i, 0, len)
+        args += (char)(rand() % 256);
+
+    return fuzz_binaryFrame("IBPTHSQX"[rand() % 8], rand() % 12, rand() % 10, rand() % 100000, args);
+}
+
+/// @brief Random prefixes (sequence number, correlation id) and frame kinds for CMNDS_Submit()
+static std::string fuzz_randomFrame(void) {
+    std::string f;
+
+    if (0 == rand() % 2)
+        f += "@" + std::string(1, 'A' + rand() % 6) + std::to_string(rand() % 3) + ":"
+            + std::to_string(rand() % 70000) + ";";
+    if (0 == rand() % 2)
+        f += "#" + std::to_string(rand() % 70000) + ";";
+
+    switch (rand() % 4) {
+    case 0:
+        f += Seeds[rand() % (sizeof(Seeds) / sizeof(Seeds[0]))];
+        break;
+    case 1: {
+        f += "*";
+        const int n = 1 + rand() % 5;
+        _FOR(i, 0, n)
+            f += std::string((0 == i) ? "" : (0 == rand() % 2) ? ";" : " ")
+                + Seeds[rand() % (sizeof(Seeds) / sizeof(Seeds[0]))];
+        break;
+    }
+    case 2:
+        f += fuzz_randomBinaryFrame();
+        break;
+    default:
+        f += fuzz_randomCmnd();
+        break;
+    }
+
+    return (0 == rand() % 2) ? fuzz_mutate(f) : f;
+}
+
+/// @brief Random binary commands straight to each binary decoder, args in an exact heap block
+static void fuzz_binaryDecoders(void) {
+    for (char letter = 'A'; letter <= 'Z'; letter++) {
+        module_dispatch_t d;
+        if (false == MOD_getDispatch(letter, d) || NULL == d.m_cmnd_bin_decoder)
+            continue;
+
+        u8 raw[8];
+        cmnd_bin_t b;
+        b.command = rand() % 16;
+        b.channel = (0 == rand() % 4) ? rand() % 256 : rand() % 10;
+        b.count = rand();
+        b.args_len = rand() % sizeof(raw);
+        _FOR(i, 0, b.args_len)
+            raw[i] = rand() % 256;
+
+        u8* args = fuzz_exact(raw, b.args_len);
+        b.args = args;
+        state_t s;
+        s.action = letter;
+        d.m_cmnd_bin_decoder(b, s);
+        Inputs++;
+        free(args);
+    }
+}
+
+static void fuzz_throughput(void) {
+    for (const char* seed : Seeds) {
+        module_dispatch_t d;
+        if (false == MOD_getDispatch(seed[0], d))
+            continue;
+        const size_t len = strlen(seed);
+        u32 n = 0;
+        const u32 started = micros();
+        u32 took;
+        do {
+            _FOR(i, 0, 1000) {
+                cmnd_reader_t r;
+                state_t s;
+                CR_Init(r, (const byte*)seed, len);
+                CMNDS_decodeCmnd(r, s);
+            }
+            n += 1000;
+        } while ((took = micros() - started) < FUZZ_BENCH_US);
+
+        printf("%-16s %8.0f decodes/s  %6.1f ns/decode\n", seed, n * 1e6 / took, took * 1e3 / n);
+    }
+}
+
+int main(int argc, char** argv) {
+    u32 iterations = 200000;
+    unsigned seed = 1;
+
+    int opt;
+    while (-1 != (opt = getopt(argc, argv, "n:s:"))) {
+        switch (opt) {
+        case 'n': iterations = strtoul(optarg, NULL, 10); break;
+        case 's': seed = strtoul(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "usage: %s [-n iterations] [-s seed]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    srand(seed);
+    HOST_Setup();
+
+    // seeds decode, all of their truncations don't
+    for (const char* s : Seeds) {
+        module_dispatch_t d;
+        if (false == MOD_getDispatch(s[0], d))
+            continue; // module disabled
+        const size_t len = strlen(s);
+        if (CMND_ERR_NONE != fuzz_decode((const u8*)s, len))
+            fuzz_fail("seed not decoded", (const u8*)s, len);
+
+        _FOR(cut, 0, (int)len)
+            if (CMND_ERR_TRUNCATED != fuzz_decode((const u8*)s, cut))
+                fuzz_fail("truncated, but not CMND_ERR_TRUNCATED", (const u8*)s, cut);
+    }
+
+    _FOR(i, 0, (int)iterations) {
+        switch (i % 4) {
+        case 0: {
+            const std::string f = fuzz_mutate(Seeds[rand() % (sizeof(Seeds) / sizeof(Seeds[0]))]);
+            fuzz_decode((const u8*)f.data(), f.size());
+            break;
+        }
+        case 1: {
+            const std::string f = fuzz_randomCmnd();
+            fuzz_decode((const u8*)f.data(), f.size());
+            break;
+        }
+        case 2:
+            fuzz_binaryDecoders();
+            break;
+        default: {
+            const std::string f = fuzz_randomFrame();
+            fuzz_submit((const u8*)f.data(), f.size());
+            break;
+        }
+        }
+    }
+
+    printf("inputs %u, decoded fine %u, failures %u\n", Inputs, Decoded, Failures);
+    fuzz_throughput();
+
+    return (0 == Failures) ? 0 : 2;
+}
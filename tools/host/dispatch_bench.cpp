@@ -0,0 +1,119 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Module dispatch cost, per module letter, in the MODS[] order:
+//   - before: the lookup commands did before the dispatch table, MOD_getModuleIndex() (a search
+//     of MODS[]) and the module's getCapabilities() building module_caps_t, done once for decoding
+//     and once more for execution,
+//   - after: MOD_getDispatch(), one read of the letter-indexed table, done once per command.
+// Costs are per command, in host nanoseconds and TSC cycles (x86 only). The AVR runs slower,
+// but the "before" one grows with the position of the module in MODS[], the "after" one doesn't.
+//
+// Build: make -C tools/host dispatch_bench
+// Usage: tools/host/dispatch_bench [-t ms_per_letter]
+
+#include "my_common.h"
+#include "mngr_modules.h"
+#include "host.h"
+
+#include <chrono>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC 1
+#endif
+
+#define BENCH_LETTERS "IBPLTQAHSC" // MODS[] order
+#define BENCH_NO_MODULE 'Z'
+
+static volatile uintptr_t Sink; // keeps the lookups from being optimised out
+
+static uint64_t bench_cycles(void) {
+#ifdef BENCH_HAS_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void bench_before(char i_cModule) {
+    _FOR(pass, 0, 2) { // decode, then execute
+        mIndex i;
+        if (false == MOD_getModuleIndex(i_cModule, i)) {
+            Sink = 0;
+            continue;
+        }
+        const module_caps_t caps = MOD_getModuleCapsFunc(i)();
+        Sink = (0 == pass) ? (uintptr_t)caps.m_cmnd_decoder : (uintptr_t)caps.m_cmnd_executor;
+    }
+}
+
+static void bench_after(char i_cModule) {
+    module_dispatch_t d;
+    Sink = (true == MOD_getDispatch(i_cModule, d)) ? (uintptr_t)d.m_cmnd_decoder : 0;
+}
+
+typedef struct {
+    double m_ns;
+    double m_cycles;
+} bench_cost_t;
+
+/// @brief Runs the lookup of the module for about i_uMs milliseconds
+/// @return cost per lookup
+static bench_cost_t bench_measure(u32 i_uMs, void (*i_fLookup)(char), char i_cModule) {
+    const auto started = std::chrono::steady_clock::now();
+    const uint64_t startedCycles = bench_cycles();
+    u32 n = 0;
+    double took;
+    do {
+        _FOR(i, 0, 1024)
+            i_fLookup(i_cModule);
+        n += 1024;
+        took = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+    } while (took < i_uMs * 1e6);
+
+    bench_cost_t c = { took / n, (double)(bench_cycles() - startedCycles) / n };
+    return c;
+}
+
+int main(int argc, char** argv) {
+    u32 msPerLetter = 100;
+
+    int opt;
+    while (-1 != (opt = getopt(argc, argv, "t:"))) {
+        switch (opt) {
+        case 't': msPerLetter = strtoul(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "usage: %s [-t ms_per_letter]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    HOST_Setup();
+
+    printf("%6s %5s %14s %14s %16s %16s\n", "module", "index", "before ns", "after ns", "before cycles",
+        "after cycles");
+
+    const char letters[] = BENCH_LETTERS "Z";
+    for (const char* p = letters; 0 != *p; p++) {
+        mIndex index;
+        const bool bFound = MOD_getModuleIndex(*p, index);
+        if (false == bFound && BENCH_NO_MODULE != *p)
+            continue; // module disabled
+
+        const bench_cost_t before = bench_measure(msPerLetter, bench_before, *p);
+        const bench_cost_t after = bench_measure(msPerLetter, bench_after, *p);
+
+        char sIndex[8];
+        snprintf(sIndex, sizeof(sIndex), (true == bFound) ? "%d" : "none", index);
+        printf("%6c %5s %14.1f %14.1f %16.1f %16.1f\n", *p, sIndex, before.m_ns, after.m_ns, before.m_cycles,
+            after.m_cycles);
+    }
+
+#ifndef BENCH_HAS_TSC
+    printf("(no TSC on this host, cycles are 0)\n");
+#endif
+
+    return 0;
+}
@@ -0,0 +1,23 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Host stand-in for the EEPROM wear levelling library: there is no EEPROM, reads and writes
+// fail, so the modules fall back to their defaults.
+
+#ifndef HOST_EEPROM_WEAR_H
+#define HOST_EEPROM_WEAR_H
+
+template <class T>
+struct myConfigWrapper_s {
+    T& data;
+    myConfigWrapper_s(T& d) : data(d) {}
+};
+
+template <class T>
+struct eeprom_wear_s {
+    bool readCfgAbs(T&, int) { return false; }
+    bool writeCfgAbs(const T&, int) { return false; }
+};
+
+#endif // HOST_EEPROM_WEAR_H
@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Host harness controls, for the tools built against the host stand-ins. Include after "my_common.h".
+//
+// Clock: micros() is the host time spent running plus the time skipped while idle. sleep_cpu()
+// doesn't wait, it skips the clock to the next millis() tick, or to the next message arrival
+// if that comes first. So code run costs host time, and idle costs no time at all. The host is
+// much faster than the 16MHz AVR, so absolute run times are not the board's, but waits
+// (polling periods, drain rates, timers) are.
+//
+// Broker: an in-process stand-in for mosquitto. Messages scheduled with HOST_BrokerSchedule()
+// arrive at the given time, then the W5500 stand-in reports data on the MQTT socket (and
+// fires the INT line ISR, when N32_CFG_W5500_INT_PIN is wired) and PubSubClient::loop()
+// delivers one message per call to the callback, when the client subscribed to its topic.
+
+#ifndef HOST_H
+#define HOST_H
+
+/// Initialises the managers and all modules, as the board's setup() does
+void HOST_Setup(void);
+
+// ---- clock
+
+u32 HOST_Micros(void);
+void HOST_SkipUs(u32 i_uUs);
+
+// ---- pins
+
+typedef void (*host_analog_write_f)(u8 pin, int value, u32 us);
+void HOST_OnAnalogWrite(host_analog_write_f i_fHook);
+int HOST_GetPinValue(u8 pin);
+void HOST_SetPinValue(u8 pin, int value);
+
+// ---- broker
+
+typedef void (*host_publish_f)(const char* topic, const u8* payload, unsigned int length, bool retained, u32 us);
+void HOST_OnPublish(host_publish_f i_fHook);
+
+/// Queues a message to the client, arriving at i_uAtUs (micros() time)
+void HOST_BrokerSchedule(u32 i_uAtUs, const char* topic, const u8* payload, unsigned int length);
+bool HOST_BrokerDeliverNow(const char* topic, const u8* payload, unsigned int length);
+u32 HOST_BrokerPending(void);
+u32 HOST_BrokerPublished(void);
+u32 HOST_BrokerDropped(void);
+
+// topic filter match, MQTT rules: '+' one level, '#' the rest
+bool HOST_TopicMatches(const char* i_sFilter, const char* i_sTopic);
+
+#endif // HOST_H
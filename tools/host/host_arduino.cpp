@@ -0,0 +1,367 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Host stand-ins for the Arduino core, TimeLib, TimeAlarms, the AVR sleep & watchdog calls,
+// the sensors and the board setup code, see host.h for the clock.
+
+#include "my_common.h"
+#include "host.h"
+
+#include <avr/sleep.h>
+
+#include <chrono>
+#include <vector>
+
+// ---- clock
+
+static const std::chrono::steady_clock::time_point Started = std::chrono::steady_clock::now();
+static uint64_t SkippedUs = 0;
+
+static uint64_t host_nowUs(void) {
+    const auto ran = std::chrono::steady_clock::now() - Started;
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(ran).count() + SkippedUs;
+}
+
+u32 HOST_Micros(void) {
+    return (u32)host_nowUs();
+}
+
+void HOST_SkipUs(u32 i_uUs) {
+    SkippedUs += i_uUs;
+}
+
+unsigned long micros(void) {
+    return (u32)host_nowUs();
+}
+
+unsigned long millis(void) {
+    return (u32)(host_nowUs() / 1000);
+}
+
+void delay(unsigned long ms) {
+    SkippedUs += 1000ULL * ms;
+}
+
+// implemented by the broker, the clock stops there when sleeping
+u32 host_BrokerNextArrivalUs(u32 i_uNowUs, u32 i_uLimitUs);
+void host_BrokerOnWakeup(void);
+
+static bool bSleepEnabled = false;
+
+void set_sleep_mode(u8) {}
+void sleep_enable(void) {
+    bSleepEnabled = true;
+}
+void sleep_disable(void) {
+    bSleepEnabled = false;
+}
+
+/// @brief Skips to the next millis() tick (1024us on the AVR), or to the next message arrival
+void sleep_cpu(void) {
+    if (false == bSleepEnabled)
+        return;
+
+    const u32 nowUs = micros();
+    SkippedUs += host_BrokerNextArrivalUs(nowUs, 1024);
+    host_BrokerOnWakeup();
+}
+
+void sleep_mode(void) {
+    sleep_enable();
+    sleep_cpu();
+    sleep_disable();
+}
+
+void cli(void) {}
+void sei(void) {}
+void wdt_reset(void) {}
+
+// ---- pins
+
+static int Pins[HOST_NUM_OF_PINS];
+static void (*Isrs[HOST_NUM_OF_PINS])(void);
+static int IsrModes[HOST_NUM_OF_PINS];
+static host_analog_write_f fAnalogWriteHook = NULL;
+
+void HOST_OnAnalogWrite(host_analog_write_f i_fHook) {
+    fAnalogWriteHook = i_fHook;
+}
+
+int HOST_GetPinValue(u8 pin) {
+    return (pin < HOST_NUM_OF_PINS) ? Pins[pin] : 0;
+}
+
+void HOST_SetPinValue(u8 pin, int value) {
+    if (pin >= HOST_NUM_OF_PINS)
+        return;
+
+    const bool bChanged = Pins[pin] != value;
+    Pins[pin] = value;
+    if (false == bChanged || NULL == Isrs[pin])
+        return;
+
+    const int mode = IsrModes[pin];
+    if (CHANGE == mode || (FALLING == mode && LOW == value) || (RISING == mode && HIGH == value)
+        || (LOW == mode && LOW == value))
+        Isrs[pin]();
+}
+
+void pinMode(u8 pin, u8 mode) {
+    if (INPUT_PULLUP == mode)
+        HOST_SetPinValue(pin, HIGH);
+}
+
+void digitalWrite(u8 pin, u8 value) {
+    if (pin < HOST_NUM_OF_PINS)
+        Pins[pin] = value;
+}
+
+int digitalRead(u8 pin) {
+    return HOST_GetPinValue(pin);
+}
+
+void analogWrite(u8 pin, int value) {
+    if (pin < HOST_NUM_OF_PINS)
+        Pins[pin] = value;
+    if (NULL != fAnalogWriteHook)
+        fAnalogWriteHook(pin, value, micros());
+}
+
+int analogRead(u8 pin) {
+    return HOST_GetPinValue(pin);
+}
+
+void attachInterrupt(int irq, void (*isr)(void), int mode) {
+    if (irq < 0 || irq >= HOST_NUM_OF_PINS)
+        return;
+
+    Isrs[irq] = isr;
+    IsrModes[irq] = mode;
+}
+
+void detachInterrupt(int irq) {
+    if (irq >= 0 && irq < HOST_NUM_OF_PINS)
+        Isrs[irq] = NULL;
+}
+
+// the pins 50..57 of the Mega
+u8 host_PortB(void) {
+    u8 port = 0;
+    _FOR(b, 0, 8)
+        if (0 != HOST_GetPinValue(50 + b))
+            port |= 1 << b;
+    return port;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+long random(long howbig) {
+    return (0 == howbig) ? 0 : rand() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+    return (howsmall >= howbig) ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+    srand(seed);
+}
+
+// ---- avr-libc
+
+static char* host_toa(unsigned long value, bool bNegative, char* str, int base) {
+    char buf[sizeof(unsigned long) * 8 + 1];
+    char* p = buf + sizeof(buf) - 1;
+    *p = 0;
+    do {
+        const unsigned d = value % base;
+        *--p = (d < 10) ? '0' + d : 'a' + d - 10;
+        value /= base;
+    } while (0 != value);
+    if (true == bNegative)
+        *--p = '-';
+    strcpy(str, p);
+    return str;
+}
+
+char* utoa(unsigned value, char* str, int base) {
+    return host_toa(value, false, str, base);
+}
+
+char* ultoa(unsigned long value, char* str, int base) {
+    return host_toa(value, false, str, base);
+}
+
+char* itoa(int value, char* str, int base) {
+    return ltoa(value, str, base);
+}
+
+char* ltoa(long value, char* str, int base) {
+    // avr-libc: only base 10 is signed
+    if (10 == base && value < 0)
+        return host_toa(0UL - (unsigned long)value, true, str, base);
+    return host_toa((u32)value, false, str, base);
+}
+
+char* dtostrf(double value, signed char width, unsigned char prec, char* str) {
+    sprintf(str, "%*.*f", width, prec, value);
+    return str;
+}
+
+// ---- TimeLib, time is set from the start
+
+#define HOST_EPOCH_AT_START (1700000000L)
+
+time_t now(void) {
+    return HOST_EPOCH_AT_START + (time_t)(host_nowUs() / 1000000);
+}
+
+timeStatus_t timeStatus(void) {
+    return timeSet;
+}
+
+static struct tm host_tm(time_t t) {
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    return tm;
+}
+
+int hour(time_t t) { return host_tm(t).tm_hour; }
+int minute(time_t t) { return host_tm(t).tm_min; }
+int weekday(time_t t) { return host_tm(t).tm_wday + 1; }
+int hour(void) { return hour(now()); }
+int minute(void) { return minute(now()); }
+int second(void) { return host_tm(now()).tm_sec; }
+int day(void) { return host_tm(now()).tm_mday; }
+int weekday(void) { return weekday(now()); }
+int month(void) { return host_tm(now()).tm_mon + 1; }
+int year(void) { return host_tm(now()).tm_year + 1900; }
+
+// ---- TimeAlarms, repeated timers only
+
+typedef struct {
+    time_t m_period;
+    time_t m_next;
+    OnTick_t m_fun;
+} host_alarm_t;
+
+static std::vector<host_alarm_t> Alarms;
+static AlarmID_t TriggeredId = 0xFF;
+TimeAlarmsClass Alarm;
+
+AlarmID_t TimeAlarmsClass::timerRepeat(time_t value, OnTick_t onTickHandler) {
+    Alarms.push_back({ value, now() + value, onTickHandler });
+    return (AlarmID_t)(Alarms.size() - 1);
+}
+
+/// @brief Runs the alarms due, then skips the clock by ms, as the library waits servicing alarms
+void TimeAlarmsClass::delay(unsigned long ms) {
+    const time_t t = now();
+    _FOR(i, 0, (int)Alarms.size()) {
+        if (Alarms[i].m_next > t)
+            continue;
+        Alarms[i].m_next = t + Alarms[i].m_period;
+        TriggeredId = i;
+        Alarms[i].m_fun();
+    }
+    TriggeredId = 0xFF;
+
+    ::delay(ms);
+}
+
+time_t TimeAlarmsClass::getNextTrigger(void) {
+    time_t next = 0;
+    for (const host_alarm_t& a : Alarms)
+        if (0 == next || a.m_next < next)
+            next = a.m_next;
+    return next;
+}
+
+AlarmID_t TimeAlarmsClass::getTriggeredAlarmId(void) {
+    return TriggeredId;
+}
+
+// ---- board setup code (setup.cpp is not part of the tree)
+
+time_t gUpTime = 0;
+
+void HOST_Setup(void) {
+    // analog inputs read mid-scale, as a sensor divider would
+    _FOR(pin, PIN_ANALOG_ADC0, PIN_ANALOG_ADC7 + 1)
+        HOST_SetPinValue(pin, 512);
+
+    TIMER_ModInit();
+    CMNDS_ModuleInit();
+    MOD_callAllInitFuns();
+}
+
+void SETUP_RegisterTimer(unsigned long i_uPeriod, void (*i_fFun)(void)) {
+    Alarm.timerRepeat(i_uPeriod, i_fFun);
+}
+
+// the board checks it in its sources, the decoders here pass "1" as the sum
+bool isSumOk(const state_t& s) {
+    return 1 == s.sum;
+}
+
+u32 ERR_GetNumberOfGlobalErrors(void) {
+    return 0;
+}
+
+void ERR_ShowGlobalErrors(void) {}
+
+// ---- sensors
+
+DS18B20 ds18b20_sensors;
+const u8 ds18b20_addrs[DS18B20_SENSORS_COUNT][DS18B20_ADDRESS_SIZE] = {
+    { 0x28, 0x01, 0, 0, 0, 0, 0, 0x00 },
+    { 0x28, 0x02, 0, 0, 0, 0, 0, 0x00 },
+};
+
+u8 OneWire::crc8(const u8* addr, u8 len) {
+    u8 crc = 0;
+    while (len--) {
+        u8 inbyte = *addr++;
+        _FOR(i, 0, 8) {
+            const u8 mix = (crc ^ inbyte) & 0x01;
+            crc >>= 1;
+            if (mix)
+                crc ^= 0x8C;
+            inbyte >>= 1;
+        }
+    }
+    return crc;
+}
+
+static u8 SensorSelected = 0;
+
+bool DS18B20::selectNext(void) {
+    SensorSelected = (SensorSelected + 1) % DS18B20_SENSORS_COUNT;
+    return 0 != SensorSelected;
+}
+
+void DS18B20::getAddress(u8* addr) {
+    memcpy(addr, ds18b20_addrs[SensorSelected], DS18B20_ADDRESS_SIZE);
+}
+
+u8 DS18B20::getNumberOfDevices(void) {
+    return DS18B20_SENSORS_COUNT;
+}
+
+bool DS18B20::select(u8* addr) {
+    _FOR(i, 0, DS18B20_SENSORS_COUNT)
+        if (0 == memcmp(addr, ds18b20_addrs[i], DS18B20_ADDRESS_SIZE)) {
+            SensorSelected = i;
+            return true;
+        }
+    return false;
+}
+
+float DS18B20::getTempC(void) {
+    return 21.5f + SensorSelected;
+}
+
+void DS18B20::doConversion(void) {}
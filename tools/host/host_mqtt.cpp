@@ -0,0 +1,281 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Host stand-ins for Ethernet2, the W5500 driver and PubSubClient, backed by an in-process
+// broker, see host.h.
+
+#include "my_common.h"
+#include "mngr_power.h"
+#include "host.h"
+
+#include "utility/w5500.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#define HOST_MQTT_SOCK (0)
+
+typedef struct {
+    u32 m_seq;
+    u32 m_at_us;
+    std::string m_topic;
+    std::string m_payload;
+} host_msg_t;
+
+static std::deque<host_msg_t> Inbound; // in arrival order
+static std::vector<std::string> Subscriptions;
+static bool bConnected = false;
+static u32 LastSeq = 0;
+static u32 SignalledSeq = 0; // RECV raised for the messages up to this one
+static u8 SocketIr = 0;
+static u32 Published = 0;
+static u32 Dropped = 0;
+static host_publish_f fPublishHook = NULL;
+
+W5500Class w5500;
+EthernetClass Ethernet;
+PubSubClient gClient_Mosq;
+
+// ---- broker
+
+bool HOST_TopicMatches(const char* i_sFilter, const char* i_sTopic) {
+    while (0 != *i_sFilter) {
+        if ('#' == *i_sFilter)
+            return true;
+
+        if ('+' == *i_sFilter) {
+            while (0 != *i_sTopic && '/' != *i_sTopic)
+                i_sTopic++;
+            i_sFilter++;
+            continue;
+        }
+
+        if (*i_sFilter != *i_sTopic)
+            return false;
+        i_sFilter++;
+        i_sTopic++;
+    }
+
+    return 0 == *i_sTopic;
+}
+
+static bool host_isSubscribed(const std::string& i_sTopic) {
+    for (const std::string& filter : Subscriptions)
+        if (true == HOST_TopicMatches(filter.c_str(), i_sTopic.c_str()))
+            return true;
+    return false;
+}
+
+static bool host_isArrived(const host_msg_t& i_rMsg, u32 i_uNowUs) {
+    return (i32)(i_uNowUs - i_rMsg.m_at_us) >= 0;
+}
+
+void HOST_OnPublish(host_publish_f i_fHook) {
+    fPublishHook = i_fHook;
+}
+
+void HOST_BrokerSchedule(u32 i_uAtUs, const char* topic, const u8* payload, unsigned int length) {
+    host_msg_t msg = { ++LastSeq, i_uAtUs, topic, std::string((const char*)payload, length) };
+
+    // kept in arrival order, the load generator schedules in order anyway
+    auto it = Inbound.end();
+    while (it != Inbound.begin() && (i32)((it - 1)->m_at_us - i_uAtUs) > 0)
+        --it;
+    Inbound.insert(it, msg);
+}
+
+/// @brief Hands a message to the callback right away, as PubSubClient::loop() would
+bool HOST_BrokerDeliverNow(const char* topic, const u8* payload, unsigned int length) {
+    if (false == host_isSubscribed(topic))
+        return false;
+
+    std::string t(topic);
+    std::string p((const char*)payload, length);
+    MQTT_callback(&t[0], (byte*)&p[0], length);
+    return true;
+}
+
+u32 HOST_BrokerPending(void) {
+    return Inbound.size();
+}
+
+u32 HOST_BrokerPublished(void) {
+    return Published;
+}
+
+u32 HOST_BrokerDropped(void) {
+    return Dropped;
+}
+
+/// @brief How far the clock may skip in sleep_cpu(): the limit, or less when a message arrives before
+u32 host_BrokerNextArrivalUs(u32 i_uNowUs, u32 i_uLimitUs) {
+    if (true == Inbound.empty() || false == bConnected)
+        return i_uLimitUs;
+
+    const i32 left = (i32)(Inbound.front().m_at_us - i_uNowUs);
+    if (left <= 0)
+        return 0;
+
+    return min((u32)left, i_uLimitUs);
+}
+
+/// @brief Raises RECV, and so INT, when a message has arrived since the last time
+void host_BrokerOnWakeup(void) {
+    const u32 nowUs = micros();
+    u32 arrivedSeq = SignalledSeq;
+    for (const host_msg_t& msg : Inbound) {
+        if (false == host_isArrived(msg, nowUs))
+            break;
+        arrivedSeq = max(arrivedSeq, msg.m_seq);
+    }
+
+    if (arrivedSeq == SignalledSeq)
+        return;
+
+    SignalledSeq = arrivedSeq;
+    SocketIr |= SnIR::RECV;
+#if N32_CFG_W5500_INT_PIN >= 0
+    // INT is low while any socket interrupt is set, the ISR runs on the falling edge only
+    HOST_SetPinValue(N32_CFG_W5500_INT_PIN, LOW);
+#endif // N32_CFG_W5500_INT_PIN
+}
+
+// ---- Ethernet & W5500
+
+int EthernetClass::maintain(void) {
+    return DHCP_CHECK_NONE;
+}
+
+IPAddress EthernetClass::localIP(void) {
+    return IPAddress{ 0x0A00A8C0 }; // 192.168.0.10
+}
+
+void W5500Class::writeSIMR(u8) {}
+
+void W5500Class::writeSnIR(u8 sock, u8 flags) {
+    if (HOST_MQTT_SOCK != sock)
+        return;
+
+    SocketIr &= ~flags;
+#if N32_CFG_W5500_INT_PIN >= 0
+    if (0 == SocketIr)
+        HOST_SetPinValue(N32_CFG_W5500_INT_PIN, HIGH);
+#endif // N32_CFG_W5500_INT_PIN
+}
+
+u8 W5500Class::readSnIR(u8 sock) {
+    return (HOST_MQTT_SOCK == sock) ? SocketIr : 0;
+}
+
+u8 W5500Class::readSnSR(u8 sock) {
+    return (HOST_MQTT_SOCK == sock && true == bConnected) ? SnSR::ESTABLISHED : SnSR::CLOSED;
+}
+
+u16 W5500Class::getRXReceivedSize(u8 sock) {
+    if (HOST_MQTT_SOCK != sock || false == bConnected || true == Inbound.empty())
+        return 0;
+
+    const host_msg_t& msg = Inbound.front();
+    if (false == host_isArrived(msg, micros()))
+        return 0;
+
+    return msg.m_topic.size() + msg.m_payload.size() + 4;
+}
+
+// ---- PubSubClient
+
+bool PubSubClient::connect(const char*) {
+    bConnected = true;
+    return true;
+}
+
+bool PubSubClient::connect(const char* id, const char*, const char*) {
+    return connect(id);
+}
+
+bool PubSubClient::connect(const char* id, const char*, u8, bool, const char*) {
+    return connect(id);
+}
+
+bool PubSubClient::connect(const char* id, const char*, const char*, const char*, u8, bool, const char*) {
+    return connect(id);
+}
+
+bool PubSubClient::connected(void) {
+    return bConnected;
+}
+
+/// @brief Delivers the oldest arrived message, one per call like the library
+bool PubSubClient::loop(void) {
+    if (false == bConnected)
+        return false;
+
+    while (false == Inbound.empty() && true == host_isArrived(Inbound.front(), micros())) {
+        host_msg_t msg = Inbound.front();
+        Inbound.pop_front();
+
+        if (false == host_isSubscribed(msg.m_topic)) {
+            Dropped++;
+            continue;
+        }
+
+        MQTT_callback(&msg.m_topic[0], (byte*)&msg.m_payload[0], msg.m_payload.size());
+        break;
+    }
+
+    return true;
+}
+
+bool PubSubClient::publish(const char* topic, const u8* payload, unsigned int length, bool retained) {
+    if (false == bConnected)
+        return false;
+
+    Published++;
+    if (NULL != fPublishHook)
+        fPublishHook(topic, payload, length, retained, micros());
+    return true;
+}
+
+bool PubSubClient::publish(const char* topic, const u8* payload, unsigned int length) {
+    return publish(topic, payload, length, false);
+}
+
+bool PubSubClient::publish(const char* topic, const char* payload, bool retained) {
+    return publish(topic, (const u8*)payload, strlen(payload), retained);
+}
+
+bool PubSubClient::publish(const char* topic, const char* payload) {
+    return publish(topic, payload, false);
+}
+
+// streamed publishing, collected and published at the end
+static std::string StreamTopic;
+static std::string StreamPayload;
+static bool bStreamRetained = false;
+
+bool PubSubClient::beginPublish(const char* topic, unsigned int, bool retained) {
+    StreamTopic = topic;
+    StreamPayload.clear();
+    bStreamRetained = retained;
+    return bConnected;
+}
+
+size_t PubSubClient::write(const u8* buffer, size_t size) {
+    StreamPayload.append((const char*)buffer, size);
+    return size;
+}
+
+int PubSubClient::endPublish(void) {
+    return publish(StreamTopic.c_str(), (const u8*)StreamPayload.data(), StreamPayload.size(), bStreamRetained);
+}
+
+bool PubSubClient::subscribe(const char* topic) {
+    Subscriptions.push_back(topic);
+    return bConnected;
+}
+
+int PubSubClient::state(void) {
+    return (true == bConnected) ? 0 : -1;
+}
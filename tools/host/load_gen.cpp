@@ -0,0 +1,184 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Load generator: runs the node's loop() on the host against the in-process broker, sends it
+// PWM set commands ("#<id>;P4<channel><percentage>0S1") at a given rate and reports p50/p99 of
+//   - actuation latency: message arrival -> analogWrite() of the value commanded,
+//   - ack latency: message arrival -> ack published on MQTT_T_DEVICES_ACKS,
+// then asks the node for its own latency probe statistics (S7) to compare with.
+// See host.h for what the times mean on the host.
+//
+// Build: make -C tools/host load_gen
+// Usage: tools/host/load_gen [-r rate_per_s] [-n commands] [-p] [-m] [-s seed]
+//   -p  periodic arrivals, Poisson ones by default. A period which is a multiple of the
+//       socket polling period (POWER_NET_POLL_MS) aliases with it, so the latencies are flat
+//   -m  module topic (".../commands/P"), the common one by default
+
+#include "my_common.h"
+#include "mqtt_publish.h"
+#include "host.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unistd.h>
+
+#define LOAD_MAX_DRAIN_US (10000000UL) // after the last arrival, for the acks to come
+
+void loop(void);
+
+typedef struct {
+    u32 m_arrival_us;
+    u8 m_channel;
+    int m_value; // analogWrite() value expected
+    bool m_actuated;
+    bool m_acked;
+} load_cmnd_t;
+
+static std::vector<load_cmnd_t> Cmnds; // index + 1 is the correlation id
+static std::vector<u32> ActuationUs;
+static std::vector<u32> AckUs;
+static u32 AckFailures = 0;
+static std::string ProbeStats;
+
+static void load_onAnalogWrite(u8 pin, int value, u32 us) {
+    if (pin < PWM_PIN_NUM_FIRST || pin >= PWM_PIN_NUM_FIRST + PWM_NUM_OF_AVAIL_CHANNELS)
+        return;
+
+    // commands of a channel are executed in order, so the oldest one waiting is matched
+    const u8 channel = pin - PWM_PIN_NUM_FIRST;
+    for (load_cmnd_t& c : Cmnds) {
+        if (channel != c.m_channel || true == c.m_actuated || (i32)(us - c.m_arrival_us) < 0)
+            continue;
+        if (value != c.m_value)
+            return; // not a command's write
+        c.m_actuated = true;
+        ActuationUs.push_back(us - c.m_arrival_us);
+        return;
+    }
+}
+
+static void load_onPublish(const char* topic, const u8* payload, unsigned int length, bool, u32 us) {
+    char expected[MQTT_MAX_TOPIC_LENGTH + 1];
+    const std::string p((const char*)payload, length);
+
+    if (0 == strcmp(topic, MQTT_TopicStr(MQTT_T_STATS_LATENCY, expected))) {
+        ProbeStats = p;
+        return;
+    }
+
+    if (0 != strcmp(topic, MQTT_TopicStr(MQTT_T_DEVICES_ACKS, expected)))
+        return;
+
+    // "<id>,<rc>,<decode_us>,<exec_us>"
+    const unsigned long id = strtoul(p.c_str(), NULL, 10);
+    const char* rc = strchr(p.c_str(), ',');
+    if (0 == id || id > Cmnds.size() || NULL == rc)
+        return;
+
+    load_cmnd_t& c = Cmnds[id - 1];
+    if (true == c.m_acked)
+        return;
+
+    c.m_acked = true;
+    AckUs.push_back(us - c.m_arrival_us);
+    if (0 != atoi(rc + 1))
+        AckFailures++;
+}
+
+static u32 load_percentile(std::vector<u32>& io_rSamples, u8 i_uPct) {
+    if (true == io_rSamples.empty())
+        return 0;
+
+    std::sort(io_rSamples.begin(), io_rSamples.end());
+    const size_t rank = (io_rSamples.size() * i_uPct + 99) / 100; // nearest rank
+    return io_rSamples[(0 == rank) ? 0 : rank - 1];
+}
+
+static void load_report(const char* i_sName, std::vector<u32>& io_rSamples) {
+    printf("%-10s samples %6zu  p50 %8u us  p99 %8u us  max %8u us\n", i_sName, io_rSamples.size(),
+        load_percentile(io_rSamples, 50), load_percentile(io_rSamples, 99), load_percentile(io_rSamples, 100));
+}
+
+/// @brief Runs loop() till the clock reaches the time given, or the condition is met
+template <class Done>
+static void load_runUntil(u32 i_uUntilUs, Done i_fDone) {
+    while ((i32)(micros() - i_uUntilUs) < 0 && false == i_fDone())
+        loop();
+}
+
+int main(int argc, char** argv) {
+    double rate = 20;
+    u32 count = 1000;
+    bool bPeriodic = false;
+    bool bModuleTopic = false;
+    unsigned seed = 1;
+
+    int opt;
+    while (-1 != (opt = getopt(argc, argv, "r:n:pms:"))) {
+        switch (opt) {
+        case 'r': rate = atof(optarg); break;
+        case 'n': count = strtoul(optarg, NULL, 10); break;
+        case 'p': bPeriodic = true; break;
+        case 'm': bModuleTopic = true; break;
+        case 's': seed = strtoul(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "usage: %s [-r rate_per_s] [-n commands] [-p] [-m] [-s seed]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (rate <= 0 || 0 == count || count > 65535) {
+        fprintf(stderr, "rate has to be > 0, commands 1..65535 (correlation ids)\n");
+        return 1;
+    }
+
+    srand(seed);
+    HOST_Setup();
+    HOST_OnAnalogWrite(load_onAnalogWrite);
+    HOST_OnPublish(load_onPublish);
+
+    // connected and subscribed, before the load starts
+    load_runUntil(micros() + 2000000UL, [] { return false; });
+
+    char topic[MQTT_MAX_TOPIC_LENGTH + 1];
+    MQTT_TopicStr(MQTT_T_DEVICES_CMNDS, topic);
+    if (true == bModuleTopic)
+        strcat(topic, "/P");
+
+    u32 at = micros();
+    _FOR(i, 0, (int)count) {
+        const double gapUs = (true == bPeriodic) ? 1e6 / rate : -log(1.0 - rand() / (RAND_MAX + 1.0)) * 1e6 / rate;
+        at += (u32)gapUs;
+
+        load_cmnd_t c;
+        c.m_arrival_us = at;
+        c.m_channel = rand() % PWM_NUM_OF_AVAIL_CHANNELS;
+        const int percentage = rand() % 101;
+        c.m_value = map(percentage, 0, 100, 0, 255);
+        c.m_actuated = false;
+        c.m_acked = false;
+        Cmnds.push_back(c);
+
+        // the module letter goes in the topic, or in the payload
+        char payload[32];
+        const int len = snprintf(payload, sizeof(payload), "#%d;%s4%u%03d0S1", i + 1,
+            (true == bModuleTopic) ? "" : "P", c.m_channel, percentage);
+        HOST_BrokerSchedule(at, topic, (const u8*)payload, len);
+    }
+
+    load_runUntil(at + LOAD_MAX_DRAIN_US, [] { return 0 == HOST_BrokerPending() && AckUs.size() == Cmnds.size(); });
+
+    // the node's own view
+    MQTT_TopicStr(MQTT_T_DEVICES_CMNDS, topic);
+    HOST_BrokerSchedule(micros(), topic, (const u8*)"S71", 3);
+    load_runUntil(micros() + 2000000UL, [] { return false == ProbeStats.empty(); });
+
+    printf("commands   %u at %.1f/s (%s), acked %zu (%u failed), actuated %zu, dropped by the broker %u\n",
+        count, rate, (true == bPeriodic) ? "periodic" : "Poisson", AckUs.size(), AckFailures, ActuationUs.size(),
+        HOST_BrokerDropped());
+    load_report("actuation", ActuationUs);
+    load_report("ack", AckUs);
+    printf("probe (S7) total,p50,p99,max: %s\n", (true == ProbeStats.empty()) ? "n/a" : ProbeStats.c_str());
+
+    return (AckUs.size() == Cmnds.size() && 0 == AckFailures) ? 0 : 2;
+}
@@ -0,0 +1,511 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Host (Linux, g++) stand-in for the board's "my_common.h", so the sources under src/ can be
+// built natively by the tools in this directory (see Makefile). It provides:
+//   - the Arduino core, TimeLib and TimeAlarms bits used by the sources (host_arduino.cpp),
+//   - PubSubClient, Ethernet and W5500 mocks talking to an in-process broker (host_mqtt.cpp),
+//   - the board configuration: pins, channel counts and module switches.
+// Types and helpers of the board sources which are not part of this tree are stood in for
+// here, as close to their use in src/ as it tells. Timing is host timing, not AVR timing.
+
+#ifndef HOST_MY_COMMON_H
+#define HOST_MY_COMMON_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// before the Arduino min() & max() macros
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int8_t i8;
+typedef int16_t i16;
+typedef int32_t i32;
+typedef uint8_t byte;
+typedef bool boolean;
+
+// ---- flash access, the host has one address space
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+#define pgm_read_byte(a) (*(const u8*)(a))
+#define pgm_read_word(a) (*(const u16*)(a))
+#define pgm_read_dword(a) (*(const u32*)(a))
+#define pgm_read_ptr(a) (*(void* const*)(a))
+#define memcpy_P memcpy
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strstr_P strstr
+
+class __FlashStringHelper;
+#define F(s) ((const __FlashStringHelper*)(s))
+
+// ---- Arduino String, just what the sources use
+
+class String {
+public:
+    String() {}
+    String(const char* s) : m_s(s) {}
+    String(const __FlashStringHelper* s) : m_s((const char*)s) {}
+    explicit String(char c) : m_s(1, c) {}
+    explicit String(int v) : m_s(std::to_string(v)) {}
+    explicit String(unsigned v) : m_s(std::to_string(v)) {}
+    explicit String(long v) : m_s(std::to_string(v)) {}
+    explicit String(unsigned long v, unsigned char base = 10) { append(v, base); }
+    explicit String(float v) : m_s(std::to_string(v)) {}
+
+    String& operator+=(const String& s) { m_s += s.m_s; return *this; }
+    String& operator+=(const char* s) { m_s += s; return *this; }
+    String& operator+=(const __FlashStringHelper* s) { m_s += (const char*)s; return *this; }
+    String& operator+=(char c) { m_s += c; return *this; }
+    String& operator+=(unsigned char v) { m_s += std::to_string(v); return *this; }
+    String& operator+=(int v) { m_s += std::to_string(v); return *this; }
+    String& operator+=(unsigned v) { m_s += std::to_string(v); return *this; }
+    String& operator+=(long v) { m_s += std::to_string(v); return *this; }
+    String& operator+=(unsigned long v) { m_s += std::to_string(v); return *this; }
+    String& operator+=(float v) { m_s += std::to_string(v); return *this; }
+    String& operator+=(double v) { m_s += std::to_string(v); return *this; }
+
+    const char* c_str() const { return m_s.c_str(); }
+    unsigned length() const { return m_s.length(); }
+
+private:
+    void append(unsigned long v, unsigned char base) {
+        char buf[sizeof(unsigned long) * 8 + 1];
+        char* p = buf + sizeof(buf) - 1;
+        *p = 0;
+        do {
+            const unsigned d = v % base;
+            *--p = (d < 10) ? '0' + d : 'A' + d - 10;
+            v /= base;
+        } while (0 != v);
+        m_s += p;
+    }
+
+    std::string m_s;
+};
+
+template <class T>
+String operator+(const String& a, const T& b) {
+    String s(a);
+    s += b;
+    return s;
+}
+
+// ---- Arduino core
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define NOT_AN_INTERRUPT (-1)
+#define PINB (host_PortB())
+#define DEC 10
+#define HEX 16
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define constrain(a, l, h) ((a) < (l) ? (l) : ((a) > (h) ? (h) : (a)))
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+void pinMode(u8 pin, u8 mode);
+void digitalWrite(u8 pin, u8 value);
+int digitalRead(u8 pin);
+void analogWrite(u8 pin, int value);
+int analogRead(u8 pin);
+inline int digitalPinToInterrupt(int pin) { return pin; }
+void attachInterrupt(int irq, void (*isr)(void), int mode);
+u8 host_PortB(void);
+void detachInterrupt(int irq);
+
+char* utoa(unsigned value, char* str, int base);
+char* itoa(int value, char* str, int base);
+char* ultoa(unsigned long value, char* str, int base);
+char* ltoa(long value, char* str, int base);
+char* dtostrf(double value, signed char width, unsigned char prec, char* str);
+
+void wdt_reset(void);
+void cli(void);
+void sei(void);
+
+// ---- TimeLib & TimeAlarms
+
+#define SECS_IN_SEC (1L)
+#define SECS_IN_MINUTE (60L)
+#define SECS_IN_HOUR (3600L)
+#define SECS_IN_DAY (86400L)
+
+enum timeStatus_t { timeNotSet, timeNeedsSync, timeSet };
+time_t now(void);
+timeStatus_t timeStatus(void);
+int hour(void);
+int hour(time_t t);
+int minute(void);
+int minute(time_t t);
+int second(void);
+int day(void);
+int weekday(void);
+int weekday(time_t t);
+int month(void);
+int year(void);
+
+typedef void (*OnTick_t)(void);
+typedef u8 AlarmID_t;
+class TimeAlarmsClass {
+public:
+    void delay(unsigned long ms);
+    time_t getNextTrigger(void);
+    AlarmID_t getTriggeredAlarmId(void);
+    AlarmID_t timerRepeat(time_t value, OnTick_t onTickHandler);
+};
+extern TimeAlarmsClass Alarm;
+
+// ---- network, see host_mqtt.h
+
+#define DHCP_CHECK_NONE 0
+#define DHCP_CHECK_RENEW_FAIL 1
+#define DHCP_CHECK_RENEW_OK 2
+#define DHCP_CHECK_REBIND_FAIL 3
+#define DHCP_CHECK_REBIND_OK 4
+
+struct IPAddress {
+    u32 m_addr;
+    operator uint32_t() const { return m_addr; }
+};
+class EthernetClass {
+public:
+    int maintain(void);
+    IPAddress localIP(void);
+};
+extern EthernetClass Ethernet;
+
+typedef void (*mqtt_callback_f)(char* topic, byte* payload, unsigned int length);
+class PubSubClient {
+public:
+    bool connect(const char* id);
+    bool connect(const char* id, const char* user, const char* pass);
+    bool connect(const char* id, const char* willTopic, u8 willQos, bool willRetain, const char* willMessage);
+    bool connect(const char* id, const char* user, const char* pass, const char* willTopic, u8 willQos,
+        bool willRetain, const char* willMessage);
+    bool connected(void);
+    bool loop(void);
+    bool publish(const char* topic, const char* payload);
+    bool publish(const char* topic, const char* payload, bool retained);
+    bool publish(const char* topic, const u8* payload, unsigned int length);
+    bool publish(const char* topic, const u8* payload, unsigned int length, bool retained);
+    bool beginPublish(const char* topic, unsigned int length, bool retained);
+    size_t write(const u8* buffer, size_t size);
+    int endPublish(void);
+    bool subscribe(const char* topic);
+    int state(void);
+};
+extern PubSubClient gClient_Mosq;
+
+// ---- sensors
+
+class OneWire {
+public:
+    static u8 crc8(const u8* addr, u8 len);
+};
+
+#define DS18B20_ADDRESS_SIZE 8
+class DS18B20 {
+public:
+    bool selectNext(void);
+    void getAddress(u8* addr);
+    u8 getNumberOfDevices(void);
+    bool select(u8* addr);
+    float getTempC(void);
+    void doConversion(void);
+};
+extern DS18B20 ds18b20_sensors;
+
+// ---- debug output, dropped on the host
+
+#define _FOR(i, a, b) for (int i = (a); i < (b); i++)
+
+typedef enum { DEBUG_NONE, DEBUG_ERR, DEBUG_WARN, DEBUG_LOG, DEBUG_TRACE } debug_level_t;
+#define IF_DEB_E() if (uDebugLevel >= DEBUG_ERR)
+#define IF_DEB_W() if (uDebugLevel >= DEBUG_WARN)
+#define IF_DEB_L() if (uDebugLevel >= DEBUG_LOG)
+#define IF_DEB_T() if (uDebugLevel >= DEBUG_TRACE)
+#define DEB(x) (void)(x)
+#define DEBLN(...) (void)0
+#define DEB_E(x) (void)(x)
+#define DEB_W(x) (void)(x)
+#define DEB_L(x) (void)(x)
+#define DEB_T(x) (void)(x)
+#define THROW_ERROR() (void)0
+#define CHECK_MODULE_SANITY() (void)0
+
+// ---- board configuration
+
+#define MQTT_CLIENT_NAME "host_node"
+#define MQTT_CLIENT_SHORT_NAME "h1"
+
+#define N32_SERIAL_ENABLED 0
+#define N32_CFG_ETH_ENABLED 1
+#define N32_CFG_WATCHDOG_ENABLED 1
+#define N32_CFG_BIN_IN_ENABLED 1
+#define N32_CFG_BIN_OUT_ENABLED 1
+#define N32_CFG_PWM_ENABLED 1
+#define N32_CFG_TEMP_ENABLED 1
+#define N32_CFG_QUICK_ACTIONS_ENABLED 1
+#define N32_CFG_ANALOG_IN_ENABLED 1
+#define N32_CFG_HISTERESIS_ENABLED 1
+#define N32_CFG_LED_W2918_ENABLED 0
+#define N32_CFG_WITH_ERR_STORAGE 0
+#define N32_CFG_MQTT_SECURE 0
+
+#define BIN_OUT_LINE_DH_COUNT 4
+#define BIN_OUT_LINE_DL_COUNT 4
+#define BIN_OUT_LINE_DH_FIRST 22
+#define BIN_OUT_LINE_DL_FIRST 30
+#define BIN_OUT_NUM_OF_AVAIL_CHANNELS 8
+#define BIN_IN_LINE_DH_COUNT 4
+#define BIN_IN_LINE_DL_COUNT 4
+#define BIN_IN_LINE_DH_FIRST 40
+#define BIN_IN_LINE_DL_FIRST 44
+#define BIN_IN_NUM_OF_AVAIL_CHANNELS 8
+#define PWM_NUM_OF_AVAIL_CHANNELS 4
+#define PWM_PIN_NUM_FIRST 2
+#define LED_NUM_OF_AVAIL_CHANNELS 0
+#define DS18B20_NUM_OF_AVAIL_CHANNELS 1
+#define DS18B20_SENSORS_COUNT 2
+#define ONEWIRE_PIN_NUM_FIRST 10
+#define HIST_NUM_OF_AVAIL_CHANNELS 2
+#define HIST_LINE_DH_COUNT 1
+#define HIST_DH_FIRST_PIN_NUM 50
+#define HIST_DL_FIRST_PIN_NUM 51
+#define HIST_RESISTANCE_TO_GND 10000UL
+#define HYST_R_STEPS_COUNT 398
+#define HYST_R_MIN 0
+#define HYST_R_MAX 1
+#define HYST_R_STEP_SIZE 1
+#define HYST_T_MIN 0
+#define HYST_T_NULL 0
+#define QUICKACTIONS_NUM_OF_AVAIL_CHANNELS 1
+#define MAX_QA_CMND_LENGTH 12
+#define ANALOG_NUM_OF_AVAIL_CHANNELS 8
+#define PIN_ANALOG_ADC0 54
+#define PIN_ANALOG_ADC1 55
+#define PIN_ANALOG_ADC2 56
+#define PIN_ANALOG_ADC3 57
+#define PIN_ANALOG_ADC4 58
+#define PIN_ANALOG_ADC5 59
+#define PIN_ANALOG_ADC6 60
+#define PIN_ANALOG_ADC7 61
+#define HOST_NUM_OF_PINS 70
+
+#define CMNDS_NUM_OF_AVAIL_SLOTS 32
+#define CMNDS_NUM_OF_AVAIL_MODULES 8
+#define CMNDS_NULL 0xFF
+#define TIMER_NULL 0xFF
+#define TIMERS_NULL 0xFF
+#ifndef MAX_TIMERS // timer_bench builds with more
+#define MAX_TIMERS 24
+#endif
+
+// ---- types shared by the modules
+
+typedef enum { TIMER_SHOT_ONCE, TIMER_SHOT_MULTIPLE } timer_type_t;
+
+typedef struct {
+    u8 var1;
+    u8 var2;
+    u8 slot;
+    u8 timer_id;
+} actions_context_t;
+typedef void (*action_f)(actions_context_t&);
+typedef struct {
+    action_f fun_start;
+    action_f fun_stop;
+} actions_t;
+
+typedef struct {
+    bool active;
+    timer_type_t type;
+    time_t time_start;
+    time_t time_stop;
+    actions_t m_actions;
+    actions_context_t m_actions_context;
+} my_timer_t;
+
+typedef struct {
+    char _topic;
+    u8 _channel;
+    u8 _value;
+} triplet_t;
+
+typedef struct {
+    char action;
+    u8 command;
+    u32 count;
+    u32 seconds;
+    u8 sum;
+    u8 v1;
+    u8 v2;
+    union {
+        struct { u8 channel; u8 pin; } b;
+        struct { u8 channel; } i;
+        struct { u8 channel; u8 pin; u8 percentage; } p;
+        struct { u8 channel; } l;
+        struct { u8 channel; } t;
+        struct { u8 v1; } v;
+        struct { u8 channel; u8 pin; u8 low; u8 high; } h;
+    } c;
+} state_t;
+
+enum { CMND_BIN_OUT_B0_CHANNEL_ON_FOR_NS, CMND_BIN_OUT_B1_RESET_CHANNEL, CMND_BIN_OUT_B2_RESET_ALL_CHANNELS,
+    CMND_BIN_OUT_MAX_VALUE = 2 };
+enum { CMND_BIN_IN_CHANNELS_GET, CMND_BIN_IN_RESET_ALL_CHANNELS, CMND_BIN_IN_MAX_VALUE = 1 };
+enum { CMND_PWM_CHANNEL_ON_FOR_NS = 1, CMND_PWM_FADE, CMND_PWM_FADE_ALL_CHANNELS, CMND_PWM_SET_CHANNEL,
+    CMND_PWM_ALL_CHANNELS_ON_FOR_NS, CMND_PWM_SET_RANDOM_IN_CHANNEL, CMND_PWM_SET_RANDOM_IN_CHANNELS,
+    CMND_PWM_RESET_CHANNEL, CMND_PWM_RESET_ALL_CHANNELS, CMND_PWM_MAX_VALUE = 9 };
+enum { CMND_TEMP_RESET_ALL_INTERFACES, CMND_TEMP_DISPLAY_STATUS, CMND_TEMP_DISPLAY_TEMP,
+    CMND_TEMP_DISPLAY_ADDRESSES, CMND_TEMP_SET_REFRESH_PERIOD, CMND_TEMP_MAX_VALUE = 4 };
+enum { CMND_HIST_H0_RESET_ALL_SETTINGS, CMND_HIST_H1_START_HEATING, CMND_HIST_H2_SHOW_TEMP,
+    CMND_HIST_H3_STOP_HEATING, CMND_HIST_MAX_VALUE };
+enum { CMND_QA_REGISTER_NEW_CMND, CMND_QA_REMOVE_CMND, CMND_QA_CLEAR_ALL_CMNDS, CMND_QA_DISABLE_ALL_CMNDS,
+    CMND_QA_ENABLE_ALL_CMNDS };
+
+typedef enum { BIN_IN_PIN_TYPE_DH, BIN_IN_PIN_TYPE_DL, BIN_IN_LOGICAL_LOW_TRIGGERS_INTERRUPT,
+    BIN_IN_LOGICAL_CHANGE_TRIGGERS_INTERRUPT, BIN_IN_FALLING_EDGE_TRIGGERS_INTERRUPT,
+    BIN_IN_RISING_EDGE_TRIGGERS_INTERRUPT } binn_in_pin_type_t;
+
+typedef enum { PIN_T } pint_type_e;
+typedef bool (*getPhysicalPinFromLogical_f)(u8, u8&);
+typedef struct {
+    getPhysicalPinFromLogical_f m_Fun;
+    u8 m_pins_count;
+    u8 m_log_first_pin;
+    const __FlashStringHelper* m_module_name;
+} pin_group_t;
+
+typedef bool (*cmnd_decoder_f)(const byte*, state_t&, u8*);
+typedef bool (*cmnd_executor_f)(const state_t&);
+typedef struct module_caps_s {
+    bool m_is_input;
+    u8 m_number_of_channels;
+    const __FlashStringHelper* m_module_name;
+    void (*m_mod_init)(void);
+    cmnd_decoder_f m_cmnd_decoder;
+    cmnd_executor_f m_cmnd_executor;
+} module_caps_t;
+typedef module_caps_t (*modCapabilities_f)(void);
+typedef struct {
+    char m_module_letter;
+    const char* m_module_name;
+    modCapabilities_f m_get_caps;
+} module_funs_t;
+typedef int mIndex;
+
+#include "cfg_global.h"
+
+extern time_t gUpTime;
+extern const u8 ds18b20_addrs[DS18B20_SENSORS_COUNT][DS18B20_ADDRESS_SIZE];
+extern const u32 hist_data[];
+
+// ---- functions shared by the modules
+
+bool isSumOk(const state_t& s);
+u32 getSecondsFromNumberAndScale(char number, char scale);
+u8 getDecodedChannelNum(u8 uRawNumber);
+
+bool MSG_Publish(const char* topic, const char* payload);
+bool MSG_Publish_Debug(const char* payload);
+bool MSG_Publish_State(const char* payload);
+bool MSG_Publish_State_Errors(const char* payload);
+bool MSG_Publish_State_Buildtime(const char* payload);
+bool MSG_Publish_Presence(const char* payload);
+bool MSG_Publish_Command(const char* payload);
+bool SERIAL_publish(const char* payload);
+bool MQTT_publish(const char* topic, const char* payload);
+void MQTT_reconnect(void);
+void MQTT_callback(char* topic, byte* payload, unsigned int length);
+
+u8 TIMER_Start(const actions_t& i_rActions, actions_context_t& i_rContext, unsigned long i_uSecs,
+    timer_type_t i_eType = TIMER_SHOT_ONCE);
+bool TIMER_ReStart(u8 timer_id, unsigned long i_uSecs);
+bool TIMER_Stop(u8 timer_id);
+bool TIMER_ResetTimer(u8 timer_id);
+bool TIMER_IsActive(u8 timer_id);
+actions_context_t* TIMER_getActionContext(u8 timer_id);
+void TIMER_ProcessAllTimers(void);
+void TIMER_PrintActiveTimers(void);
+u8 TIMER_GetNumberOfFreeTimers(void);
+void TIMER_ModInit(void);
+
+u8 CMNDS_GetSlotNumber(const state_t& s);
+bool CMNDS_ScheduleAction(const state_t& s, actions_t& i_rActions, actions_context_t& i_rContext);
+bool CMNDS_ResetSlotState(u8 slot);
+bool CMNDS_ResetAllSlotStates(const state_t& s);
+u8 CMNDS_GetFirstSlotNumber(char i_cModule);
+u8 CMNDS_GetSlotsCount(char i_cModule);
+bool CMNDS_isSlotActive(u8 slot);
+bool CMNDS_decodeCmnd(const byte* payload, state_t& s, u8* o_uCmndLen = NULL);
+bool CMNDS_executeCmnd(state_t& s);
+bool CMNDS_Launch(byte* payload);
+char CMNDS_GetModuleID(u8 i_uModule);
+u8 CMNDS_GetNumOfAvailSubModules(void);
+bool CMNDS_RegisterSubModule(char i_cModule);
+void CMNDS_DisplayAssignments(void);
+void CMNDS_ModuleInit(void);
+
+bool MOD_getModuleIndex(char i_cModule, mIndex& o_rIndex);
+const module_funs_t& MOD_getModuleSlot(mIndex i_Index);
+const modCapabilities_f MOD_getModuleCapsFunc(mIndex i_Index);
+bool MOD_callAllInitFuns(void);
+
+module_caps_t BIN_IN_getCapabilities(void);
+module_caps_t BIN_OUT_getCapabilities(void);
+module_caps_t PWM_getCapabilities(void);
+module_caps_t LED_getCapabilities(void);
+module_caps_t TEMP_getCapabilities(void);
+module_caps_t QA_getCapabilities(void);
+module_caps_t ANALOG_getCapabilities(void);
+module_caps_t HYST_getCapabilities(void);
+
+void SETUP_RegisterTimer(unsigned long i_uPeriod, void (*i_fFun)(void));
+bool PIN_RegisterPins(getPhysicalPinFromLogical_f i_fTransform, int i_Count, const __FlashStringHelper* i_pModule,
+    int i_LogicalFirstPin = 0);
+void PIN_DisplayAssignments(void);
+int ANALOG_ReadChannel(u8 channel);
+int ANALOG_ReadChannelN(u8 channel, u8 samples);
+u32 HYSTERESIS_getTempScaled(u8 channel);
+u32 HYSTERESIS_getTemp(u8 channel);
+void HIST_DisplayAssignments(void);
+bool QA_isStateTracked(char i_cModule, u8 i_uChannel, u8 i_uValue, u8& o_uIndex);
+bool QA_ExecuteCommand(u8 i_uIndex);
+void QA_DisplayAssignments(void);
+u32 ERR_GetNumberOfGlobalErrors(void);
+void ERR_ShowGlobalErrors(void);
+void printDigits(int digits);
+
+#endif // HOST_MY_COMMON_H
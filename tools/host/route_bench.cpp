@@ -0,0 +1,126 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// MQTT_callback() cost per message, by the topic it comes on:
+//   - now: MQTT_callback(), so topic routing, decoding and queueing of the command, and the
+//     latency probe's receipt stamp, a micros() read whose host cost is printed too,
+//   - before: the routing done before the module topics, a String of the commands topic built
+//     from flash and strcmp()'d with the topic, then CMNDS_Submit() when it matched. That
+//     routing only knew the common topic, so the module topic rows have no "before".
+// Messages are passed CQUEUE_SIZE at a time, then the queue is drained outside of the timing.
+// Times are host nanoseconds, so only the ratios carry to the AVR.
+//
+// Build: make -C tools/host route_bench
+// Usage: tools/host/route_bench [-t ms_per_row]
+
+#include "my_common.h"
+#include "cmnds_core.h"
+#include "mngr_cmnd_queue.h"
+#include "mqtt_publish.h"
+#include "host.h"
+
+#include <chrono>
+#include <unistd.h>
+
+typedef struct {
+    const char* m_name;
+    const char* m_suffix; // appended to the commands topic, NULL for a topic of its own
+    const char* m_payload;
+    bool m_queued; // the command has to end up in the queue
+} route_msg_t;
+
+static const route_msg_t Msgs[] = {
+    { "common topic", "", "P400501S1", true },
+    { "module topic", "/P", "400501S1", true },
+    { "unknown module", "/Z", "400501S1", false },
+    { "other topic", NULL, "P400501S1", false },
+};
+
+static u32 Wrong = 0; // batches not queued as expected
+
+static void route_before(char* topic, byte* payload, unsigned int length) {
+    if (0 == strcmp(C_WRAPPER("ard/" MQTT_CLIENT_SHORT_NAME "/control/commands"), topic))
+        CMNDS_Submit(payload, length);
+}
+
+static volatile u32 Sink; // keeps the read from being optimised out
+
+static void route_micros(char*, byte*, unsigned int) {
+    Sink = micros();
+}
+
+static void route_now(char* topic, byte* payload, unsigned int length) {
+    MQTT_callback(topic, payload, length);
+}
+
+/// @brief Passes the message to the callback for about i_uMs milliseconds
+/// @return nanoseconds per message
+static double route_measure(u32 i_uMs, void (*i_fCallback)(char*, byte*, unsigned int), const route_msg_t& i_rMsg,
+    char* topic) {
+    // the callback gets a buffer it may write to, as PubSubClient's one
+    byte payload[32];
+    const unsigned int length = strlen(i_rMsg.m_payload);
+    memcpy(payload, i_rMsg.m_payload, length);
+
+    double took = 0;
+    u32 n = 0;
+    do {
+        const auto started = std::chrono::steady_clock::now();
+        _FOR(i, 0, CQUEUE_SIZE)
+            i_fCallback(topic, payload, length);
+        took += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+        n += CQUEUE_SIZE;
+
+        if (CQUEUE_GetDepth() != ((true == i_rMsg.m_queued) ? CQUEUE_SIZE : 0))
+            Wrong++;
+        CQUEUE_ProcessPending(CQUEUE_BUDGET_IN_MS);
+    } while (took < i_uMs * 1e6);
+
+    return took / n;
+}
+
+int main(int argc, char** argv) {
+    u32 msPerRow = 100;
+
+    int opt;
+    while (-1 != (opt = getopt(argc, argv, "t:"))) {
+        switch (opt) {
+        case 't': msPerRow = strtoul(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "usage: %s [-t ms_per_row]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    HOST_Setup();
+
+    printf("%-16s %-32s %10s %10s\n", "message", "topic", "now ns", "before ns");
+
+    for (const route_msg_t& m : Msgs) {
+        char topic[MQTT_MAX_TOPIC_LENGTH + 1];
+        if (NULL == m.m_suffix)
+            strcpy(topic, "ard/" MQTT_CLIENT_SHORT_NAME "/control/other");
+        else {
+            MQTT_TopicStr(MQTT_T_DEVICES_CMNDS, topic);
+            strcat(topic, m.m_suffix);
+        }
+
+        const double now = route_measure(msPerRow, route_now, m, topic);
+        printf("%-16s %-32s %10.1f", m.m_name, topic, now);
+
+        // the module topics weren't routed before
+        if (NULL != m.m_suffix && 0 != m.m_suffix[0])
+            printf(" %10s\n", "n/a");
+        else
+            printf(" %10.1f\n", route_measure(msPerRow, route_before, m, topic));
+    }
+
+    const route_msg_t none = { "", NULL, "", false };
+    printf("micros() %.1f ns\n", route_measure(msPerRow, route_micros, none, NULL));
+
+    if (0 != Wrong)
+        printf("%u batches not queued as expected\n", Wrong);
+
+    return (0 == Wrong) ? 0 : 2;
+}
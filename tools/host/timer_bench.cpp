@@ -0,0 +1,144 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Timer tick cost against the number of active timers. For each count of active timers it reports
+//   - idle: TIMER_ProcessAllTimers() when no timer is due, the tick of almost every second,
+//   - scan: the same tick done the way it was before the heap, a walk of all MAX_TIMERS entries
+//     reading the clock for each active one (a copy of that loop, on a table of the same size),
+//   - expiry: TIMER_ProcessAllTimers() when all the timers expire at once, per expired timer.
+// Times are the host's, so only the ratios between the columns carry to the AVR.
+//
+// Build: make -C tools/host clean timer_bench CFG="-DMAX_TIMERS=254"
+// Usage: tools/host/timer_bench [-t ms_per_point]
+
+#include "my_common.h"
+#include "mngr_timers.h"
+#include "host.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unistd.h>
+
+#define BENCH_EXPIRY_ROUNDS (200) // single ticks timed per point, the median is reported
+
+static u32 Stopped = 0;
+
+static void bench_onStop(actions_context_t&) {
+    Stopped++;
+}
+
+static const actions_t Actions = { NULL, bench_onStop };
+
+static double bench_nowNs(void) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// @brief Restarts the manager with i_uCount timers expiring in i_uSecs seconds
+static void bench_startTimers(u8 i_uCount, unsigned long i_uSecs) {
+    TIMER_ModInit();
+    _FOR(i, 0, i_uCount) {
+        actions_context_t ctx = { (u8)i, 0, 0, 0 };
+        // spread over a few seconds, so the heap is not a list of equal keys
+        if (TIMER_NULL == TIMER_Start(Actions, ctx, i_uSecs + i % 4))
+            printf("TIMER_Start failed at %d\n", i);
+    }
+}
+
+// ---- the tick before the heap, on a table of its own
+
+static my_timer_t Flat[MAX_TIMERS];
+
+static void bench_flatStart(u8 i_uCount) {
+    _FOR(i, 0, MAX_TIMERS) {
+        Flat[i].active = i < i_uCount;
+        Flat[i].type = TIMER_SHOT_ONCE;
+        Flat[i].time_stop = now() + 3600;
+    }
+}
+
+static void bench_flatTick(void) {
+    _FOR(i, 0, MAX_TIMERS)
+        if (true == Flat[i].active) {
+            if (Flat[i].time_stop < now())
+                Stopped++;
+            else if (TIMER_SHOT_MULTIPLE == Flat[i].type)
+                Stopped++;
+        }
+}
+
+/// @brief Runs the tick for about i_uMs milliseconds
+/// @return nanoseconds per tick
+template <class Tick>
+static double bench_perTick(u32 i_uMs, Tick i_fTick) {
+    const double started = bench_nowNs();
+    u32 n = 0;
+    double took;
+    do {
+        _FOR(i, 0, 256)
+            i_fTick();
+        n += 256;
+    } while ((took = bench_nowNs() - started) < i_uMs * 1e6);
+
+    return took / n;
+}
+
+/// @return median nanoseconds per expired timer, when i_uCount expire in one tick
+static double bench_expiry(u8 i_uCount) {
+    std::vector<double> perTimer;
+
+    _FOR(r, 0, BENCH_EXPIRY_ROUNDS) {
+        bench_startTimers(i_uCount, 1);
+        HOST_SkipUs(6000000UL); // all past their stop time
+
+        const u32 stoppedBefore = Stopped;
+        const double started = bench_nowNs();
+        TIMER_ProcessAllTimers();
+        const double took = bench_nowNs() - started;
+
+        if (Stopped - stoppedBefore != i_uCount || 0 != TIMER_GetNumberOfActiveTimers())
+            printf("expiry: %u of %u timers stopped\n", Stopped - stoppedBefore, i_uCount);
+        perTimer.push_back(took / i_uCount);
+    }
+
+    std::sort(perTimer.begin(), perTimer.end());
+    return perTimer[perTimer.size() / 2];
+}
+
+int main(int argc, char** argv) {
+    u32 msPerPoint = 100;
+
+    int opt;
+    while (-1 != (opt = getopt(argc, argv, "t:"))) {
+        switch (opt) {
+        case 't': msPerPoint = strtoul(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "usage: %s [-t ms_per_point]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    HOST_Setup();
+
+    printf("MAX_TIMERS %d\n", MAX_TIMERS);
+    printf("%7s %12s %12s %16s\n", "active", "idle ns", "scan ns", "expiry ns/timer");
+
+    std::vector<int> counts;
+    for (int n = 1; n < MAX_TIMERS; n *= 2)
+        counts.push_back(n);
+    counts.push_back(MAX_TIMERS);
+
+    for (int n : counts) {
+        bench_startTimers(n, 3600);
+        const double idle = bench_perTick(msPerPoint, TIMER_ProcessAllTimers);
+        if (n != TIMER_GetNumberOfActiveTimers())
+            printf("idle: %u of %d timers left\n", TIMER_GetNumberOfActiveTimers(), n);
+
+        bench_flatStart(n);
+        const double scan = bench_perTick(msPerPoint, bench_flatTick);
+
+        printf("%7d %12.1f %12.1f %16.1f\n", n, idle, scan, bench_expiry(n));
+    }
+
+    return 0;
+}
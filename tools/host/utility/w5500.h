@@ -0,0 +1,36 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Host stand-in for the Ethernet2 W5500 driver, backed by the in-process broker (host_mqtt.cpp):
+// socket 0 is the MQTT connection, it has data to read when a message is due.
+
+#ifndef HOST_UTILITY_W5500_H
+#define HOST_UTILITY_W5500_H
+
+#define MAX_SOCK_NUM 8
+
+struct SnIR {
+    static const u8 SEND_OK = 0x10;
+    static const u8 TIMEOUT = 0x08;
+    static const u8 RECV = 0x04;
+    static const u8 DISCON = 0x02;
+    static const u8 CON = 0x01;
+};
+
+struct SnSR {
+    static const u8 CLOSED = 0x00;
+    static const u8 ESTABLISHED = 0x17;
+};
+
+class W5500Class {
+public:
+    void writeSIMR(u8 mask);
+    void writeSnIR(u8 sock, u8 flags);
+    u8 readSnIR(u8 sock);
+    u8 readSnSR(u8 sock);
+    u16 getRXReceivedSize(u8 sock);
+};
+extern W5500Class w5500;
+
+#endif // HOST_UTILITY_W5500_H
@@ -0,0 +1,146 @@
+// SPDX-FileCopyrightText: 2021 Sebastian Serewa <neos32.project@gmail.com>
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Host side decoder of the binary trace log frames (see include/trace_ids.h).
+//
+// Build: g++ -O2 -o trace_decode tools/trace_decode.cpp
+// Usage: mosquitto_sub -h <broker> -t 'ard/+/debug/trace' -F '%x' | ./trace_decode
+//
+// Each input line is one frame, hex encoded.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/trace_ids.h"
+
+#define TRACE_FORMAT_STR(ID, FMT) FMT,
+static const char* const Formats[TRC_COUNT] = { TRACE_IDS(TRACE_FORMAT_STR) };
+
+static int hexNibble(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static size_t hexDecode(const char* line, uint8_t* out, size_t maxLen) {
+    size_t n = 0;
+
+    while (n < maxLen) {
+        const int hi = hexNibble(line[0]);
+        if (hi < 0)
+            break;
+        const int lo = hexNibble(line[1]);
+        if (lo < 0)
+            break;
+
+        out[n++] = (uint8_t)(hi << 4 | lo);
+        line += 2;
+    }
+
+    return n;
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return (uint32_t)get16(p) | (uint32_t)get16(p + 2) << 16;
+}
+
+/// @brief Prints the format, each %u, %d, %x or %c replaced by the next argument
+static void printRecord(const char* fmt, const uint32_t* args, unsigned argc) {
+    unsigned a = 0;
+
+    for (; *fmt; fmt++) {
+        if ('%' != fmt[0] || 0 == fmt[1]) {
+            putchar(*fmt);
+            continue;
+        }
+
+        const char spec = *++fmt;
+        if ('%' == spec) {
+            putchar('%');
+            continue;
+        }
+        if (a >= argc) {
+            fputs("<?>", stdout);
+            continue;
+        }
+
+        const uint32_t v = args[a++];
+        switch (spec) {
+        case 'd': printf("%ld", (long)(int32_t)v); break;
+        case 'x': printf("%lx", (unsigned long)v); break;
+        case 'c': putchar((char)v); break;
+        default: printf("%lu", (unsigned long)v); break;
+        }
+    }
+
+    // arguments not in the format
+    for (; a < argc; a++)
+        printf(" [%lu]", (unsigned long)args[a]);
+
+    putchar('\n');
+}
+
+static void decodeFrame(const uint8_t* buf, size_t len, long& expectedSeq) {
+    if (len < TRACE_FRAME_HEADER_LENGTH || TRACE_FRAME_VERSION != buf[0]) {
+        fprintf(stderr, "bad frame, length=%u\n", (unsigned)len);
+        return;
+    }
+
+    const uint16_t seq = get16(buf + 1);
+    if (expectedSeq >= 0 && seq != (uint16_t)expectedSeq)
+        printf("--- %u frame(s) lost\n", (unsigned)(uint16_t)(seq - expectedSeq));
+    expectedSeq = (uint16_t)(seq + 1);
+
+    size_t pos = TRACE_FRAME_HEADER_LENGTH;
+    while (pos + TRACE_RECORD_HEADER_LENGTH <= len) {
+        const uint8_t id = buf[pos];
+        const uint8_t argc = buf[pos + 1];
+        const uint16_t ms = get16(buf + pos + 2);
+        pos += TRACE_RECORD_HEADER_LENGTH;
+
+        if (argc > TRACE_MAX_ARGS || pos + 4 * argc > len) {
+            fprintf(stderr, "truncated record, id=%u\n", id);
+            return;
+        }
+
+        uint32_t args[TRACE_MAX_ARGS];
+        for (unsigned i = 0; i < argc; i++, pos += 4)
+            args[i] = get32(buf + pos);
+
+        printf("[%5u] ", ms);
+        if (id < TRC_COUNT)
+            printRecord(Formats[id], args, argc);
+        else {
+            printf("unknown id=%u", id);
+            printRecord("", args, argc);
+        }
+    }
+
+    // dropped while this frame was full
+    if (0 != buf[3])
+        printf("--- %u record(s) dropped on the device\n", buf[3]);
+}
+
+int main(void) {
+    static char line[4096];
+    static uint8_t frame[sizeof(line) / 2];
+    long expectedSeq = -1;
+
+    while (NULL != fgets(line, sizeof(line), stdin)) {
+        const size_t len = hexDecode(line, frame, sizeof(frame));
+        if (len > 0)
+            decodeFrame(frame, len, expectedSeq);
+    }
+
+    return 0;
+}